@@ -38,6 +38,7 @@
 #include "tgsi/tgsi_strings.h"
 #include "tgsi/tgsi_text.h"
 #include "cso_cache/cso_context.h"
+#include <math.h>
 #include <stdio.h>
 
 #define TOLERANCE 0.01
@@ -450,6 +451,143 @@ null_constant_buffer(struct pipe_context *ctx)
    util_report_result(pass);
 }
 
+/**
+ * Return a float that lands exactly halfway between the unorm8 values
+ * k and k + 1 when scaled by 255, or 0 if there is none.
+ */
+static float
+util_unorm8_half_step(unsigned k)
+{
+   volatile float target = k + 0.5f;
+   volatile float product;
+   float v = target / 255.0f;
+   int i;
+
+   for (i = 0; i < 4; i++) {
+      product = v * 255.0f;
+      if (product == target)
+         return v;
+      v = nextafterf(v, product < target ? 1.0f : 0.0f);
+   }
+   return 0;
+}
+
+/**
+ * Test that a unorm8 render target rounds the same way everywhere.
+ *
+ * The surface size isn't a multiple of the tile sizes drivers commonly
+ * use, so its right and bottom edges end in partial tiles. A color that
+ * lands exactly halfway between two unorm8 values has to be stored as the
+ * same byte in the partial tiles as in the full ones.
+ *
+ * If "clear" is true, the surface is cleared to that color first and the
+ * quad only covers the left half, so the right half keeps the cleared
+ * color and has to match the drawn half.
+ */
+static void
+unorm8_half_step_rounding(struct pipe_context *ctx, bool clear)
+{
+   static float left_half[] = {
+     -1, -1, 0, 1,   0, 0, 0, 0,
+     -1,  1, 0, 1,   0, 1, 0, 0,
+      0,  1, 0, 1,   1, 1, 0, 0,
+      0, -1, 0, 1,   1, 0, 0, 0
+   };
+   struct cso_context *cso;
+   struct pipe_resource *cb;
+   struct pipe_constant_buffer constants = {0};
+   struct pipe_transfer *transfer;
+   const uint8_t *map;
+   void *fs, *vs;
+   bool pass = true;
+   unsigned x, y, c;
+   float color[4];
+   uint8_t expected;
+
+   /* k even, so round half up and round half to even disagree */
+   color[0] = color[1] = color[2] = color[3] = util_unorm8_half_step(126);
+
+   if (color[0] == 0 ||
+       !ctx->screen->get_param(ctx->screen,
+                               PIPE_CAP_USER_CONSTANT_BUFFERS)) {
+      util_report_result(SKIP);
+      return;
+   }
+
+   cso = cso_create_context(ctx);
+   cb = util_create_texture2d(ctx->screen, 100, 50,
+                              PIPE_FORMAT_R8G8B8A8_UNORM);
+   util_set_common_states_and_clear(cso, ctx, cb);
+   if (clear)
+      ctx->clear(ctx, PIPE_CLEAR_COLOR0, (void*)color, 0, 0);
+
+   constants.user_buffer = color;
+   constants.buffer_size = sizeof(color);
+   ctx->set_constant_buffer(ctx, PIPE_SHADER_FRAGMENT, 0, &constants);
+
+   /* Fragment shader. */
+   {
+      static const char *text =
+            "FRAG\n"
+            "DCL CONST[0]\n"
+            "DCL OUT[0], COLOR\n"
+
+            "MOV OUT[0], CONST[0]\n"
+            "END\n";
+      struct tgsi_token tokens[1000];
+      struct pipe_shader_state state = {tokens};
+
+      if (!tgsi_text_translate(text, tokens, Elements(tokens))) {
+         puts("Can't compile a fragment shader.");
+         util_report_result(FAIL);
+         return;
+      }
+      fs = ctx->create_fs_state(ctx, &state);
+      cso_set_fragment_shader_handle(cso, fs);
+   }
+
+   /* Vertex shader. */
+   vs = util_set_passthrough_vertex_shader(cso, ctx, false);
+   if (clear) {
+      util_set_interleaved_vertex_elements(cso, 2);
+      util_draw_user_vertex_buffer(cso, left_half, PIPE_PRIM_QUADS, 4, 2);
+   } else {
+      util_draw_fullscreen_quad(cso);
+   }
+
+   /* Probe pixels, every byte has to match the first one. */
+   map = pipe_transfer_map(ctx, cb, 0, 0, PIPE_TRANSFER_READ,
+                           0, 0, cb->width0, cb->height0, &transfer);
+   expected = map[0];
+   if (expected != 126 && expected != 127) {
+      printf("Expected 126 or 127, got %u\n", expected);
+      pass = false;
+   }
+   for (y = 0; pass && y < cb->height0; y++) {
+      for (x = 0; pass && x < cb->width0; x++) {
+         for (c = 0; c < 4; c++) {
+            uint8_t probe = map[y * transfer->stride + x * 4 + c];
+
+            if (probe != expected) {
+               printf("Probe byte %u at (%u,%u), expected %u, got %u\n",
+                      c, x, y, expected, probe);
+               pass = false;
+               break;
+            }
+         }
+      }
+   }
+   pipe_transfer_unmap(ctx, transfer);
+
+   /* Cleanup. */
+   cso_destroy_context(cso);
+   ctx->delete_vs_state(ctx, vs);
+   ctx->delete_fs_state(ctx, fs);
+   pipe_resource_reference(&cb, NULL);
+
+   util_report_result(pass);
+}
+
 /**
  * Run all tests. This should be run with a clean context after
  * context_create.
@@ -463,6 +601,8 @@ util_run_tests(struct pipe_screen *screen)
    null_sampler_view(ctx, TGSI_TEXTURE_2D);
    null_sampler_view(ctx, TGSI_TEXTURE_BUFFER);
    null_constant_buffer(ctx);
+   unorm8_half_step_rounding(ctx, false);
+   unorm8_half_step_rounding(ctx, true);
 
    ctx->destroy(ctx);
 
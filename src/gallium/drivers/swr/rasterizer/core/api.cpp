@@ -58,35 +58,36 @@ HANDLE SwrCreateContext(
     RDTSC_RESET();
     RDTSC_INIT(0);
 
-    void* pContextMem = _aligned_malloc(sizeof(SWR_CONTEXT), KNOB_SIMD_WIDTH * 4);
+    // cache line aligned, the per worker members rely on it
+    void* pContextMem = _aligned_malloc(sizeof(SWR_CONTEXT), 64);
     memset(pContextMem, 0, sizeof(SWR_CONTEXT));
     SWR_CONTEXT *pContext = new (pContextMem) SWR_CONTEXT();
 
     pContext->driverType = pCreateInfo->driver;
     pContext->privateStateSize = pCreateInfo->privateStateSize;
+    pContext->MaxDrawsInFlight = pCreateInfo->maxDrawsInFlight ? pCreateInfo->maxDrawsInFlight : KNOB_MAX_DRAWS_IN_FLIGHT;
 
-    pContext->dcRing = (DRAW_CONTEXT*)_aligned_malloc(sizeof(DRAW_CONTEXT)*KNOB_MAX_DRAWS_IN_FLIGHT, 64);
-    memset(pContext->dcRing, 0, sizeof(DRAW_CONTEXT)*KNOB_MAX_DRAWS_IN_FLIGHT);
+    pContext->dcRing = (DRAW_CONTEXT*)_aligned_malloc(sizeof(DRAW_CONTEXT)*pContext->MaxDrawsInFlight, 64);
+    memset(pContext->dcRing, 0, sizeof(DRAW_CONTEXT)*pContext->MaxDrawsInFlight);
 
-    pContext->dsRing = (DRAW_STATE*)_aligned_malloc(sizeof(DRAW_STATE)*KNOB_MAX_DRAWS_IN_FLIGHT, 64);
-    memset(pContext->dsRing, 0, sizeof(DRAW_STATE)*KNOB_MAX_DRAWS_IN_FLIGHT);
+    pContext->dsRing = (DRAW_STATE*)_aligned_malloc(sizeof(DRAW_STATE)*pContext->MaxDrawsInFlight, 64);
+    memset(pContext->dsRing, 0, sizeof(DRAW_STATE)*pContext->MaxDrawsInFlight);
 
-    for (uint32_t dc = 0; dc < KNOB_MAX_DRAWS_IN_FLIGHT; ++dc)
+    for (uint32_t dc = 0; dc < pContext->MaxDrawsInFlight; ++dc)
     {
-        pContext->dcRing[dc].arena.Init();
         pContext->dcRing[dc].inUse = false;
         pContext->dcRing[dc].pTileMgr = new MacroTileMgr();
         pContext->dcRing[dc].pDispatch = new DispatchQueue(); /// @todo Could lazily allocate this if Dispatch seen.
-
-        pContext->dsRing[dc].arena.Init();
     }
 
     if (!KNOB_SINGLE_THREADED)
     {
         memset(&pContext->WaitLock, 0, sizeof(pContext->WaitLock));
-        memset(&pContext->FifosNotEmpty, 0, sizeof(pContext->FifosNotEmpty));
         new (&pContext->WaitLock) std::mutex();
-        new (&pContext->FifosNotEmpty) std::condition_variable();
+        memset(&pContext->RetireLock, 0, sizeof(pContext->RetireLock));
+        memset(&pContext->DrawRetired, 0, sizeof(pContext->DrawRetired));
+        new (&pContext->RetireLock) std::mutex();
+        new (&pContext->DrawRetired) std::condition_variable();
 
         CreateThreadPool(pContext, &pContext->threadPool);
     }
@@ -105,6 +106,20 @@ HANDLE SwrCreateContext(
         pContext->pScratch[i] = (uint8_t*)_aligned_malloc((32 * 1024), KNOB_SIMD_WIDTH * 4);
     }
 
+    // initialize arenas, DC and DS arenas are set up by the API thread so use the first node for those
+    pContext->pArenaBlockPool = new ArenaBlockPool(pContext->threadPool.numNumaNodes, pContext->threadPool.pNumaNodeIds);
+    for (uint32_t dc = 0; dc < pContext->MaxDrawsInFlight; ++dc)
+    {
+        pContext->dcRing[dc].arena.Init(pContext->pArenaBlockPool);
+        pContext->dsRing[dc].arena.Init(pContext->pArenaBlockPool);
+    }
+
+    for (uint32_t i = 0; i < pContext->NumWorkerThreads; ++i)
+    {
+        uint32_t numaNode = pContext->threadPool.pThreadData ? pContext->threadPool.pThreadData[i].numaId : 0;
+        pContext->workerArenas[i].Init(pContext->pArenaBlockPool, numaNode);
+    }
+
     pContext->LastRetiredId = 0;
     pContext->nextDrawId = 1;
 
@@ -121,7 +136,10 @@ HANDLE SwrCreateContext(
     SetupDefaultState(pContext);
 
     // initialize hot tile manager
-    pContext->pHotTileMgr = new HotTileMgr();
+    pContext->pHotTileMgr = new HotTileMgr(pContext->threadPool.numNumaNodes, pContext->threadPool.pNumaNodeIds);
+
+    // initialize backend macrotile scheduler
+    pContext->pTileScheduler = new MacroTileScheduler(pContext->NumWorkerThreads, pContext->pHotTileMgr->GetNumNumaNodes());
 
     // initialize function pointer tables
     InitClearTilesTable();
@@ -140,34 +158,99 @@ void SwrDestroyContext(HANDLE hContext)
     DestroyThreadPool(pContext, &pContext->threadPool);
 
     // free the fifos
-    for (uint32_t i = 0; i < KNOB_MAX_DRAWS_IN_FLIGHT; ++i)
+    for (uint32_t i = 0; i < pContext->MaxDrawsInFlight; ++i)
     {
         delete(pContext->dcRing[i].pTileMgr);
         delete(pContext->dcRing[i].pDispatch);
+
+        pContext->dcRing[i].arena.Reset(true);
+        pContext->dsRing[i].arena.Reset(true);
     }
 
     // Free scratch space.
     for (uint32_t i = 0; i < pContext->NumWorkerThreads; ++i)
     {
         _aligned_free(pContext->pScratch[i]);
+        pContext->workerArenas[i].Reset(true);
     }
 
+    delete(pContext->pArenaBlockPool);
+
     _aligned_free(pContext->dcRing);
     _aligned_free(pContext->dsRing);
 
     delete(pContext->pHotTileMgr);
+    delete(pContext->pTileScheduler);
 
     pContext->~SWR_CONTEXT();
     _aligned_free((SWR_CONTEXT*)hContext);
 }
 
-void WakeAllThreads(SWR_CONTEXT *pContext)
+//////////////////////////////////////////////////////////////////////////
+/// @brief Wakes up to numWorkers parked workers.
+///        Callers estimate how many workers their new work can keep busy.
+/// @param pContext - Pointer to SWR context.
+/// @param numWorkers - Number of workers the new work needs.
+void WakeWorkers(SWR_CONTEXT *pContext, uint32_t numWorkers)
 {
+    if (KNOB_SINGLE_THREADED || numWorkers == 0) { return; }
+
+    // Pairs with the fence in workerThread, a worker that is about to park either
+    // sees the new work or is counted in NumParkedWorkers here.
+    _mm_mfence();
+
+    if (pContext->NumParkedWorkers == 0) { return; }
+
     std::unique_lock<std::mutex> lock(pContext->WaitLock);
-    pContext->FifosNotEmpty.notify_all();
+
+    // Workers only park and unpark under WaitLock, so a parked worker we pick
+    // stays parked until we mark it running here.  From then on the API thread
+    // can't move its draw counters past the work it is woken for.
+    uint32_t numWake = std::min(numWorkers, pContext->NumParkedWorkers);
+    for (uint32_t i = 0; i < pContext->NumWorkerThreads && numWake > 0; ++i)
+    {
+        LONG state;
+        while ((state = InterlockedCompareExchange(&pContext->WorkerState[i], WORKER_RUNNING, WORKER_PARKED)) == WORKER_ADVANCING)
+        {
+            _mm_pause();
+        }
+
+        if (state == WORKER_PARKED)
+        {
+            pContext->WorkerWake[i].notify_one();
+            pContext->NumParkedWorkers--;
+            pContext->NumWorkerWakes++;
+            numWake--;
+        }
+    }
+
     lock.unlock();
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Moves the draw counters of a parked worker past a draw whose FE is done.
+/// @param pContext - Pointer to SWR context.
+/// @param workerId - Worker to move forward.
+/// @param drawId - Draw to move past; later draws may not be done yet.
+/// @return false if the worker isn't parked.
+static bool AdvanceParkedWorker(SWR_CONTEXT *pContext, uint32_t workerId, uint64_t drawId)
+{
+    if (InterlockedCompareExchange(&pContext->WorkerState[workerId], WORKER_ADVANCING, WORKER_PARKED) != WORKER_PARKED)
+    {
+        return false;
+    }
+
+    // A parked worker has already completed every draw it knows about, so it can
+    // skip the draw being retired.  Draws after it still need their FE run, a
+    // worker woken for them must find them ahead of its counters.
+    pContext->WorkerFE[workerId] = std::max((uint64_t)pContext->WorkerFE[workerId], drawId + 1);
+    pContext->WorkerBE[workerId] = std::max((uint64_t)pContext->WorkerBE[workerId], drawId + 1);
+
+    _ReadWriteBarrier();
+    pContext->WorkerState[workerId] = WORKER_PARKED;
+    return true;
+}
+
 bool StillDrawing(SWR_CONTEXT *pContext, DRAW_CONTEXT *pDC)
 {
     // For single thread nothing should still be drawing.
@@ -188,14 +271,12 @@ bool StillDrawing(SWR_CONTEXT *pContext, DRAW_CONTEXT *pDC)
         // ensure workers have all moved passed this draw
         for (uint32_t i = 0; i < pContext->NumWorkerThreads; ++i)
         {
-            if (pContext->WorkerFE[i] <= pDC->drawId)
-            {
-                return true;
-            }
-
-            if (pContext->WorkerBE[i] <= pDC->drawId)
+            if ((pContext->WorkerFE[i] <= pDC->drawId) || (pContext->WorkerBE[i] <= pDC->drawId))
             {
-                return true;
+                if (!AdvanceParkedWorker(pContext, i, pDC->drawId))
+                {
+                    return true;
+                }
             }
         }
 
@@ -205,6 +286,40 @@ bool StillDrawing(SWR_CONTEXT *pContext, DRAW_CONTEXT *pDC)
     return pDC->inUse;
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Blocks the API thread until a draw context has retired.
+///        Workers wake us up through DrawRetired whenever they move past
+///        a draw, see NotifyDrawRetired.
+/// @param pContext - Pointer to SWR context.
+/// @param pDC - Draw context the API thread wants to reuse.
+void WaitForDrawRetire(SWR_CONTEXT *pContext, DRAW_CONTEXT *pDC)
+{
+    RDTSC_START(APIDrawRingStall);
+    uint64_t start = __rdtsc();
+
+    std::unique_lock<std::mutex> lock(pContext->RetireLock);
+    pContext->ApiWaitingForRetire = true;
+
+    // Workers check ApiWaitingForRetire after moving their draw counters,
+    // so order the flag store before we look at the counters again.
+    _mm_mfence();
+
+    while (StillDrawing(pContext, pDC))
+    {
+        // Make sure workers are working.
+        WakeWorkers(pContext, 1);
+
+        pContext->DrawRetired.wait(lock);
+    }
+
+    pContext->ApiWaitingForRetire = false;
+    lock.unlock();
+
+    pContext->apiStats.numDrawRingStalls++;
+    pContext->apiStats.drawRingStallCycles += __rdtsc() - start;
+    RDTSC_STOP(APIDrawRingStall, 0, 0);
+}
+
 void UpdateLastRetiredId(SWR_CONTEXT *pContext)
 {
     uint64_t head = pContext->LastRetiredId + 1;
@@ -214,17 +329,17 @@ void UpdateLastRetiredId(SWR_CONTEXT *pContext)
     // This is because the update to LastRetiredId can fall behind causing the range from LastRetiredId
     // to DrawEnqueued to exceed the size of the DRAW_CONTEXT ring. Check for this and manually increment 
     // the head to the oldest entry of the DRAW_CONTEXT ring
-    if ((tail - head) > KNOB_MAX_DRAWS_IN_FLIGHT - 1)
+    if ((tail - head) > pContext->MaxDrawsInFlight - 1)
     {
-        head = tail - KNOB_MAX_DRAWS_IN_FLIGHT + 1;
+        head = tail - pContext->MaxDrawsInFlight + 1;
     }
 
-    DRAW_CONTEXT *pDC = &pContext->dcRing[head % KNOB_MAX_DRAWS_IN_FLIGHT];
+    DRAW_CONTEXT *pDC = &pContext->dcRing[head % pContext->MaxDrawsInFlight];
     while ((head < tail) && !StillDrawing(pContext, pDC))
     {
         pContext->LastRetiredId = pDC->drawId;
         head++;
-        pDC = &pContext->dcRing[head % KNOB_MAX_DRAWS_IN_FLIGHT];
+        pDC = &pContext->dcRing[head % pContext->MaxDrawsInFlight];
     }
 }
 
@@ -234,15 +349,64 @@ void WaitForDependencies(SWR_CONTEXT *pContext, uint64_t drawId)
     {
         while (drawId > pContext->LastRetiredId)
         {
-            WakeAllThreads(pContext);
+            WakeWorkers(pContext, 1);
             UpdateLastRetiredId(pContext);
         }
     }
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Byte ranges of API_STATE covered by each API_STATE_BLOCK.
+///        Blocks are contiguous and in API_STATE member order.
+struct API_STATE_RANGE
+{
+    size_t begin;
+    size_t end;
+};
+
+static const API_STATE_RANGE gApiStateBlocks[API_STATE_NUM_BLOCKS] =
+{
+    { offsetof(API_STATE, vertexBuffers),     offsetof(API_STATE, pfnVertexFunc) },       // API_STATE_BLOCK_VERTEX_INPUT
+    { offsetof(API_STATE, pfnVertexFunc),     offsetof(API_STATE, soBuffer) },            // API_STATE_BLOCK_SHADERS
+    { offsetof(API_STATE, vp),                offsetof(API_STATE, scissorRects) },        // API_STATE_BLOCK_VIEWPORT
+    { offsetof(API_STATE, scissorRects),      offsetof(API_STATE, scissorInFixedPoint) }, // API_STATE_BLOCK_SCISSOR
+    { offsetof(API_STATE, backendState),      offsetof(API_STATE, blendState) },          // API_STATE_BLOCK_PIXEL
+    { offsetof(API_STATE, blendState),        offsetof(API_STATE, enableStats) },         // API_STATE_BLOCK_BLEND
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Copy API state of the previous draw to a DS ring entry.
+///        Blocks the entry still holds from an earlier draw are skipped,
+///        everything between the blocks is always copied.
+/// @param dst - DS ring entry for the new draw.
+/// @param src - State of the previous draw.
 void CopyState(DRAW_STATE& dst, const DRAW_STATE& src)
 {
-    memcpy(&dst.state, &src.state, sizeof(API_STATE));
+    uint8_t* pDst = (uint8_t*)&dst.state;
+    const uint8_t* pSrc = (const uint8_t*)&src.state;
+    size_t copied = 0;
+
+    for (uint32_t b = 0; b < API_STATE_NUM_BLOCKS; ++b)
+    {
+        const API_STATE_RANGE& range = gApiStateBlocks[b];
+        SWR_ASSERT(range.begin >= copied && range.end > range.begin);
+
+        // state in front of this block
+        if (range.begin > copied)
+        {
+            memcpy(pDst + copied, pSrc + copied, range.begin - copied);
+        }
+
+        if (dst.blockVersion[b] != src.blockVersion[b])
+        {
+            memcpy(pDst + range.begin, pSrc + range.begin, range.end - range.begin);
+            dst.blockVersion[b] = src.blockVersion[b];
+        }
+
+        copied = range.end;
+    }
+
+    memcpy(pDst + copied, pSrc + copied, sizeof(API_STATE) - copied);
 }
 
 void QueueDraw(SWR_CONTEXT *pContext)
@@ -256,18 +420,19 @@ void QueueDraw(SWR_CONTEXT *pContext)
         uint32_t mxcsr = _mm_getcsr();
         _mm_setcsr(mxcsr | _MM_FLUSH_ZERO_ON | _MM_DENORMALS_ZERO_ON);
 
-        std::unordered_set<uint32_t> lockedTiles;
         WorkOnFifoFE(pContext, 0, pContext->WorkerFE[0], 0);
-        WorkOnFifoBE(pContext, 0, pContext->WorkerBE[0], lockedTiles);
+        WorkOnFifoBE(pContext, 0, pContext->WorkerBE[0], 0);
 
         // restore csr
         _mm_setcsr(mxcsr);
     }
     else
     {
-        RDTSC_START(APIDrawWakeAllThreads);
-        WakeAllThreads(pContext);
-        RDTSC_STOP(APIDrawWakeAllThreads, 1, 0);
+        // One worker picks up the FE, it wakes more once it knows how many
+        // macrotiles the draw touches.
+        RDTSC_START(APIDrawWakeWorkers);
+        WakeWorkers(pContext, 1);
+        RDTSC_STOP(APIDrawWakeWorkers, 1, 0);
     }
 
     // Set current draw context to NULL so that next state call forces a new draw context to be created and populated.
@@ -294,9 +459,9 @@ void QueueDispatch(SWR_CONTEXT *pContext)
     }
     else
     {
-        RDTSC_START(APIDrawWakeAllThreads);
-        WakeAllThreads(pContext);
-        RDTSC_STOP(APIDrawWakeAllThreads, 1, 0);
+        RDTSC_START(APIDrawWakeWorkers);
+        WakeWorkers(pContext, pContext->pCurDrawContext->pDispatch->getNumQueued());
+        RDTSC_STOP(APIDrawWakeWorkers, 1, 0);
     }
 
     // Set current draw context to NULL so that next state call forces a new draw context to be created and populated.
@@ -310,7 +475,7 @@ DRAW_CONTEXT* GetDrawContext(SWR_CONTEXT *pContext, bool isSplitDraw = false)
     // If current draw context is null then need to obtain a new draw context to use from ring.
     if (pContext->pCurDrawContext == nullptr)
     {
-        uint32_t dcIndex = pContext->nextDrawId % KNOB_MAX_DRAWS_IN_FLIGHT;
+        uint32_t dcIndex = pContext->nextDrawId % pContext->MaxDrawsInFlight;
 
         DRAW_CONTEXT* pCurDrawContext = &pContext->dcRing[dcIndex];
         pContext->pCurDrawContext = pCurDrawContext;
@@ -319,16 +484,13 @@ DRAW_CONTEXT* GetDrawContext(SWR_CONTEXT *pContext, bool isSplitDraw = false)
         UpdateLastRetiredId(pContext);
 
         // Need to wait until this draw context is available to use.
-        while (StillDrawing(pContext, pCurDrawContext))
+        if (StillDrawing(pContext, pCurDrawContext))
         {
-            // Make sure workers are working.
-            WakeAllThreads(pContext);
-
-            _mm_pause();
+            WaitForDrawRetire(pContext, pCurDrawContext);
         }
 
         // Assign next available entry in DS ring to this DC.
-        uint32_t dsIndex = pContext->curStateId % KNOB_MAX_DRAWS_IN_FLIGHT;
+        uint32_t dsIndex = pContext->curStateId % pContext->MaxDrawsInFlight;
         pCurDrawContext->pState = &pContext->dsRing[dsIndex];
 
         Arena& stateArena = pCurDrawContext->pState->arena;
@@ -355,6 +517,13 @@ DRAW_CONTEXT* GetDrawContext(SWR_CONTEXT *pContext, bool isSplitDraw = false)
                 }
 
                 pContext->curStateId++;  // Progress state ring index forward.
+
+                // Give memory cached beyond the recent peak usage back to the system
+                // once per trip around the DS ring.
+                if ((pContext->curStateId % pContext->MaxDrawsInFlight) == 0)
+                {
+                    pContext->pArenaBlockPool->Trim();
+                }
             }
             else
             {
@@ -377,6 +546,7 @@ DRAW_CONTEXT* GetDrawContext(SWR_CONTEXT *pContext, bool isSplitDraw = false)
 
         pCurDrawContext->doneCompute = false;
         pCurDrawContext->doneFE = false;
+        pCurDrawContext->streamBE = false;
         pCurDrawContext->FeLock = 0;
 
         pCurDrawContext->pTileMgr->initialize();
@@ -401,6 +571,22 @@ API_STATE* GetDrawState(SWR_CONTEXT *pContext)
     return &pDC->pState->state;
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns API state of the current draw for modifying a block of it.
+///        The block gets a new version so the change is carried over to the
+///        following draws by CopyState.
+/// @param pContext - Pointer to SWR context.
+/// @param block - State block that is going to be modified.
+API_STATE* GetDrawState(SWR_CONTEXT *pContext, API_STATE_BLOCK block)
+{
+    DRAW_CONTEXT* pDC = GetDrawContext(pContext);
+    SWR_ASSERT(pDC->pState != nullptr);
+
+    pDC->pState->blockVersion[block] = ++pContext->stateVersion;
+
+    return &pDC->pState->state;
+}
+
 void SetupDefaultState(SWR_CONTEXT *pContext)
 {
     API_STATE* pState = GetDrawState(pContext);
@@ -452,7 +638,7 @@ void SwrSetVertexBuffers(
     uint32_t numBuffers,
     const SWR_VERTEX_BUFFER_STATE* pVertexBuffers)
 {
-    API_STATE* pState = GetDrawState(GetContext(hContext));
+    API_STATE* pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_VERTEX_INPUT);
 
     for (uint32_t i = 0; i < numBuffers; ++i)
     {
@@ -465,7 +651,7 @@ void SwrSetIndexBuffer(
     HANDLE hContext,
     const SWR_INDEX_BUFFER_STATE* pIndexBuffer)
 {
-    API_STATE* pState = GetDrawState(GetContext(hContext));
+    API_STATE* pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_VERTEX_INPUT);
 
     pState->indexBuffer = *pIndexBuffer;
 }
@@ -474,7 +660,7 @@ void SwrSetFetchFunc(
     HANDLE hContext,
     PFN_FETCH_FUNC    pfnFetchFunc)
 {
-    API_STATE* pState = GetDrawState(GetContext(hContext));
+    API_STATE* pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_VERTEX_INPUT);
 
     pState->pfnFetchFunc = pfnFetchFunc;
 }
@@ -484,7 +670,7 @@ void SwrSetSoFunc(
     PFN_SO_FUNC    pfnSoFunc,
     uint32_t streamIndex)
 {
-    API_STATE* pState = GetDrawState(GetContext(hContext));
+    API_STATE* pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_SHADERS);
 
     SWR_ASSERT(streamIndex < MAX_SO_STREAMS);
 
@@ -495,7 +681,7 @@ void SwrSetSoState(
     HANDLE hContext,
     SWR_STREAMOUT_STATE* pSoState)
 {
-    API_STATE* pState = GetDrawState(GetContext(hContext));
+    API_STATE* pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_SHADERS);
 
     pState->soState = *pSoState;
 }
@@ -516,7 +702,7 @@ void SwrSetVertexFunc(
     HANDLE hContext,
     PFN_VERTEX_FUNC pfnVertexFunc)
 {
-    API_STATE* pState = GetDrawState(GetContext(hContext));
+    API_STATE* pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_SHADERS);
 
     pState->pfnVertexFunc = pfnVertexFunc;
 }
@@ -525,7 +711,7 @@ void SwrSetFrontendState(
     HANDLE hContext,
     SWR_FRONTEND_STATE *pFEState)
 {
-    API_STATE* pState = GetDrawState(GetContext(hContext));
+    API_STATE* pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_SHADERS);
     pState->frontendState = *pFEState;
 }
 
@@ -533,7 +719,7 @@ void SwrSetGsState(
     HANDLE hContext,
     SWR_GS_STATE *pGSState)
 {
-    API_STATE* pState = GetDrawState(GetContext(hContext));
+    API_STATE* pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_SHADERS);
     pState->gsState = *pGSState;
 }
 
@@ -541,7 +727,7 @@ void SwrSetGsFunc(
     HANDLE hContext,
     PFN_GS_FUNC pfnGsFunc)
 {
-    API_STATE* pState = GetDrawState(GetContext(hContext));
+    API_STATE* pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_SHADERS);
     pState->pfnGsFunc = pfnGsFunc;
 }
 
@@ -550,7 +736,7 @@ void SwrSetCsFunc(
     PFN_CS_FUNC pfnCsFunc,
     uint32_t totalThreadsInGroup)
 {
-    API_STATE* pState = GetDrawState(GetContext(hContext));
+    API_STATE* pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_SHADERS);
     pState->pfnCsFunc = pfnCsFunc;
     pState->totalThreadsInGroup = totalThreadsInGroup;
 }
@@ -583,7 +769,7 @@ void SwrSetDepthStencilState(
     HANDLE hContext,
     SWR_DEPTH_STENCIL_STATE *pDSState)
 {
-    API_STATE* pState = GetDrawState(GetContext(hContext));
+    API_STATE* pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_PIXEL);
 
     pState->depthStencilState = *pDSState;
 }
@@ -592,7 +778,7 @@ void SwrSetBackendState(
     HANDLE hContext,
     SWR_BACKEND_STATE *pBEState)
 {
-    API_STATE* pState = GetDrawState(GetContext(hContext));
+    API_STATE* pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_PIXEL);
 
     pState->backendState = *pBEState;
 }
@@ -601,7 +787,7 @@ void SwrSetPixelShaderState(
     HANDLE hContext,
     SWR_PS_STATE *pPSState)
 {
-    API_STATE *pState = GetDrawState(GetContext(hContext));
+    API_STATE *pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_PIXEL);
     pState->psState = *pPSState;
 }
 
@@ -609,7 +795,7 @@ void SwrSetBlendState(
     HANDLE hContext,
     SWR_BLEND_STATE *pBlendState)
 {
-    API_STATE *pState = GetDrawState(GetContext(hContext));
+    API_STATE *pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_BLEND);
     memcpy(&pState->blendState, pBlendState, sizeof(SWR_BLEND_STATE));
 }
 
@@ -619,7 +805,7 @@ void SwrSetBlendFunc(
     PFN_BLEND_JIT_FUNC pfnBlendFunc)
 {
     SWR_ASSERT(renderTarget < SWR_NUM_RENDERTARGETS);
-    API_STATE *pState = GetDrawState(GetContext(hContext));
+    API_STATE *pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_BLEND);
     pState->pfnBlendFunc[renderTarget] = pfnBlendFunc;
 }
 
@@ -678,7 +864,7 @@ void SwrSetViewports(
         "Invalid number of viewports.");
 
     SWR_CONTEXT *pContext = GetContext(hContext);
-    API_STATE* pState = GetDrawState(pContext);
+    API_STATE* pState = GetDrawState(pContext, API_STATE_BLOCK_VIEWPORT);
 
     memcpy(&pState->vp[0], pViewports, sizeof(SWR_VIEWPORT) * numViewports);
 
@@ -729,7 +915,7 @@ void SwrSetScissorRects(
     SWR_ASSERT(numScissors <= KNOB_NUM_VIEWPORTS_SCISSORS,
         "Invalid number of scissor rects.");
 
-    API_STATE* pState = GetDrawState(GetContext(hContext));
+    API_STATE* pState = GetDrawState(GetContext(hContext), API_STATE_BLOCK_SCISSOR);
     memcpy(&pState->scissorRects[0], pScissors, numScissors * sizeof(BBOX));
 };
 
@@ -764,11 +950,12 @@ void SetupMacroTileScissors(DRAW_CONTEXT *pDC)
 void SetupPipeline(DRAW_CONTEXT *pDC)
 {
     DRAW_STATE* pState = pDC->pState;
+    const uint32_t stats = pState->state.enableStats ? 1 : 0;
 
     // setup backend
     if (pState->state.psState.pfnPixelShader == nullptr)
     {
-        pState->pfnBackend = &BackendNullPS;
+        pState->pfnBackend = gNullPSBackendTable[stats];
     }
     else
     {
@@ -780,11 +967,11 @@ void SetupPipeline(DRAW_CONTEXT *pDC)
         case SWR_SHADING_RATE_PIXEL:
             if(bMultisampleEnable)
             {
-                pState->pfnBackend = gPixelRateBackendTable[pState->state.rastState.sampleCount-1][pState->state.psState.maxRTSlotUsed];
+                pState->pfnBackend = gPixelRateBackendTable[stats][pState->state.rastState.sampleCount-1][pState->state.psState.maxRTSlotUsed];
             }
             else
             {
-                pState->pfnBackend = gSingleSampleBackendTable[pState->state.psState.maxRTSlotUsed];
+                pState->pfnBackend = gSingleSampleBackendTable[stats][pState->state.psState.maxRTSlotUsed];
             }
             break;
         case SWR_SHADING_RATE_SAMPLE:
@@ -793,11 +980,12 @@ void SetupPipeline(DRAW_CONTEXT *pDC)
             {
                 // If PS is set at per sample rate and multisampling is disabled, set to per pixel and single sample backend
                 pState->state.psState.shadingRate = SWR_SHADING_RATE_PIXEL;
-                pState->pfnBackend = gSingleSampleBackendTable[pState->state.psState.maxRTSlotUsed];
+                pState->blockVersion[API_STATE_BLOCK_PIXEL] = ++pDC->pContext->stateVersion;
+                pState->pfnBackend = gSingleSampleBackendTable[stats][pState->state.psState.maxRTSlotUsed];
             }
             else
             {
-                pState->pfnBackend = gSampleRateBackendTable[pState->state.rastState.sampleCount-1][pState->state.psState.maxRTSlotUsed];
+                pState->pfnBackend = gSampleRateBackendTable[stats][pState->state.rastState.sampleCount-1][pState->state.psState.maxRTSlotUsed];
             }
             break;
         case SWR_SHADING_RATE_COARSE:
@@ -899,16 +1087,36 @@ void InitDraw(
         rastState.isSampleMasked[i] = !(sampleMask & 1);
         sampleMask>>=1;
     }
+
+    // Size the macrotile grid for the scissor before the FE starts binning. The grid
+    // can't grow once the backend starts working on binned macrotiles of the draw.
+    const BBOX& scissor = pDC->pState->state.scissorInFixedPoint;
+    uint32_t numTilesX = (uint32_t)std::max(scissor.right, 0) / KNOB_MACROTILE_X_DIM_FIXED + 1;
+    uint32_t numTilesY = (uint32_t)std::max(scissor.bottom, 0) / KNOB_MACROTILE_Y_DIM_FIXED + 1;
+    pDC->pTileMgr->reserveTiles(
+        std::min(numTilesX, (uint32_t)KNOB_NUM_HOT_TILES_X),
+        std::min(numTilesY, (uint32_t)KNOB_NUM_HOT_TILES_Y));
+
+    pDC->streamBE = KNOB_STREAMING_BE;
+    if (pDC->streamBE)
+    {
+        pDC->pTileMgr->wakeOnBin(pDC->pContext);
+    }
 }
 
 //////////////////////////////////////////////////////////////////////////
 /// @brief We can split the draw for certain topologies for better performance.
+///        Split draws are separate DCs so their FE work is picked up by
+///        multiple workers, the BE merges them per macrotile in draw order.
 /// @param totalVerts - Total vertices for draw
 /// @param topology - Topology used for draw
+/// @param isIndexed - Indexed strips are not split since a cut index can
+///                    change the winding of the strip after the split.
 uint32_t MaxVertsPerDraw(
     DRAW_CONTEXT* pDC,
     uint32_t totalVerts,
-    PRIMITIVE_TOPOLOGY topology)
+    PRIMITIVE_TOPOLOGY topology,
+    bool isIndexed)
 {
     API_STATE& state = pDC->pState->state;
 
@@ -922,10 +1130,21 @@ uint32_t MaxVertsPerDraw(
     switch (topology)
     {
     case TOP_POINT_LIST:
+    case TOP_LINE_LIST:
     case TOP_TRIANGLE_LIST:
         vertsPerDraw = KNOB_MAX_PRIMS_PER_DRAW;
         break;
 
+    case TOP_LINE_STRIP:
+    case TOP_TRIANGLE_STRIP:
+        // Split draws overlap by SplitDrawOverlap() verts. KNOB_MAX_PRIMS_PER_DRAW is even
+        // so every split tri strip starts on an even triangle and keeps its winding.
+        if (!isIndexed)
+        {
+            vertsPerDraw = KNOB_MAX_PRIMS_PER_DRAW;
+        }
+        break;
+
     case TOP_PATCHLIST_1:
     case TOP_PATCHLIST_2:
     case TOP_PATCHLIST_3:
@@ -973,6 +1192,41 @@ uint32_t MaxVertsPerDraw(
     return vertsPerDraw;
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Number of vertices shared by consecutive split draws.
+/// @param topology - Topology used for draw
+uint32_t SplitDrawOverlap(PRIMITIVE_TOPOLOGY topology)
+{
+    switch (topology)
+    {
+    case TOP_LINE_STRIP: return 1;
+    case TOP_TRIANGLE_STRIP: return 2;
+    default: return 0;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Instanced draws with few verts per instance are split into
+///        batches of instances so that their FE work can be spread across
+///        workers as well.
+/// @param vertsPerInstance - Vertices (or indices) per instance
+/// @param numInstances - Total instances for draw
+uint32_t MaxInstancesPerDraw(
+    DRAW_CONTEXT* pDC,
+    uint32_t vertsPerInstance,
+    uint32_t numInstances)
+{
+    API_STATE& state = pDC->pState->state;
+
+    if (state.soState.soEnable || vertsPerInstance == 0)
+    {
+        return numInstances;
+    }
+
+    uint32_t instancesPerDraw = std::max(KNOB_MAX_PRIMS_PER_DRAW / vertsPerInstance, 1u);
+    return std::min(instancesPerDraw, numInstances);
+}
+
 // Recursive template used to auto-nest conditionals.  Converts dynamic boolean function
 // arguments to static template arguments.
 template <bool... ArgsB>
@@ -1038,9 +1292,10 @@ void DrawInstanced(
     SWR_CONTEXT *pContext = GetContext(hContext);
     DRAW_CONTEXT* pDC = GetDrawContext(pContext);
 
-    int32_t maxVertsPerDraw = MaxVertsPerDraw(pDC, numVertices, topology);
+    uint32_t maxVertsPerDraw = MaxVertsPerDraw(pDC, numVertices, topology, false);
     uint32_t primsPerDraw = GetNumPrims(topology, maxVertsPerDraw);
-    int32_t remainingVerts = numVertices;
+    uint32_t vertsOverlap = SplitDrawOverlap(topology);
+    uint32_t maxInstancesPerDraw = MaxInstancesPerDraw(pDC, numVertices, numInstances);
 
     API_STATE    *pState = &pDC->pState->state;
     pState->topology = topology;
@@ -1054,34 +1309,42 @@ void DrawInstanced(
         pState->forceFront = true;
     }
 
+    // Batches of instances are issued in order and each batch is split into vertex
+    // ranges, which keeps the split draws in API primitive order.
     int draw = 0;
-    while (remainingVerts)
+    for (uint32_t instance = 0; instance < numInstances; instance += maxInstancesPerDraw)
     {
-        uint32_t numVertsForDraw = (remainingVerts < maxVertsPerDraw) ?
-        remainingVerts : maxVertsPerDraw;
-
-        bool isSplitDraw = (draw > 0) ? true : false;
-        DRAW_CONTEXT* pDC = GetDrawContext(pContext, isSplitDraw);
-        InitDraw(pDC, isSplitDraw);
-
-        pDC->FeWork.type = DRAW;
-        pDC->FeWork.pfnWork = GetFEDrawFunc(
-            false,  // IsIndexed
-            pState->tsState.tsEnable,
-            pState->gsState.gsEnable,
-            pState->soState.soEnable,
-            pDC->pState->pfnProcessPrims != nullptr);
-        pDC->FeWork.desc.draw.numVerts = numVertsForDraw;
-        pDC->FeWork.desc.draw.startVertex = startVertex + draw * maxVertsPerDraw;
-        pDC->FeWork.desc.draw.numInstances = numInstances;
-        pDC->FeWork.desc.draw.startInstance = startInstance;
-        pDC->FeWork.desc.draw.startPrimID = draw * primsPerDraw;
-
-        //enqueue DC
-        QueueDraw(pContext);
-
-        remainingVerts -= numVertsForDraw;
-        draw++;
+        uint32_t numInstancesForDraw = std::min(numInstances - instance, maxInstancesPerDraw);
+
+        uint32_t split = 0;
+        for (uint32_t vert = 0; vert + vertsOverlap < numVertices; vert += maxVertsPerDraw - vertsOverlap)
+        {
+            uint32_t numVertsForDraw = std::min(numVertices - vert, maxVertsPerDraw);
+
+            bool isSplitDraw = (draw > 0) ? true : false;
+            DRAW_CONTEXT* pDC = GetDrawContext(pContext, isSplitDraw);
+            InitDraw(pDC, isSplitDraw);
+
+            pDC->FeWork.type = DRAW;
+            pDC->FeWork.pfnWork = GetFEDrawFunc(
+                false,  // IsIndexed
+                pState->tsState.tsEnable,
+                pState->gsState.gsEnable,
+                pState->soState.soEnable,
+                pDC->pState->pfnProcessPrims != nullptr);
+            pDC->FeWork.desc.draw.numVerts = numVertsForDraw;
+            pDC->FeWork.desc.draw.startVertex = startVertex + vert;
+            pDC->FeWork.desc.draw.numInstances = numInstancesForDraw;
+            pDC->FeWork.desc.draw.startInstance = startInstance;
+            pDC->FeWork.desc.draw.startInstanceID = instance;
+            pDC->FeWork.desc.draw.startPrimID = split * primsPerDraw;
+
+            //enqueue DC
+            QueueDraw(pContext);
+
+            split++;
+            draw++;
+        }
     }
 
     // restore culling state
@@ -1150,9 +1413,10 @@ void DrawIndexedInstance(
     DRAW_CONTEXT* pDC = GetDrawContext(pContext);
     API_STATE* pState = &pDC->pState->state;
 
-    int32_t maxIndicesPerDraw = MaxVertsPerDraw(pDC, numIndices, topology);
+    uint32_t maxIndicesPerDraw = MaxVertsPerDraw(pDC, numIndices, topology, true);
     uint32_t primsPerDraw = GetNumPrims(topology, maxIndicesPerDraw);
-    int32_t remainingIndices = numIndices;
+    uint32_t indicesOverlap = SplitDrawOverlap(topology);
+    uint32_t maxInstancesPerDraw = MaxInstancesPerDraw(pDC, numIndices, numInstances);
 
     uint32_t indexSize = 0;
     switch (pState->indexBuffer.format)
@@ -1165,8 +1429,8 @@ void DrawIndexedInstance(
     }
 
     int draw = 0;
-    uint8_t *pIB = (uint8_t*)pState->indexBuffer.pIndices;
-    pIB += (uint64_t)indexOffset * (uint64_t)indexSize;
+    uint8_t *pIBStart = (uint8_t*)pState->indexBuffer.pIndices;
+    pIBStart += (uint64_t)indexOffset * (uint64_t)indexSize;
 
     pState->topology = topology;
     pState->forceFront = false;
@@ -1179,39 +1443,48 @@ void DrawIndexedInstance(
         pState->forceFront = true;
     }
 
-    while (remainingIndices)
+    // Batches of instances are issued in order and each batch is split into index
+    // ranges, which keeps the split draws in API primitive order.
+    for (uint32_t instance = 0; instance < numInstances; instance += maxInstancesPerDraw)
     {
-        uint32_t numIndicesForDraw = (remainingIndices < maxIndicesPerDraw) ?
-        remainingIndices : maxIndicesPerDraw;
-
-        // When breaking up draw, we need to obtain new draw context for each iteration.
-        bool isSplitDraw = (draw > 0) ? true : false;
-        pDC = GetDrawContext(pContext, isSplitDraw);
-        InitDraw(pDC, isSplitDraw);
-
-        pDC->FeWork.type = DRAW;
-        pDC->FeWork.pfnWork = GetFEDrawFunc(
-            true,   // IsIndexed
-            pState->tsState.tsEnable,
-            pState->gsState.gsEnable,
-            pState->soState.soEnable,
-            pDC->pState->pfnProcessPrims != nullptr);
-        pDC->FeWork.desc.draw.pDC = pDC;
-        pDC->FeWork.desc.draw.numIndices = numIndicesForDraw;
-        pDC->FeWork.desc.draw.pIB = (int*)pIB;
-        pDC->FeWork.desc.draw.type = pDC->pState->state.indexBuffer.format;
-
-        pDC->FeWork.desc.draw.numInstances = numInstances;
-        pDC->FeWork.desc.draw.startInstance = startInstance;
-        pDC->FeWork.desc.draw.baseVertex = baseVertex;
-        pDC->FeWork.desc.draw.startPrimID = draw * primsPerDraw;
-
-        //enqueue DC
-        QueueDraw(pContext);
-
-        pIB += maxIndicesPerDraw * indexSize;
-        remainingIndices -= numIndicesForDraw;
-        draw++;
+        uint32_t numInstancesForDraw = std::min(numInstances - instance, maxInstancesPerDraw);
+
+        uint8_t *pIB = pIBStart;
+        uint32_t split = 0;
+        for (uint32_t index = 0; index + indicesOverlap < numIndices; index += maxIndicesPerDraw - indicesOverlap)
+        {
+            uint32_t numIndicesForDraw = std::min(numIndices - index, maxIndicesPerDraw);
+
+            // When breaking up draw, we need to obtain new draw context for each iteration.
+            bool isSplitDraw = (draw > 0) ? true : false;
+            pDC = GetDrawContext(pContext, isSplitDraw);
+            InitDraw(pDC, isSplitDraw);
+
+            pDC->FeWork.type = DRAW;
+            pDC->FeWork.pfnWork = GetFEDrawFunc(
+                true,   // IsIndexed
+                pState->tsState.tsEnable,
+                pState->gsState.gsEnable,
+                pState->soState.soEnable,
+                pDC->pState->pfnProcessPrims != nullptr);
+            pDC->FeWork.desc.draw.pDC = pDC;
+            pDC->FeWork.desc.draw.numIndices = numIndicesForDraw;
+            pDC->FeWork.desc.draw.pIB = (int*)pIB;
+            pDC->FeWork.desc.draw.type = pDC->pState->state.indexBuffer.format;
+
+            pDC->FeWork.desc.draw.numInstances = numInstancesForDraw;
+            pDC->FeWork.desc.draw.startInstance = startInstance;
+            pDC->FeWork.desc.draw.startInstanceID = instance;
+            pDC->FeWork.desc.draw.baseVertex = baseVertex;
+            pDC->FeWork.desc.draw.startPrimID = split * primsPerDraw;
+
+            //enqueue DC
+            QueueDraw(pContext);
+
+            pIB += (maxIndicesPerDraw - indicesOverlap) * indexSize;
+            split++;
+            draw++;
+        }
     }
 
     // restore culling state
@@ -1420,10 +1693,8 @@ VOID* SwrAllocDrawContextMemory(
 //////////////////////////////////////////////////////////////////////////
 /// @brief Returns pointer to SWR stats.
 /// @note The counters are atomically incremented by multiple threads.
-///       When calling this, you need to ensure all previous operations
-///       have completed.
-/// @todo If necessary, add a callback to avoid stalling the pipe to
-///       sample the counters.
+///       The snapshot is taken by a backend work item after all previous
+///       draws have completed; use SwrSync to learn when it has landed.
 /// @param hContext - Handle passed back from SwrCreateContext
 /// @param pStats - SWR will fill this out for caller.
 void SwrGetStats(
@@ -1446,6 +1717,37 @@ void SwrGetStats(
     QueueDraw(pContext);
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns arena memory statistics.
+/// @param hContext - Handle passed back from SwrCreateContext
+/// @param pStats - SWR will fill this out for caller.
+void SwrGetArenaStats(
+    HANDLE hContext,
+    SWR_ARENA_STATS* pStats)
+{
+    SWR_CONTEXT *pContext = GetContext(hContext);
+    pContext->pArenaBlockPool->GetStats(*pStats);
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns API thread statistics.
+/// @param hContext - Handle passed back from SwrCreateContext
+/// @param pStats - SWR will fill this out for caller.
+void SwrGetApiStats(
+    HANDLE hContext,
+    SWR_API_STATS* pStats)
+{
+    SWR_CONTEXT *pContext = GetContext(hContext);
+    *pStats = pContext->apiStats;
+
+    if (!KNOB_SINGLE_THREADED)
+    {
+        std::unique_lock<std::mutex> lock(pContext->WaitLock);
+        pStats->numWorkerWakes = pContext->NumWorkerWakes;
+        pStats->numWorkerParks = pContext->NumWorkerParks;
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief Enables stats counting
 /// @param hContext - Handle passed back from SwrCreateContext
@@ -1459,3 +1761,63 @@ void SwrEnableStats(
 
     pDC->pState->state.enableStats = enable;
 }
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Fills out the entry point table for this build of the core.
+/// @param api - SWR will fill this out for caller.
+void SwrGetInterface(
+    SWR_INTERFACE &api)
+{
+    api.pArchStr = KNOB_ARCH_STR;
+    api.simdWidth = KNOB_SIMD_WIDTH;
+    api.pGlobalKnobs = &g_GlobalKnobs;
+
+    api.pfnSwrCreateContext          = SwrCreateContext;
+    api.pfnSwrDestroyContext         = SwrDestroyContext;
+    api.pfnSwrSync                   = SwrSync;
+    api.pfnSwrWaitForIdle            = SwrWaitForIdle;
+    api.pfnSwrSetVertexBuffers       = SwrSetVertexBuffers;
+    api.pfnSwrSetIndexBuffer         = SwrSetIndexBuffer;
+    api.pfnSwrSetFetchFunc           = SwrSetFetchFunc;
+    api.pfnSwrSetSoFunc              = SwrSetSoFunc;
+    api.pfnSwrSetSoState             = SwrSetSoState;
+    api.pfnSwrSetSoBuffers           = SwrSetSoBuffers;
+    api.pfnSwrSetVertexFunc          = SwrSetVertexFunc;
+    api.pfnSwrSetFrontendState       = SwrSetFrontendState;
+    api.pfnSwrSetGsState             = SwrSetGsState;
+    api.pfnSwrSetGsFunc              = SwrSetGsFunc;
+    api.pfnSwrSetCsFunc              = SwrSetCsFunc;
+    api.pfnSwrSetTsState             = SwrSetTsState;
+    api.pfnSwrSetHsFunc              = SwrSetHsFunc;
+    api.pfnSwrSetDsFunc              = SwrSetDsFunc;
+    api.pfnSwrSetDepthStencilState   = SwrSetDepthStencilState;
+    api.pfnSwrSetBackendState        = SwrSetBackendState;
+    api.pfnSwrSetPixelShaderState    = SwrSetPixelShaderState;
+    api.pfnSwrSetBlendState          = SwrSetBlendState;
+    api.pfnSwrSetBlendFunc           = SwrSetBlendFunc;
+    api.pfnSwrSetLinkage             = SwrSetLinkage;
+    api.pfnSwrDraw                   = SwrDraw;
+    api.pfnSwrDrawInstanced          = SwrDrawInstanced;
+    api.pfnSwrDrawIndexed            = SwrDrawIndexed;
+    api.pfnSwrDrawIndexedInstanced   = SwrDrawIndexedInstanced;
+    api.pfnSwrInvalidateTiles        = SwrInvalidateTiles;
+    api.pfnSwrDispatch               = SwrDispatch;
+    api.pfnSwrStoreTiles             = SwrStoreTiles;
+    api.pfnSwrClearRenderTarget      = SwrClearRenderTarget;
+    api.pfnSwrSetRastState           = SwrSetRastState;
+    api.pfnSwrSetViewports           = SwrSetViewports;
+    api.pfnSwrSetScissorRects        = SwrSetScissorRects;
+    api.pfnSwrGetPrivateContextState = SwrGetPrivateContextState;
+    api.pfnSwrAllocDrawContextMemory = SwrAllocDrawContextMemory;
+    api.pfnSwrGetStats               = SwrGetStats;
+    api.pfnSwrGetArenaStats          = SwrGetArenaStats;
+    api.pfnSwrGetApiStats            = SwrGetApiStats;
+    api.pfnSwrEnableStats            = SwrEnableStats;
+
+    api.pfnLoadHotTile              = LoadHotTile;
+    api.pfnStoreHotTile             = StoreHotTile;
+    api.pfnStoreHotTileClear        = StoreHotTileClear;
+    api.pfnInitSimLoadTilesTable    = InitSimLoadTilesTable;
+    api.pfnInitSimStoreTilesTable   = InitSimStoreTilesTable;
+    api.pfnInitSimClearTilesTable   = InitSimClearTilesTable;
+}
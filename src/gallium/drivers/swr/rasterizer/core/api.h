@@ -72,10 +72,13 @@ typedef void(SWR_API *PFN_STORE_TILE)(HANDLE hPrivateContext, SWR_FORMAT srcForm
 /// @param renderTargetIndex - render target to store, can be color, depth or stencil
 /// @param x - destination x coordinate
 /// @param y - destination y coordinate
+/// @param renderTargetArrayIndex - render target array slice to write
 /// @param pClearColor - pointer to the hot tile's clear value
-typedef void(SWR_API *PFN_CLEAR_TILE)(HANDLE hPrivateContext,
+/// @return false if the surface can't be cleared this way, the core then
+///         fills the hot tile and stores it with PFN_STORE_TILE instead.
+typedef bool(SWR_API *PFN_CLEAR_TILE)(HANDLE hPrivateContext,
     SWR_RENDERTARGET_ATTACHMENT rtIndex,
-    uint32_t x, uint32_t y, const float* pClearColor);
+    uint32_t x, uint32_t y, uint32_t renderTargetArrayIndex, const float* pClearColor);
 
 //////////////////////////////////////////////////////////////////////////
 /// SWR_CREATECONTEXT_INFO
@@ -92,6 +95,10 @@ struct SWR_CREATECONTEXT_INFO
     PFN_LOAD_TILE pfnLoadTile;
     PFN_STORE_TILE pfnStoreTile;
     PFN_CLEAR_TILE pfnClearTile;
+
+    // Number of draws that can be queued before the API thread has to wait
+    // for the oldest one to retire. 0 uses KNOB_MAX_DRAWS_IN_FLIGHT.
+    uint32_t maxDrawsInFlight;
 };
 
 //////////////////////////////////////////////////////////////////////////
@@ -462,16 +469,35 @@ VOID* SWR_API SwrAllocDrawContextMemory(
     uint32_t align);
 
 //////////////////////////////////////////////////////////////////////////
-/// @brief Returns pointer to SWR stats.
-/// @note The counters are incremented by multiple threads.
-///       When calling this, you need to ensure all previous operations
-///       have completed.
+/// @brief Queues a snapshot of the SWR stats.
+/// @note The snapshot is written by a backend work item once all previous
+///       draws have completed.  Follow it with SwrSync to know when pStats
+///       is valid; pStats must stay alive until then.
 /// @param hContext - Handle passed back from SwrCreateContext
 /// @param pStats - SWR will fill this out for caller.
 void SWR_API SwrGetStats(
     HANDLE hContext,
     SWR_STATS* pStats);
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns arena memory statistics.
+/// @note Unlike SwrGetStats this isn't queued, the counters are read
+///       immediately.
+/// @param hContext - Handle passed back from SwrCreateContext
+/// @param pStats - SWR will fill this out for caller.
+void SWR_API SwrGetArenaStats(
+    HANDLE hContext,
+    SWR_ARENA_STATS* pStats);
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns API thread statistics.
+/// @note The counters are read immediately.
+/// @param hContext - Handle passed back from SwrCreateContext
+/// @param pStats - SWR will fill this out for caller.
+void SWR_API SwrGetApiStats(
+    HANDLE hContext,
+    SWR_API_STATS* pStats);
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief Enables stats counting
 /// @param hContext - Handle passed back from SwrCreateContext
@@ -480,4 +506,106 @@ void SWR_API SwrEnableStats(
     HANDLE hContext,
     bool enable);
 
+//////////////////////////////////////////////////////////////////////////
+/// Memory module. Loads, stores and clears hot tiles against the
+/// surfaces the driver keeps in its private context state.
+//////////////////////////////////////////////////////////////////////////
+void SWR_API LoadHotTile(
+    SWR_SURFACE_STATE *pSrcSurface,
+    SWR_FORMAT dstFormat,
+    SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
+    uint32_t x, uint32_t y, uint32_t renderTargetArrayIndex,
+    BYTE *pDstHotTile);
+
+void SWR_API StoreHotTile(
+    SWR_SURFACE_STATE *pDstSurface,
+    SWR_FORMAT srcFormat,
+    SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
+    uint32_t x, uint32_t y, uint32_t renderTargetArrayIndex,
+    BYTE *pSrcHotTile);
+
+bool SWR_API StoreHotTileClear(
+    SWR_SURFACE_STATE *pDstSurface,
+    SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
+    uint32_t x,
+    uint32_t y,
+    uint32_t renderTargetArrayIndex,
+    const float* pClearColor);
+
+void SWR_API InitSimLoadTilesTable();
+void SWR_API InitSimStoreTilesTable();
+void SWR_API InitSimClearTilesTable();
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Entry points of one ISA build of the core. The core is built
+///        once per ISA into its own library and the driver picks one at
+///        runtime, so it must only call into the core through this table.
+struct SWR_INTERFACE
+{
+    // ISA this build of the core was compiled for, e.g. "AVX2"
+    const char* pArchStr;
+    uint32_t simdWidth;
+
+    // Knobs of this build. Each build has its own copy of g_GlobalKnobs.
+    GlobalKnobs* pGlobalKnobs;
+
+    decltype(&SwrCreateContext)          pfnSwrCreateContext;
+    decltype(&SwrDestroyContext)         pfnSwrDestroyContext;
+    decltype(&SwrSync)                   pfnSwrSync;
+    decltype(&SwrWaitForIdle)            pfnSwrWaitForIdle;
+    decltype(&SwrSetVertexBuffers)       pfnSwrSetVertexBuffers;
+    decltype(&SwrSetIndexBuffer)         pfnSwrSetIndexBuffer;
+    decltype(&SwrSetFetchFunc)           pfnSwrSetFetchFunc;
+    decltype(&SwrSetSoFunc)              pfnSwrSetSoFunc;
+    decltype(&SwrSetSoState)             pfnSwrSetSoState;
+    decltype(&SwrSetSoBuffers)           pfnSwrSetSoBuffers;
+    decltype(&SwrSetVertexFunc)          pfnSwrSetVertexFunc;
+    decltype(&SwrSetFrontendState)       pfnSwrSetFrontendState;
+    decltype(&SwrSetGsState)             pfnSwrSetGsState;
+    decltype(&SwrSetGsFunc)              pfnSwrSetGsFunc;
+    decltype(&SwrSetCsFunc)              pfnSwrSetCsFunc;
+    decltype(&SwrSetTsState)             pfnSwrSetTsState;
+    decltype(&SwrSetHsFunc)              pfnSwrSetHsFunc;
+    decltype(&SwrSetDsFunc)              pfnSwrSetDsFunc;
+    decltype(&SwrSetDepthStencilState)   pfnSwrSetDepthStencilState;
+    decltype(&SwrSetBackendState)        pfnSwrSetBackendState;
+    decltype(&SwrSetPixelShaderState)    pfnSwrSetPixelShaderState;
+    decltype(&SwrSetBlendState)          pfnSwrSetBlendState;
+    decltype(&SwrSetBlendFunc)           pfnSwrSetBlendFunc;
+    decltype(&SwrSetLinkage)             pfnSwrSetLinkage;
+    decltype(&SwrDraw)                   pfnSwrDraw;
+    decltype(&SwrDrawInstanced)          pfnSwrDrawInstanced;
+    decltype(&SwrDrawIndexed)            pfnSwrDrawIndexed;
+    decltype(&SwrDrawIndexedInstanced)   pfnSwrDrawIndexedInstanced;
+    decltype(&SwrInvalidateTiles)        pfnSwrInvalidateTiles;
+    decltype(&SwrDispatch)               pfnSwrDispatch;
+    decltype(&SwrStoreTiles)             pfnSwrStoreTiles;
+    decltype(&SwrClearRenderTarget)      pfnSwrClearRenderTarget;
+    decltype(&SwrSetRastState)           pfnSwrSetRastState;
+    decltype(&SwrSetViewports)           pfnSwrSetViewports;
+    decltype(&SwrSetScissorRects)        pfnSwrSetScissorRects;
+    decltype(&SwrGetPrivateContextState) pfnSwrGetPrivateContextState;
+    decltype(&SwrAllocDrawContextMemory) pfnSwrAllocDrawContextMemory;
+    decltype(&SwrGetStats)               pfnSwrGetStats;
+    decltype(&SwrGetArenaStats)          pfnSwrGetArenaStats;
+    decltype(&SwrGetApiStats)            pfnSwrGetApiStats;
+    decltype(&SwrEnableStats)            pfnSwrEnableStats;
+
+    decltype(&LoadHotTile)            pfnLoadHotTile;
+    decltype(&StoreHotTile)           pfnStoreHotTile;
+    decltype(&StoreHotTileClear)      pfnStoreHotTileClear;
+    decltype(&InitSimLoadTilesTable)  pfnInitSimLoadTilesTable;
+    decltype(&InitSimStoreTilesTable) pfnInitSimStoreTilesTable;
+    decltype(&InitSimClearTilesTable) pfnInitSimClearTilesTable;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Fills out the entry point table for this build of the core.
+///        This is the only symbol exported by a core library.
+/// @param api - SWR will fill this out for caller.
+extern "C" SWR_VISIBLE void SWR_API SwrGetInterface(
+    SWR_INTERFACE &api);
+
+typedef void(SWR_API *PFN_SWR_GET_INTERFACE)(SWR_INTERFACE &api);
+
 #endif//__SWR_API_H__
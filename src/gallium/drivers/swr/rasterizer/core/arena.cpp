@@ -36,11 +36,221 @@
 
 #include <cmath>
 
-VOID Arena::Init()
+#if defined(__gnu_linux__) || defined(__linux__)
+#include <numa.h>
+#endif
+
+// block header is kept at the start of the allocation, in front of the block memory
+static const uint32_t ArenaBlockHeaderSize = AlignUp((uint32_t)sizeof(ArenaBlock), KNOB_SIMD_WIDTH*4);
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Sets up empty free lists for each NUMA node.
+/// @param numNumaNodes - Number of NUMA nodes blocks are cached for.
+/// @param pNumaNodeIds - OS node id of each node index, may be null for a single node.
+ArenaBlockPool::ArenaBlockPool(uint32_t numNumaNodes, const uint32_t* pNumaNodeIds) :
+    mNumNumaNodes(std::max(numNumaNodes, 1u)),
+    mNumBlocksInUse(0), mNumBlocksCached(0), mPeakBlocksInUse(0),
+    mNumBlockAllocs(0), mNumBlockFrees(0), mNumBlockReuses(0), mBytesAllocated(0)
+{
+    if (mNumNumaNodes > 1)
+    {
+        mNumaNodeIds.assign(pNumaNodeIds, pNumaNodeIds + mNumNumaNodes);
+    }
+
+#if defined(__gnu_linux__) || defined(__linux__)
+    // Only allocate from nodes the OS can actually allocate memory from.
+    if (mNumNumaNodes > 1 && numa_available() >= 0)
+    {
+        for (uint32_t id : mNumaNodeIds)
+        {
+            if (id > (uint32_t)numa_max_node())
+            {
+                mNumNumaNodes = 1;
+            }
+        }
+    }
+    else
+    {
+        mNumNumaNodes = 1;
+    }
+#endif
+
+    mFreeBlocks.resize(mNumNumaNodes * NUM_SIZE_CLASSES, nullptr);
+}
+
+ArenaBlockPool::~ArenaBlockPool()
+{
+    SWR_ASSERT(mNumBlocksInUse == 0, "Arena blocks still in use.");
+
+    for (ArenaBlock* pBlock : mFreeBlocks)
+    {
+        while (pBlock)
+        {
+            ArenaBlock* pNext = pBlock->pNext;
+            FreeBlock(pBlock);
+            pBlock = pNext;
+        }
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Hands out a block with at least size bytes, preferably a cached
+///        one from the given NUMA node.
+/// @param size - Minimum size of the block in bytes.
+/// @param numaNode - NUMA node of the requesting arena.
+ArenaBlock* ArenaBlockPool::AcquireBlock(uint32_t size, uint32_t numaNode)
+{
+    numaNode = numaNode % mNumNumaNodes;
+
+    uint32_t sizeClass = 0;
+    while (sizeClass < NUM_SIZE_CLASSES && (BASE_BLOCK_SIZE << sizeClass) < size)
+    {
+        sizeClass++;
+    }
+
+    std::lock_guard<std::mutex> lock(mLock);
+
+    ArenaBlock* pBlock = nullptr;
+    if (sizeClass < NUM_SIZE_CLASSES)
+    {
+        ArenaBlock*& pFree = mFreeBlocks[numaNode * NUM_SIZE_CLASSES + sizeClass];
+        if (pFree)
+        {
+            pBlock = pFree;
+            pFree = pBlock->pNext;
+            mNumBlocksCached--;
+            mNumBlockReuses++;
+        }
+    }
+
+    if (pBlock == nullptr)
+    {
+        pBlock = AllocBlock(sizeClass, size, numaNode);
+    }
+
+    mNumBlocksInUse++;
+    mPeakBlocksInUse = std::max(mPeakBlocksInUse, mNumBlocksInUse);
+
+    pBlock->offset = 0;
+    pBlock->pNext = nullptr;
+    return pBlock;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns a block to the pool.
+VOID ArenaBlockPool::ReleaseBlock(ArenaBlock* pBlock)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    SWR_ASSERT(mNumBlocksInUse > 0);
+    mNumBlocksInUse--;
+
+    if (pBlock->sizeClass < NUM_SIZE_CLASSES)
+    {
+        ArenaBlock*& pFree = mFreeBlocks[pBlock->numaNode * NUM_SIZE_CLASSES + pBlock->sizeClass];
+        pBlock->pNext = pFree;
+        pFree = pBlock;
+        mNumBlocksCached++;
+    }
+    else
+    {
+        FreeBlock(pBlock);
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Frees cached blocks that weren't needed to cover the peak block
+///        usage since the last trim. Largest blocks are freed first so a
+///        single spike doesn't keep its memory around.
+VOID ArenaBlockPool::Trim()
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    for (int32_t sizeClass = NUM_SIZE_CLASSES - 1; sizeClass >= 0; --sizeClass)
+    {
+        for (uint32_t node = 0; node < mNumNumaNodes; ++node)
+        {
+            ArenaBlock*& pFree = mFreeBlocks[node * NUM_SIZE_CLASSES + sizeClass];
+            while (pFree && (mNumBlocksInUse + mNumBlocksCached) > mPeakBlocksInUse)
+            {
+                ArenaBlock* pBlock = pFree;
+                pFree = pBlock->pNext;
+                mNumBlocksCached--;
+                FreeBlock(pBlock);
+            }
+        }
+    }
+
+    mPeakBlocksInUse = mNumBlocksInUse;
+}
+
+VOID ArenaBlockPool::GetStats(SWR_ARENA_STATS& stats)
+{
+    std::lock_guard<std::mutex> lock(mLock);
+
+    stats.numBlockAllocs = mNumBlockAllocs;
+    stats.numBlockFrees = mNumBlockFrees;
+    stats.numBlockReuses = mNumBlockReuses;
+    stats.numBlocksInUse = mNumBlocksInUse;
+    stats.numBlocksCached = mNumBlocksCached;
+    stats.bytesAllocated = mBytesAllocated;
+}
+
+ArenaBlock* ArenaBlockPool::AllocBlock(uint32_t sizeClass, uint32_t size, uint32_t numaNode)
+{
+    uint32_t blockSize = (sizeClass < NUM_SIZE_CLASSES) ?
+        (BASE_BLOCK_SIZE << sizeClass) : AlignUp(size, KNOB_SIMD_WIDTH*4);
+    uint32_t allocSize = blockSize + ArenaBlockHeaderSize;
+
+    VOID* pMem = nullptr;
+#if defined(__gnu_linux__) || defined(__linux__)
+    if (mNumNumaNodes > 1)
+    {
+        // numa allocations are page aligned which satisfies the block alignment.
+        pMem = numa_alloc_onnode(allocSize, mNumaNodeIds[numaNode]);
+    }
+    else
+#endif
+    {
+        pMem = _aligned_malloc(allocSize, KNOB_SIMD_WIDTH*4);    // Arena blocks are always simd byte aligned.
+    }
+    SWR_ASSERT(pMem != nullptr);
+
+    ArenaBlock* pBlock = (ArenaBlock*)pMem;
+    pBlock->pMem = (BYTE*)pMem + ArenaBlockHeaderSize;
+    pBlock->blockSize = blockSize;
+    pBlock->offset = 0;
+    pBlock->numaNode = numaNode;
+    pBlock->sizeClass = sizeClass;
+    pBlock->pNext = nullptr;
+
+    mNumBlockAllocs++;
+    mBytesAllocated += blockSize;
+
+    return pBlock;
+}
+
+VOID ArenaBlockPool::FreeBlock(ArenaBlock* pBlock)
+{
+    mNumBlockFrees++;
+    mBytesAllocated -= pBlock->blockSize;
+
+#if defined(__gnu_linux__) || defined(__linux__)
+    if (mNumNumaNodes > 1)
+    {
+        numa_free(pBlock, pBlock->blockSize + ArenaBlockHeaderSize);
+        return;
+    }
+#endif
+    _aligned_free(pBlock);
+}
+
+VOID Arena::Init(ArenaBlockPool* pPool, uint32_t numaNode)
 {
-    m_memUsed = 0;
     m_pCurBlock = nullptr;
     m_pUsedBlocks = nullptr;
+    m_pPool = pPool;
+    m_numaNode = numaNode;
 }
 
 VOID* Arena::AllocAligned(uint32_t size, uint32_t align)
@@ -50,7 +260,7 @@ VOID* Arena::AllocAligned(uint32_t size, uint32_t align)
         ArenaBlock* pCurBlock = m_pCurBlock;
         pCurBlock->offset = AlignUp(pCurBlock->offset, align);
 
-        if ((pCurBlock->offset + size) < pCurBlock->blockSize)
+        if ((pCurBlock->offset + size) <= pCurBlock->blockSize)
         {
             BYTE* pMem = (BYTE*)pCurBlock->pMem + pCurBlock->offset;
             pCurBlock->offset += size;
@@ -63,34 +273,11 @@ VOID* Arena::AllocAligned(uint32_t size, uint32_t align)
         m_pCurBlock = nullptr;
     }
 
-    static const uint32_t ArenaBlockSize = 1024*1024;
-    uint32_t defaultBlockSize = ArenaBlockSize;
-    if (m_pUsedBlocks == nullptr)
-    {
-        // First allocation after reset. Let's make the first block be the total
-        // memory allocated during last set of allocations prior to reset.
-        defaultBlockSize = std::max(m_memUsed, defaultBlockSize);
-        m_memUsed = 0;
-    }
-
-    uint32_t blockSize = std::max(size, defaultBlockSize);
-    blockSize = AlignUp(blockSize, KNOB_SIMD_WIDTH*4);
-
-    VOID *pMem = _aligned_malloc(blockSize, KNOB_SIMD_WIDTH*4);    // Arena blocks are always simd byte aligned.
-    SWR_ASSERT(pMem != nullptr);
-
-    m_pCurBlock = (ArenaBlock*)malloc(sizeof(ArenaBlock));
-    SWR_ASSERT(m_pCurBlock != nullptr);
-
-    if (m_pCurBlock != nullptr)
-    {
-        m_pCurBlock->pMem = pMem;
-        m_pCurBlock->blockSize = blockSize;
-        m_pCurBlock->offset = size;
-        m_memUsed += blockSize;
-    }
+    SWR_ASSERT(m_pPool != nullptr);
+    m_pCurBlock = m_pPool->AcquireBlock(size, m_numaNode);
+    m_pCurBlock->offset = size;
 
-    return pMem;
+    return m_pCurBlock->pMem;
 }
 
 VOID* Arena::Alloc(uint32_t size)
@@ -98,16 +285,18 @@ VOID* Arena::Alloc(uint32_t size)
     return AllocAligned(size, 1);
 }
 
-VOID Arena::Reset()
+//////////////////////////////////////////////////////////////////////////
+/// @brief Frees all allocations of the arena.
+///        A base sized current block is kept for the next set of
+///        allocations, all other blocks go back to the block pool.
+/// @param removeAll - Return every block, including the current one.
+VOID Arena::Reset(bool removeAll)
 {
     if (m_pCurBlock)
     {
         m_pCurBlock->offset = 0;
 
-        // If we needed to allocate used blocks then reset current.
-        // The next time we allocate we'll grow the current block
-        // to match all the memory allocated this for this frame.
-        if (m_pUsedBlocks)
+        if (removeAll || m_pCurBlock->blockSize != ArenaBlockPool::BASE_BLOCK_SIZE)
         {
             m_pCurBlock->pNext = m_pUsedBlocks;
             m_pUsedBlocks = m_pCurBlock;
@@ -120,7 +309,6 @@ VOID Arena::Reset()
         ArenaBlock* pBlock = m_pUsedBlocks;
         m_pUsedBlocks = pBlock->pNext;
 
-        _aligned_free(pBlock->pMem);
-        free(pBlock);
+        m_pPool->ReleaseBlock(pBlock);
     }
 }
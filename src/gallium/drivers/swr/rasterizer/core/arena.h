@@ -32,32 +32,94 @@
 ******************************************************************************/
 #pragma once
 
+#include <mutex>
+#include <vector>
+
+struct SWR_ARENA_STATS;
+
+//////////////////////////////////////////////////////////////////////////
+/// ArenaBlock
+/// @brief Chunk of memory handed out to arenas by the ArenaBlockPool.
+///        The block header lives at the start of the allocation.
+struct ArenaBlock
+{
+    VOID        *pMem;
+    uint32_t    blockSize;      // usable bytes at pMem
+    uint32_t    offset;
+    uint32_t    numaNode;       // node the memory was allocated on
+    uint32_t    sizeClass;
+    ArenaBlock  *pNext;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// ArenaBlockPool
+/// @brief Caches arena blocks per NUMA node so that resetting an arena
+///        doesn't free its memory just to allocate it again for the next
+///        draw. Blocks come in power of two multiples of the base block
+///        size. Cached blocks beyond the peak usage since the last Trim
+///        are returned to the system.
+class ArenaBlockPool
+{
+public:
+    static const uint32_t BASE_BLOCK_SIZE = 1024 * 1024;
+    static const uint32_t NUM_SIZE_CLASSES = 8;    // 1MB - 128MB, larger blocks aren't cached
+
+    ArenaBlockPool(uint32_t numNumaNodes, const uint32_t* pNumaNodeIds);
+    ~ArenaBlockPool();
+
+    ArenaBlock* AcquireBlock(uint32_t size, uint32_t numaNode);
+    VOID        ReleaseBlock(ArenaBlock* pBlock);
+    VOID        Trim();
+
+    VOID        GetStats(SWR_ARENA_STATS& stats);
+
+    void *operator new(size_t size)
+    {
+        return _aligned_malloc(size, 64);
+    }
+
+    void operator delete(void *p)
+    {
+        _aligned_free(p);
+    }
+
+private:
+    ArenaBlock* AllocBlock(uint32_t sizeClass, uint32_t size, uint32_t numaNode);
+    VOID        FreeBlock(ArenaBlock* pBlock);
+
+    std::mutex  mLock;
+
+    std::vector<ArenaBlock*> mFreeBlocks;   // free lists, indexed by numaNode * NUM_SIZE_CLASSES + sizeClass
+    std::vector<uint32_t> mNumaNodeIds;     // OS node id of each node index
+    uint32_t    mNumNumaNodes;
+
+    uint64_t    mNumBlocksInUse;
+    uint64_t    mNumBlocksCached;
+    uint64_t    mPeakBlocksInUse;   // since last Trim
+
+    uint64_t    mNumBlockAllocs;
+    uint64_t    mNumBlockFrees;
+    uint64_t    mNumBlockReuses;
+    uint64_t    mBytesAllocated;
+};
+
 class Arena
 {
 public:
-    Arena() : m_pCurBlock(nullptr), m_pUsedBlocks(nullptr), m_memUsed(0) { }
+    Arena() : m_pCurBlock(nullptr), m_pUsedBlocks(nullptr), m_pPool(nullptr), m_numaNode(0) { }
     ~Arena() { }
 
-    VOID    Init();
+    VOID    Init(ArenaBlockPool* pPool, uint32_t numaNode = 0);
 
     VOID*   AllocAligned(uint32_t  size, uint32_t  align);
     VOID*   Alloc(uint32_t  size);
-    VOID    Reset();
+    VOID    Reset(bool removeAll = false);
 
 private:
 
-    struct ArenaBlock
-    {
-        ArenaBlock() : pMem(nullptr), blockSize(0), pNext(nullptr) {}
-
-        VOID        *pMem;
-        uint32_t    blockSize;
-        uint32_t    offset;
-        ArenaBlock *pNext;
-    };
-
     ArenaBlock      *m_pCurBlock;
     ArenaBlock      *m_pUsedBlocks;
 
-    uint32_t        m_memUsed;      // total bytes allocated since last reset.
+    ArenaBlockPool  *m_pPool;
+    uint32_t        m_numaNode;     // node to allocate blocks from
 };
@@ -112,39 +112,48 @@ void ProcessSyncBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTile, voi
 void ProcessQueryStatsBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTile, void *pUserData)
 {
     QUERY_DESC* pQueryDesc = (QUERY_DESC*)pUserData;
-    SWR_STATS* pStats = pQueryDesc->pStats;
     SWR_CONTEXT *pContext = pDC->pContext;
 
-    SWR_ASSERT(pStats != nullptr);
+    SWR_ASSERT(pQueryDesc->pStats != nullptr);
+
+    // Sum into a local copy and store the snapshot whole, so the caller can
+    // reuse its buffer for a later query without clearing it first.
+    SWR_STATS stats = {};
+    SWR_STATS* pStats = &stats;
 
     for (uint32_t i = 0; i < pContext->NumWorkerThreads; ++i)
     {
-        pStats->DepthPassCount += pContext->stats[i].DepthPassCount;
-
-        pStats->IaVertices    += pContext->stats[i].IaVertices;
-        pStats->IaPrimitives  += pContext->stats[i].IaPrimitives;
-        pStats->VsInvocations += pContext->stats[i].VsInvocations;
-        pStats->HsInvocations += pContext->stats[i].HsInvocations;
-        pStats->DsInvocations += pContext->stats[i].DsInvocations;
-        pStats->GsInvocations += pContext->stats[i].GsInvocations;
-        pStats->PsInvocations += pContext->stats[i].PsInvocations;
-        pStats->CInvocations  += pContext->stats[i].CInvocations;
-        pStats->CsInvocations += pContext->stats[i].CsInvocations;
-        pStats->CPrimitives   += pContext->stats[i].CPrimitives;
-        pStats->GsPrimitives  += pContext->stats[i].GsPrimitives;
+        pStats->DepthPassCount += pContext->workerStats[i].stats.DepthPassCount;
+
+        pStats->IaVertices    += pContext->workerStats[i].stats.IaVertices;
+        pStats->IaPrimitives  += pContext->workerStats[i].stats.IaPrimitives;
+        pStats->VsInvocations += pContext->workerStats[i].stats.VsInvocations;
+        pStats->HsInvocations += pContext->workerStats[i].stats.HsInvocations;
+        pStats->DsInvocations += pContext->workerStats[i].stats.DsInvocations;
+        pStats->GsInvocations += pContext->workerStats[i].stats.GsInvocations;
+        pStats->PsInvocations += pContext->workerStats[i].stats.PsInvocations;
+        pStats->CInvocations  += pContext->workerStats[i].stats.CInvocations;
+        pStats->CsInvocations += pContext->workerStats[i].stats.CsInvocations;
+        pStats->CPrimitives   += pContext->workerStats[i].stats.CPrimitives;
+        pStats->GsPrimitives  += pContext->workerStats[i].stats.GsPrimitives;
+
+        pStats->DepthBoundsRejectedMacroTiles  += pContext->workerStats[i].stats.DepthBoundsRejectedMacroTiles;
+        pStats->DepthBoundsRejectedRasterTiles += pContext->workerStats[i].stats.DepthBoundsRejectedRasterTiles;
 
         for (uint32_t stream = 0; stream < MAX_SO_STREAMS; ++stream)
         {
-            pStats->SoWriteOffset[stream] += pContext->stats[i].SoWriteOffset[stream];
+            pStats->SoWriteOffset[stream] += pContext->workerStats[i].stats.SoWriteOffset[stream];
 
             /// @note client is required to provide valid write offset before every draw, so we clear
             /// out the contents of the write offset when storing stats
-            pContext->stats[i].SoWriteOffset[stream] = 0;
+            pContext->workerStats[i].stats.SoWriteOffset[stream] = 0;
 
-            pStats->SoPrimStorageNeeded[stream] += pContext->stats[i].SoPrimStorageNeeded[stream];
-            pStats->SoNumPrimsWritten[stream] += pContext->stats[i].SoNumPrimsWritten[stream];
+            pStats->SoPrimStorageNeeded[stream] += pContext->workerStats[i].stats.SoPrimStorageNeeded[stream];
+            pStats->SoNumPrimsWritten[stream] += pContext->workerStats[i].stats.SoNumPrimsWritten[stream];
         }
     }
+
+    *pQueryDesc->pStats = stats;
 }
 
 template<SWR_FORMAT format>
@@ -231,6 +240,7 @@ INLINE void ClearMacroTile(DRAW_CONTEXT *pDC, SWR_RENDERTARGET_ATTACHMENT rt, ui
                 ClearRasterTile<format>(pRasterTile, vClear);
                 pRasterTile += rasterTileSampleStep;
             }
+            pHotTile->clearMask &= ~HotTileMgr::GetRasterTileBit(x, y);
         }
         pRasterTileRow += macroTileRowStep;
     }
@@ -300,7 +310,18 @@ void ProcessClearBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTile, vo
             clearData[2] = *(DWORD*)&clearFloat[2];
             clearData[3] = *(DWORD*)&clearFloat[3];
 
-            PFN_CLEAR_TILES pfnClearTiles = sClearTilesTable[KNOB_COLOR_HOT_TILE_FORMAT];
+            // clear in the format the hot tile already has, unless it holds nothing yet
+            SWR_CONTEXT *pContext = pDC->pContext;
+            uint32_t numSamples = GetNumSamples(pDC->pState->state.rastState.sampleCount);
+            HOTTILE *pHotTile = pContext->pHotTileMgr->GetHotTile(pContext, pDC, macroTile, SWR_ATTACHMENT_COLOR0, true, numSamples);
+            if (pHotTile->state == HOTTILE_INVALID)
+            {
+                const API_STATE& state = GetApiState(pDC);
+                pHotTile->format = HotTileMgr::GetColorHotTileFormat(state.rastState.colorHotTileFormat[0],
+                    state.blendState.renderTarget[0].colorBlendEnable);
+            }
+
+            PFN_CLEAR_TILES pfnClearTiles = sClearTilesTable[pHotTile->format];
             SWR_ASSERT(pfnClearTiles != nullptr);
 
             pfnClearTiles(pDC, SWR_ATTACHMENT_COLOR0, macroTile, clearData);
@@ -314,6 +335,12 @@ void ProcessClearBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTile, vo
             SWR_ASSERT(pfnClearTiles != nullptr);
 
             pfnClearTiles(pDC, SWR_ATTACHMENT_DEPTH, macroTile, clearData);
+
+            HOTTILE *pHotTile = pDC->pContext->pHotTileMgr->GetHotTile(pDC->pContext, pDC, macroTile, SWR_ATTACHMENT_DEPTH, false);
+            if (pHotTile)
+            {
+                pHotTile->pDepthBounds->Set(pClear->clearDepth, pClear->clearDepth);
+            }
         }
 
         if (pClear->flags.mask & SWR_CLEAR_STENCIL)
@@ -340,21 +367,6 @@ void ProcessStoreTileBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTile
 #ifdef KNOB_ENABLE_RDTSC
     uint32_t numTiles = 0;
 #endif
-    SWR_FORMAT srcFormat;
-    switch (pDesc->attachment)
-    {
-    case SWR_ATTACHMENT_COLOR0:
-    case SWR_ATTACHMENT_COLOR1:
-    case SWR_ATTACHMENT_COLOR2:
-    case SWR_ATTACHMENT_COLOR3:
-    case SWR_ATTACHMENT_COLOR4:
-    case SWR_ATTACHMENT_COLOR5:
-    case SWR_ATTACHMENT_COLOR6:
-    case SWR_ATTACHMENT_COLOR7: srcFormat = KNOB_COLOR_HOT_TILE_FORMAT; break;
-    case SWR_ATTACHMENT_DEPTH: srcFormat = KNOB_DEPTH_HOT_TILE_FORMAT; break;
-    case SWR_ATTACHMENT_STENCIL: srcFormat = KNOB_STENCIL_HOT_TILE_FORMAT; break;
-    default: SWR_ASSERT(false, "Unknown attachment: %d", pDesc->attachment); srcFormat = KNOB_COLOR_HOT_TILE_FORMAT; break;
-    }
 
     uint32_t x, y;
     MacroTileMgr::getTileIndices(macroTile, x, y);
@@ -363,13 +375,10 @@ void ProcessStoreTileBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTile
     HOTTILE *pHotTile = pContext->pHotTileMgr->GetHotTile(pContext, pDC, macroTile, pDesc->attachment, false);
     if (pHotTile)
     {
-        // clear if clear is pending (i.e., not rendered to), then mark as dirty for store.
+        // clear is pending (i.e., not rendered to), mark as dirty for store.
         if (pHotTile->state == HOTTILE_CLEAR)
         {
-            PFN_CLEAR_TILES pfnClearTiles = sClearTilesTable[srcFormat];
-            SWR_ASSERT(pfnClearTiles != nullptr);
-
-            pfnClearTiles(pDC, pDesc->attachment, macroTile, pHotTile->clearData);
+            HotTileMgr::DeferClear(pHotTile);
         }
 
         if (pHotTile->state == HOTTILE_DIRTY || pDesc->postStoreTileState == (SWR_TILE_STATE)HOTTILE_DIRTY)
@@ -377,8 +386,21 @@ void ProcessStoreTileBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTile
             int destX = KNOB_MACROTILE_X_DIM * x;
             int destY = KNOB_MACROTILE_Y_DIM * y;
 
-            pContext->pfnStoreTile(GetPrivateState(pDC), srcFormat,
-                pDesc->attachment, destX, destY, pHotTile->renderTargetArrayIndex, pHotTile->pBuffer);
+            // nothing was drawn since the clear, let the driver write the clear value
+            // straight to the surface. The hot tile keeps its pending clear.
+            bool stored = false;
+            if (pHotTile->clearMask == HotTileMgr::ALL_RASTER_TILES && pContext->pfnClearTile != nullptr)
+            {
+                stored = pContext->pfnClearTile(GetPrivateState(pDC), pDesc->attachment,
+                    destX, destY, pHotTile->renderTargetArrayIndex, (const float*)pHotTile->clearData);
+            }
+
+            if (!stored)
+            {
+                HotTileMgr::ResolveClear(pHotTile, pDesc->attachment, pHotTile->clearMask);
+                pContext->pfnStoreTile(GetPrivateState(pDC), pHotTile->format,
+                    pDesc->attachment, destX, destY, pHotTile->renderTargetArrayIndex, pHotTile->pBuffer);
+            }
         }
         
 
@@ -404,6 +426,7 @@ void ProcessInvalidateTilesBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t mac
             if (pHotTile)
             {
                 pHotTile->state = HOTTILE_INVALID;
+                pHotTile->clearMask = 0;
             }
         }
     }
@@ -449,7 +472,86 @@ simdmask ComputeUserClipMask(uint8_t clipMask, float* pUserClipBuffer, simdscala
     return _simd_movemask_ps(vClipMask);
 }
 
-template<uint32_t MaxRT, SWR_MULTISAMPLE_COUNT sampleCount>
+//////////////////////////////////////////////////////////////////////////
+/// @brief Blends the pixel shader output of a render target with its hot
+///        tile and writes the covered pixels back, honoring the write mask.
+/// @param hotTileFormat - format of the render target's hot tile, either
+///        KNOB_COLOR_HOT_TILE_FORMAT or KNOB_COMPACT_COLOR_HOT_TILE_FORMAT.
+/// @param pColorSample - simd tile of the current sample in the hot tile.
+INLINE void OutputMerger(const API_STATE& state, SWR_PS_CONTEXT &psContext, uint32_t rt, SWR_FORMAT hotTileFormat,
+    uint8_t *pColorSample, simdscalari mask)
+{
+    const SWR_BLEND_STATE *pBlendState = &state.blendState;
+    const SWR_RENDER_TARGET_BLEND_STATE *pRTBlend = &pBlendState->renderTarget[rt];
+
+    if (hotTileFormat == KNOB_COMPACT_COLOR_HOT_TILE_FORMAT)
+    {
+        // only unblended render targets get a compact hot tile, see
+        // HotTileMgr::GetColorHotTileFormat
+        SWR_ASSERT(!pRTBlend->colorBlendEnable);
+
+        // merge, then write back the whole simd tile. untouched values convert
+        // back to the bits they were loaded from.
+        simdvector dst;
+        LoadSOA<KNOB_COMPACT_COLOR_HOT_TILE_FORMAT>(pColorSample, dst);
+        simdscalar vMask = _simd_castsi_ps(mask);
+        if (!pRTBlend->writeDisableRed)
+        {
+            dst.x = _simd_blendv_ps(dst.x, psContext.shaded[rt].x, vMask);
+        }
+        if (!pRTBlend->writeDisableGreen)
+        {
+            dst.y = _simd_blendv_ps(dst.y, psContext.shaded[rt].y, vMask);
+        }
+        if (!pRTBlend->writeDisableBlue)
+        {
+            dst.z = _simd_blendv_ps(dst.z, psContext.shaded[rt].z, vMask);
+        }
+        if (!pRTBlend->writeDisableAlpha)
+        {
+            dst.w = _simd_blendv_ps(dst.w, psContext.shaded[rt].w, vMask);
+        }
+
+        // same clamp, scale and round to nearest even as StoreTile applies to a
+        // float hot tile, in full and partial raster tiles alike, so the surface
+        // gets the same bits
+        StoreSOA<KNOB_COMPACT_COLOR_HOT_TILE_FORMAT>(dst, pColorSample);
+        return;
+    }
+
+    SWR_ASSERT(hotTileFormat == KNOB_COLOR_HOT_TILE_FORMAT);
+
+    // Blend outputs
+    if (pRTBlend->colorBlendEnable)
+    {
+        state.pfnBlendFunc[rt](pBlendState, psContext.shaded[rt], psContext.shaded[1], pColorSample, psContext.shaded[rt]);
+    }
+
+    ///@todo can only use maskstore fast path if bpc is 32. Assuming hot tile is RGBA32_FLOAT.
+    static_assert(KNOB_COLOR_HOT_TILE_FORMAT == R32G32B32A32_FLOAT, "Unsupported hot tile format");
+
+    const uint32_t simd = KNOB_SIMD_WIDTH * sizeof(float);
+
+    // store with color mask
+    if (!pRTBlend->writeDisableRed)
+    {
+        _simd_maskstore_ps((float*)pColorSample, mask, psContext.shaded[rt].x);
+    }
+    if (!pRTBlend->writeDisableGreen)
+    {
+        _simd_maskstore_ps((float*)(pColorSample + simd), mask, psContext.shaded[rt].y);
+    }
+    if (!pRTBlend->writeDisableBlue)
+    {
+        _simd_maskstore_ps((float*)(pColorSample + simd * 2), mask, psContext.shaded[rt].z);
+    }
+    if (!pRTBlend->writeDisableAlpha)
+    {
+        _simd_maskstore_ps((float*)(pColorSample + simd * 3), mask, psContext.shaded[rt].w);
+    }
+}
+
+template<uint32_t MaxRT, SWR_MULTISAMPLE_COUNT sampleCount, bool StatsEnabledT>
 void BackendSampleRate(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t x, uint32_t y, SWR_TRIANGLE_DESC &work, RenderOutputBuffers &renderBuffers)
 {
     RDTSC_START(BESetup);
@@ -458,7 +560,6 @@ void BackendSampleRate(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t x, uint32_
     const API_STATE& state = GetApiState(pDC);
     const SWR_RASTSTATE& rastState = state.rastState;
     const SWR_PS_STATE *pPSState = &state.psState;
-    const SWR_BLEND_STATE *pBlendState = &state.blendState;
 
     // broadcast scalars
     simdscalar vIa = _simd_broadcast_ss(&work.I[0]);
@@ -480,9 +581,11 @@ void BackendSampleRate(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t x, uint32_
     simdscalar vCOneOverW = _simd_broadcast_ss(&work.OneOverW[2]);
 
     uint8_t *pColorBase[SWR_NUM_RENDERTARGETS];
+    uint32_t colorSimdStep[SWR_NUM_RENDERTARGETS];
     for(uint32_t rt = 0; rt <= MaxRT; ++rt)
     {
         pColorBase[rt] = renderBuffers.pColor[rt];
+        colorSimdStep[rt] = renderBuffers.colorSampleStep[rt] / (KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM / KNOB_SIMD_WIDTH);
     }
     uint8_t *pDepthBase = renderBuffers.pDepth, *pStencilBase = renderBuffers.pStencil;
     RDTSC_STOP(BESetup, 0, 0);
@@ -619,9 +722,7 @@ void BackendSampleRate(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t x, uint32_
                         }
                     }
 
-                    uint32_t statMask = _simd_movemask_ps(depthPassMask);
-                    uint32_t statCount = _mm_popcnt_u32(statMask);
-                    UPDATE_STAT(DepthPassCount, statCount);
+                    UPDATE_STAT_T(DepthPassCount, _mm_popcnt_u32(_simd_movemask_ps(depthPassMask)));
 
                     simdscalari mask = _simd_castps_si(depthPassMask);
 
@@ -636,7 +737,6 @@ void BackendSampleRate(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t x, uint32_
                         }
                     }
 
-                    uint32_t rasterTileColorOffset = MultisampleTraits<sampleCount>::RasterTileColorOffset(sample);
                     for (uint32_t rt = 0; rt <= MaxRT; ++rt)
                     {
                         uint8_t *pColorSample;
@@ -646,39 +746,10 @@ void BackendSampleRate(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t x, uint32_
                         }
                         else
                         {
-                            pColorSample = pColorBase[rt] + rasterTileColorOffset;
-                        }
-
-                        const SWR_RENDER_TARGET_BLEND_STATE *pRTBlend = &pBlendState->renderTarget[rt];
-
-                        // Blend outputs
-                        if (pRTBlend->colorBlendEnable)
-                        {
-                            state.pfnBlendFunc[rt](pBlendState, psContext.shaded[rt], psContext.shaded[1], pColorSample, psContext.shaded[rt]);
+                            pColorSample = pColorBase[rt] + sample * renderBuffers.colorSampleStep[rt];
                         }
 
-                        ///@todo can only use maskstore fast path if bpc is 32. Assuming hot tile is RGBA32_FLOAT.
-                        static_assert(KNOB_COLOR_HOT_TILE_FORMAT == R32G32B32A32_FLOAT, "Unsupported hot tile format");
-
-                        const uint32_t simd = KNOB_SIMD_WIDTH * sizeof(float);
-
-                        // store with color mask
-                        if (!pRTBlend->writeDisableRed)
-                        {
-                            _simd_maskstore_ps((float*)pColorSample, mask, psContext.shaded[rt].x);
-                        }
-                        if (!pRTBlend->writeDisableGreen)
-                        {
-                            _simd_maskstore_ps((float*)(pColorSample + simd), mask, psContext.shaded[rt].y);
-                        }
-                        if (!pRTBlend->writeDisableBlue)
-                        {
-                            _simd_maskstore_ps((float*)(pColorSample + simd * 2), mask, psContext.shaded[rt].z);
-                        }
-                        if (!pRTBlend->writeDisableAlpha)
-                        {
-                            _simd_maskstore_ps((float*)(pColorSample + simd * 3), mask, psContext.shaded[rt].w);
-                        }
+                        OutputMerger(state, psContext, rt, renderBuffers.colorFormat[rt], pColorSample, mask);
                     }
 
                     RDTSC_STOP(BEOutputMerger, 0, 0);
@@ -691,14 +762,14 @@ void BackendSampleRate(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t x, uint32_
 
             for (uint32_t rt = 0; rt <= MaxRT; ++rt)
             {
-                pColorBase[rt] += (KNOB_SIMD_WIDTH * FormatTraits<KNOB_COLOR_HOT_TILE_FORMAT>::bpp) / 8;
+                pColorBase[rt] += colorSimdStep[rt];
             }
             RDTSC_STOP(BEEndTile, 0, 0);
         }
     }
 }
 
-template<uint32_t MaxRT, SWR_MULTISAMPLE_COUNT sampleCount>
+template<uint32_t MaxRT, SWR_MULTISAMPLE_COUNT sampleCount, bool StatsEnabledT>
 void BackendPixelRate(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t x, uint32_t y, SWR_TRIANGLE_DESC &work, RenderOutputBuffers &renderBuffers)
 {
     RDTSC_START(BESetup);
@@ -707,7 +778,6 @@ void BackendPixelRate(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t x, uint32_t
     const API_STATE& state = GetApiState(pDC);
     const SWR_RASTSTATE& rastState = state.rastState;
     const SWR_PS_STATE *pPSState = &state.psState;
-    const SWR_BLEND_STATE *pBlendState = &state.blendState;
 
     // broadcast scalars
     simdscalar vIa = _simd_broadcast_ss(&work.I[0]);
@@ -729,9 +799,11 @@ void BackendPixelRate(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t x, uint32_t
     simdscalar vCOneOverW = _simd_broadcast_ss(&work.OneOverW[2]);
 
     uint8_t *pColorBase[SWR_NUM_RENDERTARGETS];
+    uint32_t colorSimdStep[SWR_NUM_RENDERTARGETS];
     for(uint32_t rt = 0; rt <= MaxRT; ++rt)
     {
         pColorBase[rt] = renderBuffers.pColor[rt];
+        colorSimdStep[rt] = renderBuffers.colorSampleStep[rt] / (KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM / KNOB_SIMD_WIDTH);
     }
     uint8_t *pDepthBase = renderBuffers.pDepth, *pStencilBase = renderBuffers.pStencil;
     RDTSC_STOP(BESetup, 0, 0);
@@ -857,9 +929,7 @@ void BackendPixelRate(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t x, uint32_t
 
                 anyDepthSamplePassed = _simd_or_ps(anyDepthSamplePassed, depthPassMask[sample]);
 
-                uint32_t statMask = _simd_movemask_ps(depthPassMask[sample]);
-                uint32_t statCount = _mm_popcnt_u32(statMask);
-                UPDATE_STAT(DepthPassCount, statCount);
+                UPDATE_STAT_T(DepthPassCount, _mm_popcnt_u32(_simd_movemask_ps(depthPassMask[sample])));
             }
 
             // if we didn't have to execute the PS early, and at least 1 sample passed the depth test, run the PS
@@ -911,41 +981,11 @@ void BackendPixelRate(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t x, uint32_t
                     continue;
                 }
                 simdscalari mask = _simd_castps_si(depthPassMask[sample]);
-                uint32_t rasterTileColorOffset = MultisampleTraits<sampleCount>::RasterTileColorOffset(sample);
                 for(uint32_t rt = 0; rt <= MaxRT; ++rt)
                 {
-                    uint8_t *pColorSample = pColorBase[rt] + rasterTileColorOffset;
-
-                    const SWR_RENDER_TARGET_BLEND_STATE *pRTBlend = &pBlendState->renderTarget[rt];
-
-                    // Blend outputs
-                    if(pRTBlend->colorBlendEnable)
-                    {
-                        state.pfnBlendFunc[rt](pBlendState, psContext.shaded[rt], psContext.shaded[1], pColorSample, psContext.shaded[rt]);
-                    }
-
-                    ///@todo can only use maskstore fast path if bpc is 32. Assuming hot tile is RGBA32_FLOAT.
-                    static_assert(KNOB_COLOR_HOT_TILE_FORMAT == R32G32B32A32_FLOAT, "Unsupported hot tile format");
-
-                    const uint32_t simd = KNOB_SIMD_WIDTH * sizeof(float);
+                    uint8_t *pColorSample = pColorBase[rt] + sample * renderBuffers.colorSampleStep[rt];
 
-                    // store with color mask
-                    if(!pRTBlend->writeDisableRed)
-                    {
-                        _simd_maskstore_ps((float*)pColorSample, mask, psContext.shaded[rt].x);
-                    }
-                    if(!pRTBlend->writeDisableGreen)
-                    {
-                        _simd_maskstore_ps((float*)(pColorSample + simd), mask, psContext.shaded[rt].y);
-                    }
-                    if(!pRTBlend->writeDisableBlue)
-                    {
-                        _simd_maskstore_ps((float*)(pColorSample + simd * 2), mask, psContext.shaded[rt].z);
-                    }
-                    if(!pRTBlend->writeDisableAlpha)
-                    {
-                        _simd_maskstore_ps((float*)(pColorSample + simd * 3), mask, psContext.shaded[rt].w);
-                    }
+                    OutputMerger(state, psContext, rt, renderBuffers.colorFormat[rt], pColorSample, mask);
                 }
                 RDTSC_STOP(BEOutputMerger, 0, 0);
             }
@@ -962,13 +1002,14 @@ Endtile:
 
             for(uint32_t rt = 0; rt <= MaxRT; ++rt)
             {
-                pColorBase[rt] += (KNOB_SIMD_WIDTH * FormatTraits<KNOB_COLOR_HOT_TILE_FORMAT>::bpp) / 8;
+                pColorBase[rt] += colorSimdStep[rt];
             }
             RDTSC_STOP(BEEndTile, 0, 0);
         }
     }
 }
 // optimized backend flow with NULL PS
+template<bool StatsEnabledT>
 void BackendNullPS(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t x, uint32_t y, SWR_TRIANGLE_DESC &work, RenderOutputBuffers &renderBuffers)
 {
     RDTSC_START(BESetup);
@@ -1027,9 +1068,7 @@ void BackendNullPS(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t x, uint32_t y,
                                       psContext.vZ, pDepthBase, depthPassMask, pStencilBase, false);
                 RDTSC_STOP(BEEarlyDepthTest, 0, 0);
 
-                uint32_t statMask = _simd_movemask_ps(depthPassMask);
-                uint32_t statCount = _mm_popcnt_u32(statMask);
-                UPDATE_STAT(DepthPassCount, statCount);
+                UPDATE_STAT_T(DepthPassCount, _mm_popcnt_u32(_simd_movemask_ps(depthPassMask)));
             }
             coverageMask >>= (SIMD_TILE_Y_DIM * SIMD_TILE_X_DIM);
             pDepthBase += (KNOB_SIMD_WIDTH * FormatTraits<KNOB_DEPTH_HOT_TILE_FORMAT>::bpp) / 8;
@@ -1049,102 +1088,46 @@ void InitClearTilesTable()
     sClearTilesTable[R8_UINT] = ClearMacroTile<R8_UINT>;
 }
 
-// initialize backend function tables
-PFN_BACKEND_FUNC gSingleSampleBackendTable[] = {
-    BackendSampleRate<0, SWR_MULTISAMPLE_1X>,
-    BackendSampleRate<1, SWR_MULTISAMPLE_1X>,
-    BackendSampleRate<2, SWR_MULTISAMPLE_1X>,
-    BackendSampleRate<3, SWR_MULTISAMPLE_1X>,
-    BackendSampleRate<4, SWR_MULTISAMPLE_1X>,
-    BackendSampleRate<5, SWR_MULTISAMPLE_1X>,
-    BackendSampleRate<6, SWR_MULTISAMPLE_1X>,
-    BackendSampleRate<7, SWR_MULTISAMPLE_1X>,
+// one entry per max RT slot used by the PS
+#define BACKEND_RT_FUNCS(func, sampleCount, stats) \
+    {                                              \
+        func<0, sampleCount, stats>,               \
+        func<1, sampleCount, stats>,               \
+        func<2, sampleCount, stats>,               \
+        func<3, sampleCount, stats>,               \
+        func<4, sampleCount, stats>,               \
+        func<5, sampleCount, stats>,               \
+        func<6, sampleCount, stats>,               \
+        func<7, sampleCount, stats>,               \
+    }
+
+#define BACKEND_MSAA_FUNCS(func, stats)                        \
+    {                                                          \
+        BACKEND_RT_FUNCS(func, SWR_MULTISAMPLE_2X, stats),     \
+        BACKEND_RT_FUNCS(func, SWR_MULTISAMPLE_4X, stats),     \
+        BACKEND_RT_FUNCS(func, SWR_MULTISAMPLE_8X, stats),     \
+        BACKEND_RT_FUNCS(func, SWR_MULTISAMPLE_16X, stats),    \
+    }
+
+// initialize backend function tables, indexed by whether stats are enabled
+PFN_BACKEND_FUNC gNullPSBackendTable[2] = {
+    BackendNullPS<false>,
+    BackendNullPS<true>,
+};
+
+PFN_BACKEND_FUNC gSingleSampleBackendTable[2][SWR_NUM_RENDERTARGETS] = {
+    BACKEND_RT_FUNCS(BackendSampleRate, SWR_MULTISAMPLE_1X, false),
+    BACKEND_RT_FUNCS(BackendSampleRate, SWR_MULTISAMPLE_1X, true),
 };
 
 // MSAA per sample shading rate
-PFN_BACKEND_FUNC gSampleRateBackendTable[SWR_MULTISAMPLE_TYPE_MAX-1][SWR_NUM_RENDERTARGETS] ={
-    {
-        BackendSampleRate<0, SWR_MULTISAMPLE_2X>,
-        BackendSampleRate<1, SWR_MULTISAMPLE_2X>,
-        BackendSampleRate<2, SWR_MULTISAMPLE_2X>,
-        BackendSampleRate<3, SWR_MULTISAMPLE_2X>,
-        BackendSampleRate<4, SWR_MULTISAMPLE_2X>,
-        BackendSampleRate<5, SWR_MULTISAMPLE_2X>,
-        BackendSampleRate<6, SWR_MULTISAMPLE_2X>,
-        BackendSampleRate<7, SWR_MULTISAMPLE_2X>,
-    },
-    {
-        BackendSampleRate<0, SWR_MULTISAMPLE_4X>,
-        BackendSampleRate<1, SWR_MULTISAMPLE_4X>,
-        BackendSampleRate<2, SWR_MULTISAMPLE_4X>,
-        BackendSampleRate<3, SWR_MULTISAMPLE_4X>,
-        BackendSampleRate<4, SWR_MULTISAMPLE_4X>,
-        BackendSampleRate<5, SWR_MULTISAMPLE_4X>,
-        BackendSampleRate<6, SWR_MULTISAMPLE_4X>,
-        BackendSampleRate<7, SWR_MULTISAMPLE_4X>,
-    },
-    {
-        BackendSampleRate<0, SWR_MULTISAMPLE_8X>,
-        BackendSampleRate<1, SWR_MULTISAMPLE_8X>,
-        BackendSampleRate<2, SWR_MULTISAMPLE_8X>,
-        BackendSampleRate<3, SWR_MULTISAMPLE_8X>,
-        BackendSampleRate<4, SWR_MULTISAMPLE_8X>,
-        BackendSampleRate<5, SWR_MULTISAMPLE_8X>,
-        BackendSampleRate<6, SWR_MULTISAMPLE_8X>,
-        BackendSampleRate<7, SWR_MULTISAMPLE_8X>,
-    },
-    {
-        BackendSampleRate<0, SWR_MULTISAMPLE_16X>,
-        BackendSampleRate<1, SWR_MULTISAMPLE_16X>,
-        BackendSampleRate<2, SWR_MULTISAMPLE_16X>,
-        BackendSampleRate<3, SWR_MULTISAMPLE_16X>,
-        BackendSampleRate<4, SWR_MULTISAMPLE_16X>,
-        BackendSampleRate<5, SWR_MULTISAMPLE_16X>,
-        BackendSampleRate<6, SWR_MULTISAMPLE_16X>,
-        BackendSampleRate<7, SWR_MULTISAMPLE_16X>,
-    }
+PFN_BACKEND_FUNC gSampleRateBackendTable[2][SWR_MULTISAMPLE_TYPE_MAX-1][SWR_NUM_RENDERTARGETS] = {
+    BACKEND_MSAA_FUNCS(BackendSampleRate, false),
+    BACKEND_MSAA_FUNCS(BackendSampleRate, true),
 };
 
 // MSAA per pixel shading rate
-PFN_BACKEND_FUNC gPixelRateBackendTable[SWR_MULTISAMPLE_TYPE_MAX-1][SWR_NUM_RENDERTARGETS] ={
-    {
-        BackendPixelRate<0, SWR_MULTISAMPLE_2X>,
-        BackendPixelRate<1, SWR_MULTISAMPLE_2X>,
-        BackendPixelRate<2, SWR_MULTISAMPLE_2X>,
-        BackendPixelRate<3, SWR_MULTISAMPLE_2X>,
-        BackendPixelRate<4, SWR_MULTISAMPLE_2X>,
-        BackendPixelRate<5, SWR_MULTISAMPLE_2X>,
-        BackendPixelRate<6, SWR_MULTISAMPLE_2X>,
-        BackendPixelRate<7, SWR_MULTISAMPLE_2X>,
-    },
-    {
-        BackendPixelRate<0, SWR_MULTISAMPLE_4X>,
-        BackendPixelRate<1, SWR_MULTISAMPLE_4X>,
-        BackendPixelRate<2, SWR_MULTISAMPLE_4X>,
-        BackendPixelRate<3, SWR_MULTISAMPLE_4X>,
-        BackendPixelRate<4, SWR_MULTISAMPLE_4X>,
-        BackendPixelRate<5, SWR_MULTISAMPLE_4X>,
-        BackendPixelRate<6, SWR_MULTISAMPLE_4X>,
-        BackendPixelRate<7, SWR_MULTISAMPLE_4X>,
-    },
-    {
-        BackendPixelRate<0, SWR_MULTISAMPLE_8X>,
-        BackendPixelRate<1, SWR_MULTISAMPLE_8X>,
-        BackendPixelRate<2, SWR_MULTISAMPLE_8X>,
-        BackendPixelRate<3, SWR_MULTISAMPLE_8X>,
-        BackendPixelRate<4, SWR_MULTISAMPLE_8X>,
-        BackendPixelRate<5, SWR_MULTISAMPLE_8X>,
-        BackendPixelRate<6, SWR_MULTISAMPLE_8X>,
-        BackendPixelRate<7, SWR_MULTISAMPLE_8X>,
-    },
-    {
-        BackendPixelRate<0, SWR_MULTISAMPLE_16X>,
-        BackendPixelRate<1, SWR_MULTISAMPLE_16X>,
-        BackendPixelRate<2, SWR_MULTISAMPLE_16X>,
-        BackendPixelRate<3, SWR_MULTISAMPLE_16X>,
-        BackendPixelRate<4, SWR_MULTISAMPLE_16X>,
-        BackendPixelRate<5, SWR_MULTISAMPLE_16X>,
-        BackendPixelRate<6, SWR_MULTISAMPLE_16X>,
-        BackendPixelRate<7, SWR_MULTISAMPLE_16X>,
-    }
+PFN_BACKEND_FUNC gPixelRateBackendTable[2][SWR_MULTISAMPLE_TYPE_MAX-1][SWR_NUM_RENDERTARGETS] = {
+    BACKEND_MSAA_FUNCS(BackendPixelRate, false),
+    BACKEND_MSAA_FUNCS(BackendPixelRate, true),
 };
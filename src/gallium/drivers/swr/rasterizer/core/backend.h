@@ -37,9 +37,11 @@ void ProcessQueryStatsBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTil
 void ProcessClearBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTile, void *pUserData);
 void ProcessStoreTileBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTile, void *pData);
 void ProcessInvalidateTilesBE(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTile, void *pData);
-void BackendNullPS(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t x, uint32_t y, SWR_TRIANGLE_DESC &work, RenderOutputBuffers &renderBuffers);
 void InitClearTilesTable();
 
-extern PFN_BACKEND_FUNC gSingleSampleBackendTable[];
-extern PFN_BACKEND_FUNC gSampleRateBackendTable[SWR_MULTISAMPLE_TYPE_MAX-1][SWR_NUM_RENDERTARGETS];
-extern PFN_BACKEND_FUNC gPixelRateBackendTable[SWR_MULTISAMPLE_TYPE_MAX-1][SWR_NUM_RENDERTARGETS];
+// Backend tables are indexed by whether stats are enabled first, so draws
+// without an active query run paths with no stat counting compiled in.
+extern PFN_BACKEND_FUNC gNullPSBackendTable[2];
+extern PFN_BACKEND_FUNC gSingleSampleBackendTable[2][SWR_NUM_RENDERTARGETS];
+extern PFN_BACKEND_FUNC gSampleRateBackendTable[2][SWR_MULTISAMPLE_TYPE_MAX-1][SWR_NUM_RENDERTARGETS];
+extern PFN_BACKEND_FUNC gPixelRateBackendTable[2][SWR_MULTISAMPLE_TYPE_MAX-1][SWR_NUM_RENDERTARGETS];
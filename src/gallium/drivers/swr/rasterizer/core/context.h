@@ -183,6 +183,7 @@ struct DRAW_WORK
     int32_t    baseVertex;
     uint32_t   numInstances;        // Number of instances
     uint32_t   startInstance;       // Instance offset
+    uint32_t   startInstanceID;     // first InstanceID of this draw batch
     uint32_t   startPrimID;         // starting primitiveID for this draw batch
     SWR_FORMAT type;                // index buffer type
 };
@@ -208,6 +209,14 @@ struct GUARDBAND
     float left, right, top, bottom;
 };
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Stats counted by one worker. Aligned so each worker's counters sit
+///        on their own cache lines and workers don't false share them.
+OSALIGNLINE(struct) WORKER_STATS
+{
+    SWR_STATS stats;
+};
+
 struct PA_STATE;
 
 // function signature for pipeline stages that execute after primitive assembly
@@ -296,21 +305,52 @@ OSALIGNLINE(struct) API_STATE
 class MacroTileMgr;
 class DispatchQueue;
 
+struct DEPTH_BOUNDS;
+struct HOTTILE;
+
 struct RenderOutputBuffers
 {
     uint8_t* pColor[SWR_NUM_RENDERTARGETS];
+    SWR_FORMAT colorFormat[SWR_NUM_RENDERTARGETS];      // hot tile format of each color buffer
+    uint32_t colorSampleStep[SWR_NUM_RENDERTARGETS];    // bytes between the samples of a color raster tile
     uint8_t* pDepth;
     uint8_t* pStencil;
+    DEPTH_BOUNDS* pDepthBounds;     // bounds of the depth hot tile, nullptr if depth is unused
+
+    // hot tiles with raster tiles still holding a deferred clear, these have to
+    // be resolved before the backend touches the raster tile.
+    uint32_t numClearPending;
+    HOTTILE* pClearPending[SWR_NUM_ATTACHMENTS];
+    SWR_RENDERTARGET_ATTACHMENT clearPendingAttachment[SWR_NUM_ATTACHMENTS];
 };
 
 // pipeline function pointer types
 typedef void(*PFN_BACKEND_FUNC)(DRAW_CONTEXT*, uint32_t, uint32_t, uint32_t, SWR_TRIANGLE_DESC&, RenderOutputBuffers&);
 
+// API state blocks
+//    The larger, rarely changing parts of API_STATE are tracked as blocks. Each time
+//    a block is set it receives a new version, and a block is only copied to the next
+//    draw's state if that DS ring entry doesn't already hold the same version of it.
+//    State outside of these blocks is small or written per draw and is always copied.
+enum API_STATE_BLOCK
+{
+    API_STATE_BLOCK_VERTEX_INPUT,   // vertex/index buffers, fetch shader
+    API_STATE_BLOCK_SHADERS,        // VS, GS, CS, FE and SO state
+    API_STATE_BLOCK_VIEWPORT,       // viewports and viewport matrices
+    API_STATE_BLOCK_SCISSOR,        // scissor rects
+    API_STATE_BLOCK_PIXEL,          // backend, PS and depth stencil state
+    API_STATE_BLOCK_BLEND,          // blend state and blend shaders
+
+    API_STATE_NUM_BLOCKS
+};
+
 // Draw State
 struct DRAW_STATE
 {
     API_STATE state;
 
+    uint64_t blockVersion[API_STATE_NUM_BLOCKS];    // version of each state block held in 'state'
+
     void* pPrivateState;  // Its required the driver sets this up for each draw.
 
     // pipeline function pointers, filled in by API thread when setting up the draw
@@ -320,6 +360,16 @@ struct DRAW_STATE
     Arena    arena;     // This should only be used by API thread.
 };
 
+// Worker idle state
+//    A parked worker isn't working on any draw, so when a draw retires the API thread
+//    doesn't have to wait for it and moves its draw counters forward instead.
+enum WORKER_STATE
+{
+    WORKER_RUNNING,
+    WORKER_PARKED,
+    WORKER_ADVANCING,   // API thread is updating the counters of a parked worker
+};
+
 // Draw Context
 //    The api thread sets up a draw context that exists for the life of the draw.
 //    This draw context maintains all of the state needed for the draw operation.
@@ -335,6 +385,7 @@ struct DRAW_CONTEXT
     volatile OSALIGNLINE(uint32_t) FeLock;
     volatile OSALIGNLINE(bool) inUse;
     volatile OSALIGNLINE(bool) doneFE;    // Is FE work done for this draw?
+    bool streamBE;                        // Can BE work on binned macrotiles before FE is done?
 
     uint64_t dependency;
 
@@ -365,6 +416,7 @@ INLINE void* GetPrivateState(const DRAW_CONTEXT* pDC)
 }
 
 class HotTileMgr;
+class MacroTileScheduler;
 
 struct SWR_CONTEXT
 {
@@ -385,6 +437,7 @@ struct SWR_CONTEXT
     //     a. Same as step 1.
     //     b. State is copied from prev draw context to current.
     DRAW_CONTEXT* dcRing;
+    uint32_t MaxDrawsInFlight;        // Number of entries in the DC and DS rings.
 
     DRAW_CONTEXT *pCurDrawContext;    // This points to DC entry in ring for an unsubmitted draw.
     DRAW_CONTEXT *pPrevDrawContext;   // This points to DC entry for the previous context submitted that we can copy state from.
@@ -397,14 +450,33 @@ struct SWR_CONTEXT
     DRAW_STATE*   dsRing;
 
     uint32_t curStateId;               // Current index to the next available entry in the DS ring.
+    uint64_t stateVersion;             // Last version handed out to a changed API state block.
 
     uint32_t NumWorkerThreads;
 
     THREAD_POOL threadPool; // Thread pool associated with this context
 
-    std::condition_variable FifosNotEmpty;
     std::mutex WaitLock;
 
+    // Idle workers park on their WorkerWake. Only as many of them are woken up as
+    // there is work for, see WakeWorkers. Protected by WaitLock.
+    std::condition_variable WorkerWake[KNOB_MAX_NUM_THREADS];
+    uint32_t NumParkedWorkers;
+    uint64_t NumWorkerWakes;
+    uint64_t NumWorkerParks;
+
+    // WORKER_STATE of each worker, lets the API thread move parked workers past draws.
+    OSALIGNLINE(volatile LONG) WorkerState[KNOB_MAX_NUM_THREADS];
+
+    // API thread sleeps on this while the DC ring is full. Workers notify it
+    // once they move past a draw, which is what retires it.
+    std::condition_variable DrawRetired;
+    std::mutex RetireLock;
+    volatile bool ApiWaitingForRetire;
+
+    // API thread stalls on a full DC ring. Only written by the API thread.
+    SWR_API_STATS apiStats;
+
     // Draw Contexts will get a unique drawId generated from this
     uint64_t nextDrawId;
 
@@ -424,21 +496,32 @@ struct SWR_CONTEXT
     uint32_t privateStateSize;
 
     HotTileMgr *pHotTileMgr;
+    MacroTileScheduler *pTileScheduler;
 
     // tile load/store functions, passed in at create context time
     PFN_LOAD_TILE pfnLoadTile;
     PFN_STORE_TILE pfnStoreTile;
     PFN_CLEAR_TILE pfnClearTile;
 
-    // Global Stats
-    SWR_STATS stats[KNOB_MAX_NUM_THREADS];
+    // Per worker stats, summed up only when a query snapshot is taken.
+    WORKER_STATS workerStats[KNOB_MAX_NUM_THREADS];
 
     // Scratch space for workers.
     uint8_t* pScratch[KNOB_MAX_NUM_THREADS];
+
+    // Arena blocks are shared by all arenas of the context through this pool.
+    ArenaBlockPool* pArenaBlockPool;
+
+    // Per worker arenas for FE allocations that don't outlive the FE work item.
+    Arena workerArenas[KNOB_MAX_NUM_THREADS];
 };
 
 void WaitForDependencies(SWR_CONTEXT *pContext, uint64_t drawId);
-void WakeAllThreads(SWR_CONTEXT *pContext);
+void WakeWorkers(SWR_CONTEXT *pContext, uint32_t numWorkers);
+
+#define UPDATE_STAT(name, count) if (GetApiState(pDC).enableStats) { pContext->workerStats[workerId].stats.name += count; }
+#define SET_STAT(name, count) if (GetApiState(pDC).enableStats) { pContext->workerStats[workerId].stats.name = count; }
 
-#define UPDATE_STAT(name, count) if (GetApiState(pDC).enableStats) { pContext->stats[workerId].name += count; }
-#define SET_STAT(name, count) if (GetApiState(pDC).enableStats) { pContext->stats[workerId].name = count; }
+// For paths instantiated with and without stats. StatsEnabledT is a template
+// parameter of the caller, so count is not even evaluated when it is false.
+#define UPDATE_STAT_T(name, count) if (StatsEnabledT) { pContext->workerStats[workerId].stats.name += count; }
@@ -31,28 +31,49 @@
 #include <vector>
 #include <cassert>
 
+//////////////////////////////////////////////////////////////////////////
+/// QUEUE - Single producer, single consumer work fifo. The consumer can
+///   drain entries while the producer is still enqueueing. Blocks are
+///   chained so the consumer never touches the block list the producer
+///   may be growing.
+//////////////////////////////////////////////////////////////////////////
 template<class T>
 struct QUEUE
 {
-    OSALIGNLINE(volatile uint32_t) mLock;
-    OSALIGNLINE(volatile uint32_t) mNumEntries;
-    std::vector<T*> mBlocks;
-    T* mCurBlock;
-    uint32_t mHead;
-    uint32_t mTail;    uint32_t mCurBlockIdx;
-
     // power of 2
     static const uint32_t mBlockSizeShift = 6;
     static const uint32_t mBlockSize = 1 << mBlockSizeShift;
 
+    struct BLOCK
+    {
+        T items[mBlockSize];
+        BLOCK* pNext;
+    };
+
+    OSALIGNLINE(volatile uint32_t) mLock;
+    OSALIGNLINE(volatile uint32_t) mNumEnqueued;    // written by producer only
+    OSALIGNLINE(volatile uint32_t) mNumDequeued;    // written by consumer only
+    std::vector<BLOCK*> mBlocks;
+
+    // producer
+    BLOCK* mTailBlock;
+    uint32_t mTail;
+    uint32_t mCurBlockIdx;
+
+    // consumer
+    BLOCK* mHeadBlock;
+    uint32_t mHead;
+
     void initialize()
     {
         mLock = 0;
         mHead = 0;
         mTail = 0;
-        mNumEntries = 0;
-        mCurBlock = (T*)malloc(mBlockSize*sizeof(T));
-        mBlocks.push_back(mCurBlock);
+        mNumEnqueued = 0;
+        mNumDequeued = 0;
+        mTailBlock = (BLOCK*)malloc(sizeof(BLOCK));
+        mHeadBlock = mTailBlock;
+        mBlocks.push_back(mTailBlock);
         mCurBlockIdx = 0;
     }
 
@@ -60,17 +81,19 @@ struct QUEUE
     {
         mHead = 0;
         mTail = 0;
-        mCurBlock = mBlocks[0];
+        mTailBlock = mBlocks[0];
+        mHeadBlock = mBlocks[0];
         mCurBlockIdx = 0;
 
-        mNumEntries = 0;
+        mNumEnqueued = 0;
+        mNumDequeued = 0;
         _ReadWriteBarrier();
         mLock = 0;
     }
 
     uint32_t getNumQueued()
     {
-        return mNumEntries;
+        return mNumEnqueued - mNumDequeued;
     }
 
     bool tryLock()
@@ -92,44 +115,54 @@ struct QUEUE
 
     T* peek()
     {
-        if (mNumEntries == 0)
+        if (mNumEnqueued == mNumDequeued)
         {
             return nullptr;
         }
-        uint32_t block = mHead >> mBlockSizeShift;
-        return &mBlocks[block][mHead & (mBlockSize-1)];
+        _ReadWriteBarrier();
+        return &mHeadBlock->items[mHead];
     }
 
     void dequeue_noinc()
     {
         mHead ++;
-        mNumEntries --;
+        if (mHead == mBlockSize)
+        {
+            // The producer links the next block before publishing any entry in it.
+            mHeadBlock = mHeadBlock->pNext;
+            mHead = 0;
+        }
+        mNumDequeued ++;
     }
 
     bool enqueue_try_nosync(const T* entry)
     {
-        memcpy(&mCurBlock[mTail], entry, sizeof(T));
+        memcpy(&mTailBlock->items[mTail], entry, sizeof(T));
 
         mTail ++;
         if (mTail == mBlockSize)
         {
+            BLOCK* pNewBlock;
             if (++mCurBlockIdx < mBlocks.size())
             {
-                mCurBlock = mBlocks[mCurBlockIdx];
+                pNewBlock = mBlocks[mCurBlockIdx];
             }
             else
             {
-                T* newBlock = (T*)malloc(sizeof(T)*mBlockSize);
-                SWR_ASSERT(newBlock);
+                pNewBlock = (BLOCK*)malloc(sizeof(BLOCK));
+                SWR_ASSERT(pNewBlock);
 
-                mBlocks.push_back(newBlock);
-                mCurBlock = newBlock;
+                mBlocks.push_back(pNewBlock);
             }
 
+            mTailBlock->pNext = pNewBlock;
+            mTailBlock = pNewBlock;
             mTail = 0;
         }
 
-        mNumEntries ++;
+        // publish the entry
+        _ReadWriteBarrier();
+        mNumEnqueued ++;
         return true;
     }
 
@@ -142,3 +175,148 @@ struct QUEUE
     }
 
 };
+
+//////////////////////////////////////////////////////////////////////////
+/// WorkStealingDeque - Lock-free work stealing deque (Chase-Lev).
+///   The owning thread pushes and pops at the bottom of the deque while
+///   any other thread can steal from the top. The deque grows on demand,
+///   retired buffers are kept until destroy() since thieves may still be
+///   reading from them.
+//////////////////////////////////////////////////////////////////////////
+template<class T>
+class WorkStealingDeque
+{
+public:
+    void initialize(uint32_t capacity)
+    {
+        SWR_ASSERT((capacity & (capacity - 1)) == 0, "Capacity must be a power of 2");
+
+        mTop = 0;
+        mBottom = 0;
+        mpBuffer = allocBuffer(capacity);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Push work onto the bottom of the deque. Owner only.
+    void push(const T& item)
+    {
+        INT64 bottom = mBottom;
+        INT64 top = mTop;
+        Buffer* pBuffer = mpBuffer;
+
+        if ((bottom - top) > (INT64)pBuffer->mask)
+        {
+            // Full, grow the buffer. Thieves may still be reading from the old one.
+            Buffer* pNewBuffer = allocBuffer((pBuffer->mask + 1) * 2);
+            for (INT64 i = top; i < bottom; ++i)
+            {
+                pNewBuffer->pItems[i & pNewBuffer->mask] = pBuffer->pItems[i & pBuffer->mask];
+            }
+            mRetired.push_back(pBuffer);
+
+            _ReadWriteBarrier();
+            mpBuffer = pNewBuffer;
+            pBuffer = pNewBuffer;
+        }
+
+        pBuffer->pItems[bottom & pBuffer->mask] = item;
+
+        _ReadWriteBarrier();
+        mBottom = bottom + 1;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Pop most recently pushed work from the bottom. Owner only.
+    bool pop(T& item)
+    {
+        INT64 bottom = mBottom - 1;
+        Buffer* pBuffer = mpBuffer;
+        mBottom = bottom;
+
+        // the store to bottom must be visible before top is read.
+        _mm_mfence();
+
+        INT64 top = mTop;
+        if (top > bottom)
+        {
+            // empty
+            mBottom = bottom + 1;
+            return false;
+        }
+
+        item = pBuffer->pItems[bottom & pBuffer->mask];
+        if (top == bottom)
+        {
+            // Last item, race against thieves for it.
+            bool won = (InterlockedCompareExchange64(&mTop, top + 1, top) == top);
+            mBottom = bottom + 1;
+            return won;
+        }
+
+        return true;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Steal the oldest work from the top. Any thread. Can fail
+    ///        spuriously if another thread wins the race for the item.
+    bool steal(T& item)
+    {
+        INT64 top = mTop;
+        _ReadWriteBarrier();
+        INT64 bottom = mBottom;
+
+        if (top >= bottom)
+        {
+            return false;
+        }
+
+        Buffer* pBuffer = mpBuffer;
+        T stolen = pBuffer->pItems[top & pBuffer->mask];
+        if (InterlockedCompareExchange64(&mTop, top + 1, top) != top)
+        {
+            return false;
+        }
+
+        item = stolen;
+        return true;
+    }
+
+    bool isEmpty() const
+    {
+        return mTop >= mBottom;
+    }
+
+    void destroy()
+    {
+        for (uint32_t i = 0; i < mRetired.size(); ++i)
+        {
+            free(mRetired[i]);
+        }
+        mRetired.clear();
+
+        free(mpBuffer);
+        mpBuffer = nullptr;
+    }
+
+private:
+    struct Buffer
+    {
+        uint64_t mask;
+        T* pItems;
+    };
+
+    static Buffer* allocBuffer(uint32_t capacity)
+    {
+        // Items are allocated directly after the buffer header.
+        Buffer* pBuffer = (Buffer*)malloc(sizeof(Buffer) + capacity * sizeof(T));
+        SWR_ASSERT(pBuffer);
+        pBuffer->mask = capacity - 1;
+        pBuffer->pItems = (T*)(pBuffer + 1);
+        return pBuffer;
+    }
+
+    OSALIGNLINE(volatile INT64) mTop;
+    OSALIGNLINE(volatile INT64) mBottom;
+    Buffer* volatile mpBuffer;
+    std::vector<Buffer*> mRetired;
+};
@@ -669,11 +669,11 @@ static void GeometryShaderStage(
 
 //////////////////////////////////////////////////////////////////////////
 /// @brief Allocate GS buffers
-/// @param pDC - pointer to draw context.
+/// @param arena - worker arena to allocate from, GS output doesn't outlive the FE work
 /// @param state - API state
 /// @param ppGsOut - pointer to GS output buffer allocation
 /// @param ppCutBuffer - pointer to GS output cut buffer allocation
-static INLINE void AllocateGsBuffers(DRAW_CONTEXT* pDC, const API_STATE& state, void** ppGsOut, void** ppCutBuffer)
+static INLINE void AllocateGsBuffers(Arena& arena, const API_STATE& state, void** ppGsOut, void** ppCutBuffer)
 {
     SWR_ASSERT(state.gsState.gsEnable);
     // allocate arena space to hold GS output verts
@@ -682,13 +682,13 @@ static INLINE void AllocateGsBuffers(DRAW_CONTEXT* pDC, const API_STATE& state,
     const uint32_t vertexStride = sizeof(simdvertex);
     const uint32_t numSimdBatches = (state.gsState.maxNumVerts + KNOB_SIMD_WIDTH - 1) / KNOB_SIMD_WIDTH;
     uint32_t size = state.gsState.instanceCount * numSimdBatches * vertexStride * KNOB_SIMD_WIDTH;
-    *ppGsOut = pDC->arena.AllocAligned(size, KNOB_SIMD_WIDTH * sizeof(float));
+    *ppGsOut = arena.AllocAligned(size, KNOB_SIMD_WIDTH * sizeof(float));
 
     // allocate arena space to hold cut buffer, which is essentially a bitfield sized to the
     // maximum vertex output as defined by the GS state, per SIMD lane, per GS instance
     const uint32_t cutPrimStride = (state.gsState.maxNumVerts + 7) / 8;
     const uint32_t cutBufferSize = cutPrimStride * state.gsState.instanceCount * KNOB_SIMD_WIDTH;
-    *ppCutBuffer = pDC->arena.AllocAligned(cutBufferSize, KNOB_SIMD_WIDTH * sizeof(float));
+    *ppCutBuffer = arena.AllocAligned(cutBufferSize, KNOB_SIMD_WIDTH * sizeof(float));
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -911,6 +911,291 @@ static void TessellationStages(
     TSDestroyCtx(tsCtx);
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Post-transform vertex cache for indexed draws.
+///        Direct mapped on the vertex index, each entry holds the VS output
+///        of one vertex. Only the attribute slots the rest of the FE reads
+///        are cached.
+struct VERTEX_CACHE
+{
+    static const uint32_t INVALID_INDEX = 0xffffffff;
+
+    static_assert((KNOB_VERTEX_CACHE_SIZE & (KNOB_VERTEX_CACHE_SIZE - 1)) == 0,
+        "KNOB_VERTEX_CACHE_SIZE must be a power of 2, entries are picked by masking the index");
+
+    uint32_t*   pTags;              // vertex index held by each entry
+    uint8_t*    pCut;               // entry holds the cut index
+    float*      pVerts;             // vertexSize floats per entry
+    simdvertex* pVsOut;             // VS output for a batch of cache misses
+    uint32_t    slotRanges[3][2];   // [begin, end) of cached attribute slots
+    uint32_t    numSlotRanges;
+    uint32_t    vertexSize;
+
+    void Init(Arena& arena, const API_STATE& state, bool allSlots)
+    {
+        numSlotRanges = 0;
+        vertexSize = 0;
+
+        if (allSlots)
+        {
+            // GS and tessellation read VS outputs by their own linkage.
+            AddSlots(0, KNOB_NUM_ATTRIBUTES);
+        }
+        else
+        {
+            DWORD lastAttrib;
+            uint32_t endSlot = VERTEX_ATTRIB_START_SLOT;
+            if (_BitScanReverse(&lastAttrib, state.feAttribMask))
+            {
+                endSlot += lastAttrib + 1;
+            }
+
+            // the binners read PS inputs through the linkage map, which can
+            // point past the last bit of feAttribMask
+            for (uint32_t i = 0; i < state.linkageCount; ++i)
+            {
+                endSlot = std::max(endSlot, (uint32_t)VERTEX_ATTRIB_START_SLOT + state.linkageMap[i] + 1);
+            }
+            AddSlots(VERTEX_POSITION_SLOT, std::min(endSlot, (uint32_t)KNOB_NUM_ATTRIBUTES));
+
+            if (state.rastState.clipDistanceMask || state.rastState.cullDistanceMask)
+            {
+                AddSlots(VERTEX_CLIPCULL_DIST_LO_SLOT, VERTEX_CLIPCULL_DIST_HI_SLOT + 1);
+            }
+
+            // the binner reads point size from its own slot
+            if (state.rastState.pointParam && !HasSlot(state.rastState.pointSizeAttrib))
+            {
+                AddSlots(state.rastState.pointSizeAttrib, state.rastState.pointSizeAttrib + 1);
+            }
+        }
+
+        pTags = (uint32_t*)arena.AllocAligned(KNOB_VERTEX_CACHE_SIZE * sizeof(uint32_t), 64);
+        pCut = (uint8_t*)arena.AllocAligned(KNOB_VERTEX_CACHE_SIZE, 64);
+        pVerts = (float*)arena.AllocAligned(KNOB_VERTEX_CACHE_SIZE * vertexSize * sizeof(float), 64);
+        pVsOut = (simdvertex*)arena.AllocAligned(sizeof(simdvertex), KNOB_SIMD_WIDTH * 4);
+    }
+
+    void AddSlots(uint32_t begin, uint32_t end)
+    {
+        SWR_ASSERT(numSlotRanges < sizeof(slotRanges) / sizeof(slotRanges[0]));
+        slotRanges[numSlotRanges][0] = begin;
+        slotRanges[numSlotRanges][1] = end;
+        numSlotRanges++;
+        vertexSize += (end - begin) * 4;
+    }
+
+    bool HasSlot(uint32_t slot) const
+    {
+        for (uint32_t r = 0; r < numSlotRanges; ++r)
+        {
+            if (slot >= slotRanges[r][0] && slot < slotRanges[r][1])
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Vertex outputs depend on the instance, the cache is only valid within one.
+    void Reset()
+    {
+        memset(pTags, 0xff, KNOB_VERTEX_CACHE_SIZE * sizeof(uint32_t));
+    }
+
+    INLINE uint32_t GetEntry(uint32_t index) const
+    {
+        return index & (KNOB_VERTEX_CACHE_SIZE - 1);
+    }
+
+    INLINE bool IsCached(uint32_t index) const
+    {
+        return index != INVALID_INDEX && pTags[GetEntry(index)] == index;
+    }
+
+    INLINE float* GetVertex(uint32_t entry)
+    {
+        return &pVerts[entry * vertexSize];
+    }
+
+    INLINE void CopyFromLane(const simdvertex& src, uint32_t lane, float* pDst) const
+    {
+        for (uint32_t r = 0; r < numSlotRanges; ++r)
+        {
+            for (uint32_t slot = slotRanges[r][0]; slot < slotRanges[r][1]; ++slot)
+            {
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    *pDst++ = ((const float*)&src.attrib[slot][c])[lane];
+                }
+            }
+        }
+    }
+
+    INLINE void CopyToLane(const float* pSrc, simdvertex& dst, uint32_t lane) const
+    {
+        for (uint32_t r = 0; r < numSlotRanges; ++r)
+        {
+            for (uint32_t slot = slotRanges[r][0]; slot < slotRanges[r][1]; ++slot)
+            {
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    ((float*)&dst.attrib[slot][c])[lane] = *pSrc++;
+                }
+            }
+        }
+    }
+
+    INLINE void CopyLane(const simdvertex& src, uint32_t srcLane, simdvertex& dst, uint32_t dstLane) const
+    {
+        for (uint32_t r = 0; r < numSlotRanges; ++r)
+        {
+            for (uint32_t slot = slotRanges[r][0]; slot < slotRanges[r][1]; ++slot)
+            {
+                for (uint32_t c = 0; c < 4; ++c)
+                {
+                    ((float*)&dst.attrib[slot][c])[dstLane] = ((const float*)&src.attrib[slot][c])[srcLane];
+                }
+            }
+        }
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Fetches and vertex shades a SIMD of indices through the vertex
+///        cache. Each unique index that misses the cache is shaded once,
+///        the other lanes are filled from the cache.
+/// @param fetchInfo - Fetch context, pIndices points at the batch.
+/// @param vout - VS output for the batch.
+/// @param numActive - Number of valid lanes in the batch.
+/// @param cutMask - Cut mask for the batch is returned here.
+/// @return Number of VS invocations.
+template <typename IndexT>
+static uint32_t ShadeCachedVertices(
+    DRAW_CONTEXT *pDC,
+    VERTEX_CACHE& cache,
+    SWR_FETCH_CONTEXT& fetchInfo,
+    SWR_VS_CONTEXT& vsContext,
+    simdvertex& vin,
+    simdvertex& vout,
+    uint32_t numActive,
+    simdmask& cutMask)
+{
+    const API_STATE& state = GetApiState(pDC);
+    const IndexT* pIndices = (const IndexT*)fetchInfo.pIndices;
+    const IndexT* pLastIndex = (const IndexT*)fetchInfo.pLastIndex;
+
+    static const uint32_t MISS = 0x80000000;
+
+    IndexT missIndices[KNOB_SIMD_WIDTH];
+    uint32_t laneSource[KNOB_SIMD_WIDTH];   // cache entry or MISS | miss lane
+    uint32_t numMisses = 0;
+
+    // Without reuse in the batch misses map 1:1 to lanes and the VS can write vout directly.
+    bool missesInLaneOrder = true;
+
+    for (uint32_t lane = 0; lane < numActive; ++lane)
+    {
+        // OOB indices fetch vertex 0, like the fetch shader does
+        uint32_t index = (&pIndices[lane] < pLastIndex) ? pIndices[lane] : 0;
+
+        if (cache.IsCached(index))
+        {
+            laneSource[lane] = cache.GetEntry(index);
+            missesInLaneOrder = false;
+            continue;
+        }
+
+        uint32_t m = 0;
+        while (m < numMisses && missIndices[m] != (IndexT)index)
+        {
+            ++m;
+        }
+
+        if (m == numMisses)
+        {
+            missIndices[numMisses++] = (IndexT)index;
+        }
+
+        missesInLaneOrder = missesInLaneOrder && (m == lane);
+        laneSource[lane] = MISS | m;
+    }
+
+    simdvertex& vsOut = missesInLaneOrder ? vout : *cache.pVsOut;
+    OSALIGNSIMD(uint32_t) missCut[KNOB_SIMD_WIDTH] = { 0 };
+
+    if (numMisses)
+    {
+        fetchInfo.pIndices = (const int32_t*)missIndices;
+        fetchInfo.pLastIndex = (const int32_t*)&missIndices[numMisses];
+        fetchInfo.CutMask = _simd_setzero_si();
+
+        RDTSC_START(FEFetchShader);
+        state.pfnFetchFunc(fetchInfo, vin);
+        RDTSC_STOP(FEFetchShader, 0, 0);
+
+        fetchInfo.pIndices = (const int32_t*)pIndices;
+        fetchInfo.pLastIndex = (const int32_t*)pLastIndex;
+
+        _simd_store_si((simdscalari*)missCut, fetchInfo.CutMask);
+
+        vsContext.VertexID = fetchInfo.VertexID;
+        vsContext.mask = GenerateMask(numMisses);
+        vsContext.pVout = &vsOut;
+
+        RDTSC_START(FEVertexShader);
+        state.pfnVertexFunc(GetPrivateState(pDC), &vsContext);
+        RDTSC_STOP(FEVertexShader, 0, 0);
+
+        vsContext.pVout = &vout;
+    }
+
+    // Fill hit lanes before misses evict their entries.
+    uint32_t cutBits = 0;
+    for (uint32_t lane = 0; lane < numActive; ++lane)
+    {
+        uint32_t source = laneSource[lane];
+        if (source & MISS)
+        {
+            cutBits |= missCut[source & ~MISS] ? (1 << lane) : 0;
+        }
+        else
+        {
+            cache.CopyToLane(cache.GetVertex(source), vout, lane);
+            cutBits |= cache.pCut[source] ? (1 << lane) : 0;
+        }
+    }
+
+    if (!missesInLaneOrder)
+    {
+        for (uint32_t lane = 0; lane < numActive; ++lane)
+        {
+            uint32_t source = laneSource[lane];
+            if (source & MISS)
+            {
+                cache.CopyLane(vsOut, source & ~MISS, vout, lane);
+            }
+        }
+    }
+
+    for (uint32_t m = 0; m < numMisses; ++m)
+    {
+        uint32_t index = missIndices[m];
+        if (index == VERTEX_CACHE::INVALID_INDEX)
+        {
+            continue;
+        }
+
+        uint32_t entry = cache.GetEntry(index);
+        cache.pTags[entry] = index;
+        cache.pCut[entry] = missCut[m] ? 1 : 0;
+        cache.CopyFromLane(vsOut, m, cache.GetVertex(entry));
+    }
+
+    cutMask = cutBits;
+    return numMisses;
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief FE handler for SwrDraw.
 /// @tparam IsIndexedT - Is indexed drawing enabled
@@ -1005,11 +1290,14 @@ void ProcessDraw(
     uint32_t numPrims = GetNumPrims(state.topology, work.numVerts);
 #endif
 
+    // transient FE allocations come from the worker's arena, bin data goes to the DC arena
+    Arena& workerArena = pContext->workerArenas[workerId];
+
     void* pGsOut = nullptr;
     void* pCutBuffer = nullptr;
     if (HasGeometryShaderT)
     {
-        AllocateGsBuffers(pDC, state, &pGsOut, &pCutBuffer);
+        AllocateGsBuffers(workerArena, state, &pGsOut, &pCutBuffer);
     }
 
     if (HasTessellationT)
@@ -1031,7 +1319,18 @@ void ProcessDraw(
     uint32_t* pSoPrimData = nullptr;
     if (HasStreamOutT)
     {
-        pSoPrimData = (uint32_t*)pDC->arena.AllocAligned(4096, 16);
+        pSoPrimData = (uint32_t*)workerArena.AllocAligned(4096, 16);
+    }
+
+    // indexed draws shade each vertex once while it stays in the vertex cache
+    VERTEX_CACHE vertexCache;
+    bool useVertexCache = IsIndexedT && KNOB_VERTEX_CACHE;
+#if KNOB_ENABLE_TOSS_POINTS
+    useVertexCache = useVertexCache && !KNOB_TOSS_FETCH;
+#endif
+    if (useVertexCache)
+    {
+        vertexCache.Init(workerArena, state, HasTessellationT || HasGeometryShaderT);
     }
 
     // choose primitive assembler
@@ -1054,8 +1353,13 @@ void ProcessDraw(
             fetchInfo.pIndices = (const int32_t*)&vIndex;
         }
 
-        fetchInfo.CurInstance = instanceNum;
-        vsContext.InstanceID = instanceNum;
+        fetchInfo.CurInstance = work.startInstanceID + instanceNum;
+        vsContext.InstanceID = work.startInstanceID + instanceNum;
+
+        if (useVertexCache)
+        {
+            vertexCache.Reset();
+        }
 
         while (pa.HasWork())
         {
@@ -1070,7 +1374,30 @@ void ProcessDraw(
             simdvertex& vout = pa.GetNextVsOutput();
             vsContext.pVout = &vout;
 
-            if (i < endVertex)
+            if (IsIndexedT && useVertexCache && i < endVertex)
+            {
+                // 1. Execute FS/VS for the indices of a single SIMD that miss the vertex cache.
+                uint32_t numActive = GetNumInvocations(i, endVertex);
+                uint32_t numVsInvocations = 0;
+
+                UPDATE_STAT(IaVertices, numActive);
+
+                switch (indexSize)
+                {
+                case sizeof(uint32_t):
+                    numVsInvocations = ShadeCachedVertices<uint32_t>(pDC, vertexCache, fetchInfo, vsContext, vin, vout, numActive, *pvCutIndices);
+                    break;
+                case sizeof(uint16_t):
+                    numVsInvocations = ShadeCachedVertices<uint16_t>(pDC, vertexCache, fetchInfo, vsContext, vin, vout, numActive, *pvCutIndices);
+                    break;
+                default:
+                    numVsInvocations = ShadeCachedVertices<uint8_t>(pDC, vertexCache, fetchInfo, vsContext, vin, vout, numActive, *pvCutIndices);
+                    break;
+                }
+
+                UPDATE_STAT(VsInvocations, numVsInvocations);
+            }
+            else if (i < endVertex)
             {
 
                 // 1. Execute FS/VS for a single SIMD.
@@ -1168,6 +1495,8 @@ void ProcessDraw(
         pa.Reset();
     }
 
+    workerArena.Reset();
+
     _ReadWriteBarrier();
     pDC->doneFE = true;
     RDTSC_STOP(FEProcessDraw, numPrims * work.numInstances, pDC->drawId);
@@ -1664,6 +1993,14 @@ void BinPoints(
     primMask &= ~_simd_movemask_ps(_simd_castsi_ps(vXi));
     primMask &= ~_simd_movemask_ps(_simd_castsi_ps(vYi));
 
+    // cull points outside the scissor, the macrotile grid only covers it
+    simdscalari vOutside = _simd_or_si(
+        _simd_or_si(_simd_cmplt_epi32(vXi, _simd_set1_epi32(state.scissorInFixedPoint.left)),
+                    _simd_cmpgt_epi32(vXi, _simd_set1_epi32(state.scissorInFixedPoint.right))),
+        _simd_or_si(_simd_cmplt_epi32(vYi, _simd_set1_epi32(state.scissorInFixedPoint.top)),
+                    _simd_cmpgt_epi32(vYi, _simd_set1_epi32(state.scissorInFixedPoint.bottom))));
+    primMask &= ~_simd_movemask_ps(_simd_castsi_ps(vOutside));
+
     // compute macro tile coordinates 
     simdscalari macroX = _simd_srai_epi32(vXi, KNOB_MACROTILE_X_DIM_FIXED_SHIFT);
     simdscalari macroY = _simd_srai_epi32(vYi, KNOB_MACROTILE_Y_DIM_FIXED_SHIFT);
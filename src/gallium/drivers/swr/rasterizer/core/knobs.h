@@ -104,6 +104,8 @@
 #define KNOB_NUM_HOT_TILES_X                 256
 #define KNOB_NUM_HOT_TILES_Y                 256
 #define KNOB_COLOR_HOT_TILE_FORMAT           R32G32B32A32_FLOAT
+// compact color hot tile for unorm8 render targets, see SWR_RASTSTATE::colorHotTileFormat
+#define KNOB_COMPACT_COLOR_HOT_TILE_FORMAT   R8G8B8A8_UNORM
 #define KNOB_DEPTH_HOT_TILE_FORMAT           R32_FLOAT
 #define KNOB_STENCIL_HOT_TILE_FORMAT         R8_UINT
 
@@ -126,6 +128,9 @@
 // enables cut-aware primitive assembler
 #define KNOB_ENABLE_CUT_AWARE_PA               TRUE
 
+// number of entries in the FE post-transform vertex cache, must be a power of 2
+#define KNOB_VERTEX_CACHE_SIZE                 256
+
 ///////////////////////////////////////////////////////////////////////////////
 // Debug knobs
 ///////////////////////////////////////////////////////////////////////////////
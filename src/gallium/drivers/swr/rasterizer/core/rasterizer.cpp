@@ -40,9 +40,9 @@
 
 void GetRenderHotTiles(DRAW_CONTEXT *pDC, uint32_t macroID, uint32_t x, uint32_t y, RenderOutputBuffers &renderBuffers, 
     uint32_t numSamples, uint32_t renderTargetArrayIndex);
-void StepRasterTileX(uint32_t MaxRT, RenderOutputBuffers &buffers, uint32_t colorTileStep, uint32_t depthTileStep, uint32_t stencilTileStep);
+void StepRasterTileX(uint32_t MaxRT, RenderOutputBuffers &buffers, uint32_t numSamples, uint32_t depthTileStep, uint32_t stencilTileStep);
 void StepRasterTileY(uint32_t MaxRT, RenderOutputBuffers &buffers, RenderOutputBuffers &startBufferRow, 
-                     uint32_t colorRowStep, uint32_t depthRowStep, uint32_t stencilRowStep);
+                     uint32_t numSamples, uint32_t depthRowStep, uint32_t stencilRowStep);
 
 #define MASKTOVEC(i3,i2,i1,i0) {-i0,-i1,-i2,-i3}
 const __m128 gMaskToVec[] = {
@@ -367,6 +367,46 @@ INLINE float ComputeDepthBias(const SWR_RASTSTATE* pState, const SWR_TRIANGLE_DE
     return bias;
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns true if fragments failing the depth test have no other
+///        effect, so triangles can be rejected against the depth bounds of
+///        the hot tile without changing the result.
+INLINE bool CanRejectOnDepthBounds(const API_STATE& state)
+{
+    const SWR_DEPTH_STENCIL_STATE& dsState = state.depthStencilState;
+
+    if (!KNOB_DEPTH_BOUNDS_CULL || !dsState.depthTestEnable || dsState.stencilWriteEnable || state.psState.writesODepth)
+    {
+        return false;
+    }
+
+    switch (dsState.depthTestFunc)
+    {
+    case ZFUNC_LT:
+    case ZFUNC_LE:
+    case ZFUNC_GT:
+    case ZFUNC_GE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns true if no depth in [triMinZ, triMaxZ] can pass the depth
+///        test against depths in [minZ, maxZ].
+/// @param eps - Interpolation error allowance, ranges closer than this to
+///              passing are kept.
+INLINE bool DepthBoundsReject(uint32_t depthTestFunc, float triMinZ, float triMaxZ, float minZ, float maxZ, float eps)
+{
+    if (depthTestFunc == ZFUNC_LT || depthTestFunc == ZFUNC_LE)
+    {
+        return (triMinZ - eps) > maxZ;
+    }
+
+    return (triMaxZ + eps) < minZ;
+}
+
 // Prevent DCE by writing coverage mask from rasterizer to volatile
 #if KNOB_ENABLE_TOSS_POINTS
 __declspec(thread) volatile uint64_t gToss;
@@ -376,6 +416,16 @@ static const uint32_t vertsPerTri = 3, componentsPerAttrib = 4;
 // try to avoid _chkstk insertions; make this thread local
 static THREAD OSALIGN(float, 16) perspAttribsTLS[vertsPerTri * KNOB_NUM_ATTRIBUTES * componentsPerAttrib];
 
+// Fill in a raster tile that still holds a deferred clear before the backend reads or writes it.
+INLINE void ResolvePendingClears(RenderOutputBuffers &renderBuffers, uint32_t rtX, uint32_t rtY)
+{
+    uint64_t rasterTileBit = HotTileMgr::GetRasterTileBit(rtX, rtY);
+    for (uint32_t i = 0; i < renderBuffers.numClearPending; ++i)
+    {
+        HotTileMgr::ResolveClear(renderBuffers.pClearPending[i], renderBuffers.clearPendingAttachment[i], rasterTileBit);
+    }
+}
+
 template<SWR_MULTISAMPLE_COUNT sampleCount>
 void RasterizeTriangle(DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroTile, void* pDesc)
 {
@@ -390,6 +440,7 @@ void RasterizeTriangle(DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroTile,
     RDTSC_START(BERasterizeTriangle);
 
     RDTSC_START(BETriangleSetup);
+    SWR_CONTEXT *pContext = pDC->pContext;
     const API_STATE &state = GetApiState(pDC);
     const SWR_RASTSTATE &rastState = state.rastState;
 
@@ -497,7 +548,15 @@ void RasterizeTriangle(DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroTile,
     triDesc.Z[2] = a[2];
         
     // add depth bias
-    triDesc.Z[2] += ComputeDepthBias(&rastState, &triDesc, workDesc.pTriBuffer + 8);
+    float depthBias = ComputeDepthBias(&rastState, &triDesc, workDesc.pTriBuffer + 8);
+    triDesc.Z[2] += depthBias;
+
+    // depth range of the triangle, clamped to the viewport like ZTest does
+    const SWR_VIEWPORT &vp = state.vp[0];
+    float triMinZ = std::min(a[0], std::min(a[1], a[2])) + depthBias;
+    float triMaxZ = std::max(a[0], std::max(a[1], a[2])) + depthBias;
+    triMinZ = std::min(vp.maxZ, std::max(vp.minZ, triMinZ));
+    triMaxZ = std::min(vp.maxZ, std::max(vp.minZ, triMaxZ));
 
     // broadcast A and B coefs for each edge to all slots
     __m128i vAEdge0h = _mm_shuffle_epi32(vAi, _MM_SHUFFLE(0,0,0,0));
@@ -590,6 +649,41 @@ void RasterizeTriangle(DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroTile,
         return;
     }
 
+    RenderOutputBuffers renderBuffers, currentRenderBufferRow;
+    GetRenderHotTiles(pDC, macroTile, tileX, tileY, renderBuffers, MultisampleTraits<sampleCount>::numSamples,
+        triDesc.triFlags.renderTargetArrayIndex);
+
+    DEPTH_BOUNDS *pDepthBounds = renderBuffers.pDepthBounds;
+    bool depthBoundsCull = (pDepthBounds != nullptr) && CanRejectOnDepthBounds(state);
+    bool depthBoundsUpdate = (pDepthBounds != nullptr) && state.depthStencilState.depthWriteEnable;
+    bool depthWritten = false;
+
+    // depth plane in pixel coordinates, z = zA * x + zB * y + zC
+    float zA = 0.0f, zB = 0.0f, zC = 0.0f, depthBoundsEps = 0.0f;
+    if (depthBoundsCull)
+    {
+        zA = triDesc.recipDet * (triDesc.Z[0] * triDesc.I[0] + triDesc.Z[1] * triDesc.J[0]);
+        zB = triDesc.recipDet * (triDesc.Z[0] * triDesc.I[1] + triDesc.Z[1] * triDesc.J[1]);
+        zC = triDesc.recipDet * (triDesc.Z[0] * triDesc.I[2] + triDesc.Z[1] * triDesc.J[2]) + triDesc.Z[2];
+
+        // bound the error of the backend's z interpolation anywhere in the macrotile
+        float maxX = (float)((macroX + 1) * KNOB_MACROTILE_X_DIM);
+        float maxY = (float)((macroY + 1) * KNOB_MACROTILE_Y_DIM);
+        float magI = fabsf(triDesc.I[0]) * maxX + fabsf(triDesc.I[1]) * maxY + fabsf(triDesc.I[2]);
+        float magJ = fabsf(triDesc.J[0]) * maxX + fabsf(triDesc.J[1]) * maxY + fabsf(triDesc.J[2]);
+        float magZ = fabsf(triDesc.recipDet) * (fabsf(triDesc.Z[0]) * magI + fabsf(triDesc.Z[1]) * magJ) + fabsf(triDesc.Z[2]);
+        depthBoundsEps = (1.0f / (1 << 24)) + magZ * (1.0f / (1 << 18));
+
+        // whole triangle is occluded within this macrotile?
+        if (DepthBoundsReject(state.depthStencilState.depthTestFunc, triMinZ, triMaxZ,
+            pDepthBounds->macroMin, pDepthBounds->macroMax, depthBoundsEps))
+        {
+            UPDATE_STAT(DepthBoundsRejectedMacroTiles, 1);
+            RDTSC_STOP(BERasterizeTriangle, 1, 0);
+            return;
+        }
+    }
+
     RDTSC_START(BEStepSetup);
 
     // Step to pixel center of top-left pixel of the triangle bbox
@@ -713,16 +807,11 @@ void RasterizeTriangle(DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroTile,
     triDesc.pSamplePos = pDC->pState->state.samplePos;
 
     // compute steps between raster tiles for render output buffers
-    static const uint32_t colorRasterTileStep{(KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM * (FormatTraits<KNOB_COLOR_HOT_TILE_FORMAT>::bpp / 8)) * MultisampleTraits<sampleCount>::numSamples};
-    static const uint32_t colorRasterTileRowStep{(KNOB_MACROTILE_X_DIM / KNOB_TILE_X_DIM) * colorRasterTileStep};
+    // color steps depend on each hot tile's format, see StepRasterTileX/Y
     static const uint32_t depthRasterTileStep{(KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM * (FormatTraits<KNOB_DEPTH_HOT_TILE_FORMAT>::bpp / 8)) * MultisampleTraits<sampleCount>::numSamples};
     static const uint32_t depthRasterTileRowStep{(KNOB_MACROTILE_X_DIM / KNOB_TILE_X_DIM)* depthRasterTileStep};
     static const uint32_t stencilRasterTileStep{(KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM * (FormatTraits<KNOB_STENCIL_HOT_TILE_FORMAT>::bpp / 8)) * MultisampleTraits<sampleCount>::numSamples};
     static const uint32_t stencilRasterTileRowStep{(KNOB_MACROTILE_X_DIM / KNOB_TILE_X_DIM) * stencilRasterTileStep};
-    RenderOutputBuffers renderBuffers, currentRenderBufferRow;
-
-    GetRenderHotTiles(pDC, macroTile, tileX, tileY, renderBuffers, MultisampleTraits<sampleCount>::numSamples,
-        triDesc.triFlags.renderTargetArrayIndex);
     currentRenderBufferRow = renderBuffers;
 
     // rasterize and generate coverage masks per sample
@@ -737,6 +826,32 @@ void RasterizeTriangle(DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroTile,
         {
             uint64_t anyCoveredSamples = 0;
 
+            // raster tile within the macrotile
+            uint32_t rtX = tileX - macroX * KNOB_MACROTILE_X_DIM_IN_TILES;
+            uint32_t rtY = tileY - macroY * KNOB_MACROTILE_Y_DIM_IN_TILES;
+
+            // skip coverage and shading if the triangle is occluded in this raster tile
+            bool depthRejected = false;
+            if (depthBoundsCull)
+            {
+                float x0 = (float)(tileX << KNOB_TILE_X_DIM_SHIFT);
+                float y0 = (float)(tileY << KNOB_TILE_Y_DIM_SHIFT);
+                float zx0 = zA * x0, zx1 = zA * (x0 + KNOB_TILE_X_DIM);
+                float zy0 = zB * y0, zy1 = zB * (y0 + KNOB_TILE_Y_DIM);
+
+                float tileMinZ = std::max(triMinZ, zC + std::min(zx0, zx1) + std::min(zy0, zy1));
+                float tileMaxZ = std::min(triMaxZ, zC + std::max(zx0, zx1) + std::max(zy0, zy1));
+                tileMinZ = std::min(vp.maxZ, std::max(vp.minZ, tileMinZ));
+                tileMaxZ = std::min(vp.maxZ, std::max(vp.minZ, tileMaxZ));
+
+                depthRejected = DepthBoundsReject(state.depthStencilState.depthTestFunc, tileMinZ, tileMaxZ,
+                    pDepthBounds->tileMin[rtY][rtX], pDepthBounds->tileMax[rtY][rtX], depthBoundsEps);
+                if (depthRejected)
+                {
+                    UPDATE_STAT(DepthBoundsRejectedRasterTiles, 1);
+                }
+            }
+
             // is the corner of the edge outside of the raster tile? (vEdge < 0)
             int mask0, mask1, mask2;
             if(sampleCount == SWR_MULTISAMPLE_1X)
@@ -758,7 +873,7 @@ void RasterizeTriangle(DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroTile,
                 mask2 = _mm256_movemask_pd(vSampleBboxTest2);
             }
 
-            for (uint32_t sampleNum = 0; sampleNum < maxSamples; sampleNum++)
+            for (uint32_t sampleNum = 0; sampleNum < maxSamples && !depthRejected; sampleNum++)
             {
                 // trivial reject, at least one edge has all 4 corners of raster tile outside
                 bool trivialReject = (!(mask0 && mask1 && mask2)) ? true : false;
@@ -839,9 +954,20 @@ void RasterizeTriangle(DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroTile,
 #endif
             if(anyCoveredSamples)
             {
+                if (renderBuffers.numClearPending)
+                {
+                    ResolvePendingClears(renderBuffers, rtX, rtY);
+                }
+
                 RDTSC_START(BEPixelBackend);
                 pDC->pState->pfnBackend(pDC, workerId, tileX << KNOB_TILE_X_DIM_SHIFT, tileY << KNOB_TILE_Y_DIM_SHIFT, triDesc, renderBuffers);
                 RDTSC_STOP(BEPixelBackend, 0, 0);
+
+                if (depthBoundsUpdate)
+                {
+                    pDepthBounds->UpdateTile(rtX, rtY, (const float*)renderBuffers.pDepth, MultisampleTraits<sampleCount>::numSamples);
+                    depthWritten = true;
+                }
             }
 
             // step to the next tile in X
@@ -849,7 +975,7 @@ void RasterizeTriangle(DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroTile,
             vEdgeFix16[1] = _mm256_add_pd(vEdgeFix16[1], vTileStepX1Fix16);
             vEdgeFix16[2] = _mm256_add_pd(vEdgeFix16[2], vTileStepX2Fix16);
 
-            StepRasterTileX(state.psState.maxRTSlotUsed, renderBuffers, colorRasterTileStep, depthRasterTileStep, stencilRasterTileStep);
+            StepRasterTileX(state.psState.maxRTSlotUsed, renderBuffers, MultisampleTraits<sampleCount>::numSamples, depthRasterTileStep, stencilRasterTileStep);
         }
 
         // step to the next tile in Y
@@ -857,7 +983,12 @@ void RasterizeTriangle(DRAW_CONTEXT* pDC, uint32_t workerId, uint32_t macroTile,
         vEdgeFix16[1] = _mm256_add_pd(vStartOfRowEdge1, vTileStepY1Fix16);
         vEdgeFix16[2] = _mm256_add_pd(vStartOfRowEdge2, vTileStepY2Fix16);
 
-        StepRasterTileY(state.psState.maxRTSlotUsed, renderBuffers, currentRenderBufferRow, colorRasterTileRowStep, depthRasterTileRowStep, stencilRasterTileRowStep);
+        StepRasterTileY(state.psState.maxRTSlotUsed, renderBuffers, currentRenderBufferRow, MultisampleTraits<sampleCount>::numSamples, depthRasterTileRowStep, stencilRasterTileRowStep);
+    }
+
+    if (depthWritten)
+    {
+        pDepthBounds->UpdateMacroTile();
     }
 
     RDTSC_STOP(BERasterizeTriangle, 1, 0);
@@ -917,9 +1048,26 @@ void RasterizePoint(DRAW_CONTEXT *pDC, uint32_t workerId, const TRIANGLE_WORK_DE
     GetRenderHotTiles(pDC, macroTile, tileAlignedX >> KNOB_TILE_X_DIM_SHIFT , tileAlignedY >> KNOB_TILE_Y_DIM_SHIFT, 
         renderBuffers, 1, triDesc.triFlags.renderTargetArrayIndex);
 
+    // raster tile within the macrotile
+    uint32_t macroX, macroY;
+    MacroTileMgr::getTileIndices(macroTile, macroX, macroY);
+    uint32_t rtX = (tileAlignedX >> KNOB_TILE_X_DIM_SHIFT) - macroX * KNOB_MACROTILE_X_DIM_IN_TILES;
+    uint32_t rtY = (tileAlignedY >> KNOB_TILE_Y_DIM_SHIFT) - macroY * KNOB_MACROTILE_Y_DIM_IN_TILES;
+
+    if (renderBuffers.numClearPending)
+    {
+        ResolvePendingClears(renderBuffers, rtX, rtY);
+    }
+
     RDTSC_START(BEPixelBackend);
     pDC->pState->pfnBackend(pDC, workerId, tileAlignedX, tileAlignedY, triDesc, renderBuffers);
     RDTSC_STOP(BEPixelBackend, 0, 0);
+
+    if (renderBuffers.pDepthBounds && GetApiState(pDC).depthStencilState.depthWriteEnable)
+    {
+        renderBuffers.pDepthBounds->UpdateTile(rtX, rtY, (const float*)renderBuffers.pDepth, 1);
+        renderBuffers.pDepthBounds->UpdateMacroTile();
+    }
 }
 
 void rastPoint(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTile, void *pData)
@@ -928,6 +1076,17 @@ void rastPoint(DRAW_CONTEXT *pDC, uint32_t workerId, uint32_t macroTile, void *p
     RasterizePoint(pDC, workerId, *pDesc, macroTile);
 
 }
+INLINE
+void AddClearPending(RenderOutputBuffers &renderBuffers, HOTTILE *pHotTile, SWR_RENDERTARGET_ATTACHMENT attachment)
+{
+    if (pHotTile->clearMask != 0)
+    {
+        renderBuffers.pClearPending[renderBuffers.numClearPending] = pHotTile;
+        renderBuffers.clearPendingAttachment[renderBuffers.numClearPending] = attachment;
+        renderBuffers.numClearPending++;
+    }
+}
+
 // Get pointers to hot tile memory for color RT, depth, stencil
 void GetRenderHotTiles(DRAW_CONTEXT *pDC, uint32_t macroID, uint32_t tileX, uint32_t tileY, RenderOutputBuffers &renderBuffers, 
     uint32_t numSamples, uint32_t renderTargetArrayIndex)
@@ -937,6 +1096,9 @@ void GetRenderHotTiles(DRAW_CONTEXT *pDC, uint32_t macroID, uint32_t tileX, uint
     const SWR_DEPTH_STENCIL_STATE *pDSState = &state.depthStencilState;
     const uint32_t MaxRT = state.psState.maxRTSlotUsed;
 
+    renderBuffers.pDepthBounds = nullptr;
+    renderBuffers.numClearPending = 0;
+
     uint32_t mx, my;
     MacroTileMgr::getTileIndices(macroID, mx, my);
     tileX -= KNOB_MACROTILE_X_DIM_IN_TILES * mx;
@@ -944,16 +1106,30 @@ void GetRenderHotTiles(DRAW_CONTEXT *pDC, uint32_t macroID, uint32_t tileX, uint
 
     if(state.psState.pfnPixelShader != NULL)
     {
-        // compute tile offset for active hottile buffers
+        // compute tile offset for active hottile buffers, per format
         const uint32_t pitch = KNOB_MACROTILE_X_DIM * FormatTraits<KNOB_COLOR_HOT_TILE_FORMAT>::bpp / 8;
         uint32_t offset = ComputeTileOffset2D<TilingTraits<SWR_TILE_SWRZ, FormatTraits<KNOB_COLOR_HOT_TILE_FORMAT>::bpp> >(pitch, tileX, tileY);
         offset*=numSamples;
+        const uint32_t compactPitch = KNOB_MACROTILE_X_DIM * FormatTraits<KNOB_COMPACT_COLOR_HOT_TILE_FORMAT>::bpp / 8;
+        uint32_t compactOffset = ComputeTileOffset2D<TilingTraits<SWR_TILE_SWRZ, FormatTraits<KNOB_COMPACT_COLOR_HOT_TILE_FORMAT>::bpp> >(compactPitch, tileX, tileY);
+        compactOffset*=numSamples;
         for(uint32_t rt = 0; rt <= MaxRT; ++rt)
         {
             HOTTILE *pColor = pContext->pHotTileMgr->GetHotTile(pContext, pDC, macroID, (SWR_RENDERTARGET_ATTACHMENT)(SWR_ATTACHMENT_COLOR0 + rt), true, 
                 numSamples, renderTargetArrayIndex);
             pColor->state = HOTTILE_DIRTY;
-            renderBuffers.pColor[rt] = pColor->pBuffer + offset;
+            renderBuffers.colorFormat[rt] = pColor->format;
+            if (pColor->format == KNOB_COMPACT_COLOR_HOT_TILE_FORMAT)
+            {
+                renderBuffers.pColor[rt] = pColor->pBuffer + compactOffset;
+                renderBuffers.colorSampleStep[rt] = KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM * FormatTraits<KNOB_COMPACT_COLOR_HOT_TILE_FORMAT>::bpp / 8;
+            }
+            else
+            {
+                renderBuffers.pColor[rt] = pColor->pBuffer + offset;
+                renderBuffers.colorSampleStep[rt] = KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM * FormatTraits<KNOB_COLOR_HOT_TILE_FORMAT>::bpp / 8;
+            }
+            AddClearPending(renderBuffers, pColor, (SWR_RENDERTARGET_ATTACHMENT)(SWR_ATTACHMENT_COLOR0 + rt));
         }
     }
     if(pDSState->depthTestEnable || pDSState->depthWriteEnable)
@@ -966,6 +1142,8 @@ void GetRenderHotTiles(DRAW_CONTEXT *pDC, uint32_t macroID, uint32_t tileX, uint
         pDepth->state = HOTTILE_DIRTY;
         SWR_ASSERT(pDepth->pBuffer != nullptr);
         renderBuffers.pDepth = pDepth->pBuffer + offset;
+        renderBuffers.pDepthBounds = pDepth->pDepthBounds;
+        AddClearPending(renderBuffers, pDepth, SWR_ATTACHMENT_DEPTH);
     }
     if(pDSState->stencilTestEnable)
     {
@@ -977,15 +1155,16 @@ void GetRenderHotTiles(DRAW_CONTEXT *pDC, uint32_t macroID, uint32_t tileX, uint
         pStencil->state = HOTTILE_DIRTY;
         SWR_ASSERT(pStencil->pBuffer != nullptr);
         renderBuffers.pStencil = pStencil->pBuffer + offset;
+        AddClearPending(renderBuffers, pStencil, SWR_ATTACHMENT_STENCIL);
     }
 }
 
 INLINE
-void StepRasterTileX(uint32_t MaxRT, RenderOutputBuffers &buffers, uint32_t colorTileStep, uint32_t depthTileStep, uint32_t stencilTileStep)
+void StepRasterTileX(uint32_t MaxRT, RenderOutputBuffers &buffers, uint32_t numSamples, uint32_t depthTileStep, uint32_t stencilTileStep)
 {
     for(uint32_t rt = 0; rt <= MaxRT; ++rt)
     {
-        buffers.pColor[rt] += colorTileStep;
+        buffers.pColor[rt] += buffers.colorSampleStep[rt] * numSamples;
     }
     
     buffers.pDepth += depthTileStep;
@@ -993,11 +1172,11 @@ void StepRasterTileX(uint32_t MaxRT, RenderOutputBuffers &buffers, uint32_t colo
 }
 
 INLINE
-void StepRasterTileY(uint32_t MaxRT, RenderOutputBuffers &buffers, RenderOutputBuffers &startBufferRow, uint32_t colorRowStep, uint32_t depthRowStep, uint32_t stencilRowStep)
+void StepRasterTileY(uint32_t MaxRT, RenderOutputBuffers &buffers, RenderOutputBuffers &startBufferRow, uint32_t numSamples, uint32_t depthRowStep, uint32_t stencilRowStep)
 {
     for(uint32_t rt = 0; rt <= MaxRT; ++rt)
     {
-        startBufferRow.pColor[rt] += colorRowStep;
+        startBufferRow.pColor[rt] += (KNOB_MACROTILE_X_DIM / KNOB_TILE_X_DIM) * buffers.colorSampleStep[rt] * numSamples;
         buffers.pColor[rt] = startBufferRow.pColor[rt];
     }
     startBufferRow.pDepth += depthRowStep;
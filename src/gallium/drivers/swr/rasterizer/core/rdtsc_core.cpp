@@ -28,11 +28,12 @@
 BUCKET_DESC gCoreBuckets[] = {
     { "APIClearRenderTarget", "", true, 0xff0b8bea },
     { "APIDraw", "", true, 0xff000066 },
-    { "APIDrawWakeAllThreads", "", false, 0xffffffff },
+    { "APIDrawWakeWorkers", "", false, 0xffffffff },
     { "APIDrawIndexed", "", true, 0xff000066 },
     { "APIDispatch", "", true, 0xff660000 },
     { "APIStoreTiles", "", true, 0xff00ffff },
     { "APIGetDrawContext", "", false, 0xffffffff },
+    { "APIDrawRingStall", "", false, 0xffffffff },
     { "APISync", "", true, 0xff6666ff },
     { "FEProcessDraw", "", true, 0xff009900 },
     { "FEProcessDrawIndexed", "", true, 0xff009900 },
@@ -59,6 +60,7 @@ BUCKET_DESC gCoreBuckets[] = {
     { "FEProcessInvalidateTiles", "", true, 0xffffffff },
     { "WorkerWorkOnFifoBE", "", false, 0xff40261c },
     { "WorkerFoundWork", "", false, 0xff573326 },
+    { "WorkerPublishDraws", "", false, 0xffffffff },
     { "BELoadTiles", "", true, 0xffb0e2ff },
     { "BEDispatch", "", true, 0xff00a2ff },
     { "BEClear", "", true, 0xff00ccbb },
@@ -33,11 +33,12 @@ enum CORE_BUCKETS
 {
     APIClearRenderTarget,
     APIDraw,
-    APIDrawWakeAllThreads,
+    APIDrawWakeWorkers,
     APIDrawIndexed,
     APIDispatch,
     APIStoreTiles,
     APIGetDrawContext,
+    APIDrawRingStall,
     APISync,
     FEProcessDraw,
     FEProcessDrawIndexed,
@@ -64,6 +65,7 @@ enum CORE_BUCKETS
     FEProcessInvalidateTiles,
     WorkerWorkOnFifoBE,
     WorkerFoundWork,
+    WorkerPublishDraws,
     BELoadTiles,
     BEDispatch,
     BEClear,
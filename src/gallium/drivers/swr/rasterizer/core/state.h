@@ -529,12 +529,45 @@ struct SWR_STATS
     uint64_t CPrimitives;   // Number of clipper primitives.
     uint64_t GsPrimitives;  // Number of prims GS outputs.
 
+    // Depth bounds culling
+    uint64_t DepthBoundsRejectedMacroTiles;  // Number of triangle macrotiles rejected by depth bounds.
+    uint64_t DepthBoundsRejectedRasterTiles; // Number of triangle raster tiles rejected by depth bounds.
+
     // Streamout Stats
     uint32_t SoWriteOffset[4];
     uint64_t SoPrimStorageNeeded[4];
     uint64_t SoNumPrimsWritten[4];
 };
 
+//////////////////////////////////////////////////////////////////////////
+/// SWR_ARENA_STATS
+///
+/// @brief Arena memory statistics. Once a workload reaches steady state
+///        numBlockAllocs and numBlockFrees should stop changing.
+/////////////////////////////////////////////////////////////////////////
+struct SWR_ARENA_STATS
+{
+    uint64_t numBlockAllocs;    // Number of arena blocks allocated from the system.
+    uint64_t numBlockFrees;     // Number of arena blocks returned to the system.
+    uint64_t numBlockReuses;    // Number of arena blocks handed out from the block pool.
+    uint64_t numBlocksInUse;    // Blocks currently owned by arenas.
+    uint64_t numBlocksCached;   // Blocks currently held by the block pool.
+    uint64_t bytesAllocated;    // Total size of all blocks allocated from the system.
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// SWR_API_STATS
+///
+/// @brief Statistics about the API thread and worker scheduling.
+/////////////////////////////////////////////////////////////////////////
+struct SWR_API_STATS
+{
+    uint64_t numDrawRingStalls;     // Number of times a new draw had to wait on a full DC ring.
+    uint64_t drawRingStallCycles;   // Total time spent waiting on a full DC ring, in rdtsc cycles.
+    uint64_t numWorkerWakes;        // Number of parked workers woken up for new work.
+    uint64_t numWorkerParks;        // Number of times a worker ran out of work and parked.
+};
+
 //////////////////////////////////////////////////////////////////////////
 /// STREAMOUT_BUFFERS
 /////////////////////////////////////////////////////////////////////////
@@ -850,6 +883,12 @@ struct SWR_RASTSTATE
     // user clip/cull distance enables
     uint8_t cullDistanceMask;
     uint8_t clipDistanceMask;
+
+    // requested hot tile format per render target. KNOB_COMPACT_COLOR_HOT_TILE_FORMAT
+    // is only exact for unorm8 surfaces, anything else selects KNOB_COLOR_HOT_TILE_FORMAT.
+    // picked up when a hot tile is (re)loaded or cleared, blended render targets always
+    // use KNOB_COLOR_HOT_TILE_FORMAT.
+    SWR_FORMAT colorHotTileFormat[SWR_NUM_RENDERTARGETS];  // @llvm_enum
 };
 
 // backend state
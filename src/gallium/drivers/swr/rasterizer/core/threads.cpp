@@ -30,6 +30,8 @@
 #include <utility>
 #include <fstream>
 #include <string>
+#include <map>
+#include <algorithm>
 
 #if defined(__linux__) || defined(__gnu_linux__)
 #include <numa.h>
@@ -51,16 +53,63 @@
 struct Core
 {
     uint32_t                procGroup = 0;
+    uint32_t                cacheGroup = 0;     // cores with the same cacheGroup share an L3
     std::vector<uint32_t>   threadIds;
 };
 
 struct NumaNode
 {
-    std::vector<Core> cores;
+    uint32_t            numaId = 0;             // OS NUMA node id
+    std::vector<Core>   cores;
 };
 
 typedef std::vector<NumaNode> CPUNumaNodes;
 
+#if defined(__linux__) || defined(__gnu_linux__)
+//////////////////////////////////////////////////////////////////////////
+/// @brief Reads a single unsigned value from a sysfs file.
+static bool ReadSysfsUint(const std::string& path, uint32_t& value)
+{
+    std::ifstream input(path);
+    return (bool)(input >> value);
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Reads a sysfs list file such as "0-3,8,10-11".
+static bool ReadSysfsList(const std::string& path, std::vector<uint32_t>& values)
+{
+    std::ifstream input(path);
+    std::string line;
+    if (!std::getline(input, line))
+    {
+        return false;
+    }
+
+    values.clear();
+
+    const char* c = line.c_str();
+    while (*c >= '0' && *c <= '9')
+    {
+        char* end;
+        uint32_t first = strtoul(c, &end, 10);
+        uint32_t last = first;
+        if (*end == '-')
+        {
+            last = strtoul(end + 1, &end, 10);
+        }
+
+        for (uint32_t v = first; v <= last; ++v)
+        {
+            values.push_back(v);
+        }
+
+        c = (*end == ',') ? end + 1 : end;
+    }
+
+    return values.size() > 0;
+}
+#endif
+
 void CalculateProcessorTopology(CPUNumaNodes& out_nodes)
 {
     out_nodes.clear();
@@ -105,6 +154,7 @@ void CalculateProcessorTopology(CPUNumaNodes& out_nodes)
                 // Store data
                 if (out_nodes.size() <= numaId) out_nodes.resize(numaId + 1);
                 auto& numaNode = out_nodes[numaId];
+                numaNode.numaId = numaId;
 
                 uint32_t coreId = 0;
 
@@ -133,69 +183,103 @@ void CalculateProcessorTopology(CPUNumaNodes& out_nodes)
 
 #elif defined(__linux__) || defined (__gnu_linux__)
 
-    // Parse /proc/cpuinfo to get full topology
-    std::ifstream input("/proc/cpuinfo");
-    std::string line;
-    char* c;
-    uint32_t threadId = uint32_t(-1);
-    uint32_t coreId = uint32_t(-1);
-    uint32_t numaId = uint32_t(-1);
+    // Only use CPUs that are online and that we're allowed to run on (cgroups/cpusets, taskset).
+    std::vector<uint32_t> onlineCpus;
+    if (!ReadSysfsList("/sys/devices/system/cpu/online", onlineCpus))
+    {
+        long numCpus = sysconf(_SC_NPROCESSORS_CONF);
+        for (long cpu = 0; cpu < numCpus; ++cpu)
+        {
+            onlineCpus.push_back((uint32_t)cpu);
+        }
+    }
 
-    while (std::getline(input, line))
+    cpu_set_t allowedCpus;
+    CPU_ZERO(&allowedCpus);
+    bool haveAffinity = (sched_getaffinity(0, sizeof(allowedCpus), &allowedCpus) == 0);
+
+    // cpu -> NUMA node. Without node information everything is on node 0.
+    std::map<uint32_t, uint32_t> cpuToNode;
+    std::vector<uint32_t> nodeIds;
+    if (ReadSysfsList("/sys/devices/system/node/online", nodeIds))
     {
-        if (line.find("processor") != std::string::npos)
+        for (uint32_t nodeId : nodeIds)
         {
-            if (threadId != uint32_t(-1))
+            std::vector<uint32_t> nodeCpus;
+            ReadSysfsList("/sys/devices/system/node/node" + std::to_string(nodeId) + "/cpulist", nodeCpus);
+            for (uint32_t cpu : nodeCpus)
             {
-                // Save information.
-                if (out_nodes.size() <= numaId) out_nodes.resize(numaId + 1);
-                auto& numaNode = out_nodes[numaId];
-                if (numaNode.cores.size() <= coreId) numaNode.cores.resize(coreId + 1);
-                auto& core = numaNode.cores[coreId];
-
-                core.procGroup = coreId;
-                core.threadIds.push_back(threadId);
+                cpuToNode[cpu] = nodeId;
             }
+        }
+    }
 
-            auto data_start = line.find(": ") + 2;
-            threadId = std::strtoul(&line.c_str()[data_start], &c, 10);
+    // node id -> (package, core id) -> core
+    std::map<uint32_t, std::map<std::pair<uint32_t, uint32_t>, Core>> topology;
+
+    for (uint32_t cpu : onlineCpus)
+    {
+        if (haveAffinity && (cpu >= CPU_SETSIZE || !CPU_ISSET(cpu, &allowedCpus)))
+        {
             continue;
         }
-        if (line.find("core id") != std::string::npos)
+
+        std::string cpuPath = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+
+        uint32_t packageId = 0;
+        uint32_t coreId = cpu;
+        ReadSysfsUint(cpuPath + "/topology/physical_package_id", packageId);
+        ReadSysfsUint(cpuPath + "/topology/core_id", coreId);
+
+        // Group cores by the first CPU of the L3 they share, a package if there is no L3.
+        uint32_t cacheGroup = uint32_t(-1);
+        for (uint32_t index = 0; ; ++index)
         {
-            auto data_start = line.find(": ") + 2;
-            coreId = std::strtoul(&line.c_str()[data_start], &c, 10);
-            continue;
+            std::string cachePath = cpuPath + "/cache/index" + std::to_string(index);
+            uint32_t level = 0;
+            if (!ReadSysfsUint(cachePath + "/level", level))
+            {
+                break;
+            }
+
+            std::vector<uint32_t> sharedCpus;
+            if (level == 3 && ReadSysfsList(cachePath + "/shared_cpu_list", sharedCpus) && sharedCpus.size())
+            {
+                cacheGroup = *std::min_element(sharedCpus.begin(), sharedCpus.end());
+                break;
+            }
         }
-        if (line.find("physical id") != std::string::npos)
+        if (cacheGroup == uint32_t(-1))
         {
-            auto data_start = line.find(": ") + 2;
-            numaId = std::strtoul(&line.c_str()[data_start], &c, 10);
-            continue;
+            cacheGroup = packageId << 16;
         }
-    }
 
-    if (threadId != uint32_t(-1))
-    {
-        // Save information.
-        if (out_nodes.size() <= numaId) out_nodes.resize(numaId + 1);
-        auto& numaNode = out_nodes[numaId];
-        if (numaNode.cores.size() <= coreId) numaNode.cores.resize(coreId + 1);
-        auto& core = numaNode.cores[coreId];
+        auto node = cpuToNode.find(cpu);
+        uint32_t numaId = (node != cpuToNode.end()) ? node->second : 0;
 
-        core.procGroup = coreId;
-        core.threadIds.push_back(threadId);
+        Core& core = topology[numaId][std::make_pair(packageId, coreId)];
+        core.cacheGroup = cacheGroup;
+        core.threadIds.push_back(cpu);
     }
 
-    for (uint32_t node = 0; node < out_nodes.size(); node++) {
-        auto& numaNode = out_nodes[node];
-        auto it = numaNode.cores.begin();
-        for ( ; it != numaNode.cores.end(); ) {
-            if (it->threadIds.size() == 0)
-                numaNode.cores.erase(it);
-            else
-                ++it;
+    // Nodes without any usable CPU are left out, so node indices are dense but
+    // don't have to match the OS node ids.
+    for (auto& node : topology)
+    {
+        out_nodes.push_back(NumaNode());
+        NumaNode& numaNode = out_nodes.back();
+        numaNode.numaId = node.first;
+
+        for (auto& core : node.second)
+        {
+            numaNode.cores.push_back(core.second);
+            std::sort(numaNode.cores.back().threadIds.begin(), numaNode.cores.back().threadIds.end());
         }
+
+        // Keep cores sharing an L3 next to each other, workers get consecutive ids in this
+        // order so the macrotile scheduler steals from cache neighbours first.
+        std::stable_sort(numaNode.cores.begin(), numaNode.cores.end(),
+            [](const Core& a, const Core& b) { return a.cacheGroup < b.cacheGroup; });
     }
 
 #else
@@ -251,7 +335,7 @@ uint64_t GetEnqueuedDraw(SWR_CONTEXT *pContext)
 INLINE
 DRAW_CONTEXT *GetDC(SWR_CONTEXT *pContext, uint64_t drawId)
 {
-    return &pContext->dcRing[(drawId-1) % KNOB_MAX_DRAWS_IN_FLIGHT];
+    return &pContext->dcRing[(drawId-1) % pContext->MaxDrawsInFlight];
 }
 
 // returns true if dependency not met
@@ -261,88 +345,10 @@ bool CheckDependency(SWR_CONTEXT *pContext, DRAW_CONTEXT *pDC, uint64_t lastReti
     return (pDC->dependency > lastRetiredDraw);
 }
 
-void ClearColorHotTile(const HOTTILE* pHotTile)  // clear a macro tile from float4 clear data.
-{
-    // Load clear color into SIMD register...
-    float *pClearData = (float*)(pHotTile->clearData);
-    simdscalar valR = _simd_broadcast_ss(&pClearData[0]);
-    simdscalar valG = _simd_broadcast_ss(&pClearData[1]);
-    simdscalar valB = _simd_broadcast_ss(&pClearData[2]);
-    simdscalar valA = _simd_broadcast_ss(&pClearData[3]);
-
-    float *pfBuf = (float*)pHotTile->pBuffer;
-    uint32_t numSamples = pHotTile->numSamples;
-
-    for (uint32_t row = 0; row < KNOB_MACROTILE_Y_DIM; row += KNOB_TILE_Y_DIM)
-    {
-        for (uint32_t col = 0; col < KNOB_MACROTILE_X_DIM; col += KNOB_TILE_X_DIM)
-        {
-            for (uint32_t si = 0; si < (KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM * numSamples); si += SIMD_TILE_X_DIM * SIMD_TILE_Y_DIM) //SIMD_TILE_X_DIM * SIMD_TILE_Y_DIM); si++)
-            {
-                _simd_store_ps(pfBuf, valR);
-                pfBuf += KNOB_SIMD_WIDTH;
-                _simd_store_ps(pfBuf, valG);
-                pfBuf += KNOB_SIMD_WIDTH;
-                _simd_store_ps(pfBuf, valB);
-                pfBuf += KNOB_SIMD_WIDTH;
-                _simd_store_ps(pfBuf, valA);
-                pfBuf += KNOB_SIMD_WIDTH;
-            }
-        }
-    }
-}
-
-void ClearDepthHotTile(const HOTTILE* pHotTile)  // clear a macro tile from float4 clear data.
-{
-    // Load clear color into SIMD register...
-    float *pClearData = (float*)(pHotTile->clearData);
-    simdscalar valZ = _simd_broadcast_ss(&pClearData[0]);
-
-    float *pfBuf = (float*)pHotTile->pBuffer;
-    uint32_t numSamples = pHotTile->numSamples;
-
-    for (uint32_t row = 0; row < KNOB_MACROTILE_Y_DIM; row += KNOB_TILE_Y_DIM)
-    {
-        for (uint32_t col = 0; col < KNOB_MACROTILE_X_DIM; col += KNOB_TILE_X_DIM)
-        {
-            for (uint32_t si = 0; si < (KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM * numSamples); si += SIMD_TILE_X_DIM * SIMD_TILE_Y_DIM)
-            {
-                _simd_store_ps(pfBuf, valZ);
-                pfBuf += KNOB_SIMD_WIDTH;
-            }
-        }
-    }
-}
-
-void ClearStencilHotTile(const HOTTILE* pHotTile)
-{
-    // convert from F32 to U8.
-    uint8_t clearVal = (uint8_t)(pHotTile->clearData[0]);
-    //broadcast 32x into __m256i...
-    simdscalari valS = _simd_set1_epi8(clearVal);
-
-    simdscalari* pBuf = (simdscalari*)pHotTile->pBuffer;
-    uint32_t numSamples = pHotTile->numSamples;
-
-    for (uint32_t row = 0; row < KNOB_MACROTILE_Y_DIM; row += KNOB_TILE_Y_DIM)
-    {
-        for (uint32_t col = 0; col < KNOB_MACROTILE_X_DIM; col += KNOB_TILE_X_DIM)
-        {
-            // We're putting 4 pixels in each of the 32-bit slots, so increment 4 times as quickly.
-            for (uint32_t si = 0; si < (KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM * numSamples); si += SIMD_TILE_X_DIM * SIMD_TILE_Y_DIM * 4)
-            {
-                _simd_store_si(pBuf, valS);
-                pBuf += 1;
-            }
-        }
-    }
-}
-
 // for draw calls, we initialize the active hot tiles and perform deferred
 // load on them if tile is in invalid state. we do this in the outer thread loop instead of inside
 // the draw routine itself mainly for performance, to avoid unnecessary setup
-// every triangle
-// @todo support deferred clear
+// every triangle. pending clears are deferred to the raster tiles, see HotTileMgr::DeferClear
 INLINE
 void InitializeHotTiles(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, uint32_t macroID, const TRIANGLE_WORK_DESC* pWork)
 {
@@ -364,22 +370,30 @@ void InitializeHotTiles(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, uint32_t macro
         for (uint32_t rt = 0; rt < numRTs; ++rt)
         {
             HOTTILE* pHotTile = pHotTileMgr->GetHotTile(pContext, pDC, macroID, (SWR_RENDERTARGET_ATTACHMENT)(SWR_ATTACHMENT_COLOR0 + rt), true, numSamples);
+            SWR_FORMAT format = HotTileMgr::GetColorHotTileFormat(state.rastState.colorHotTileFormat[rt],
+                state.blendState.renderTarget[rt].colorBlendEnable);
 
             if (pHotTile->state == HOTTILE_INVALID)
             {
                 RDTSC_START(BELoadTiles);
                 // invalid hottile before draw requires a load from surface before we can draw to it
-                pContext->pfnLoadTile(GetPrivateState(pDC), KNOB_COLOR_HOT_TILE_FORMAT, (SWR_RENDERTARGET_ATTACHMENT)(SWR_ATTACHMENT_COLOR0 + rt), x, y, pHotTile->renderTargetArrayIndex, pHotTile->pBuffer);
+                pHotTile->format = format;
+                pContext->pfnLoadTile(GetPrivateState(pDC), pHotTile->format, (SWR_RENDERTARGET_ATTACHMENT)(SWR_ATTACHMENT_COLOR0 + rt), x, y, pHotTile->renderTargetArrayIndex, pHotTile->pBuffer);
+                pHotTile->clearMask = 0;
                 pHotTile->state = HOTTILE_DIRTY;
                 RDTSC_STOP(BELoadTiles, 0, 0);
             }
             else if (pHotTile->state == HOTTILE_CLEAR)
             {
-                RDTSC_START(BELoadTiles);
-                // Clear the tile.
-                ClearColorHotTile(pHotTile);
-                pHotTile->state = HOTTILE_DIRTY;
-                RDTSC_STOP(BELoadTiles, 0, 0);
+                // no contents to preserve, free to switch format
+                pHotTile->format = format;
+                HotTileMgr::DeferClear(pHotTile);
+            }
+            else if (pHotTile->format != format && format == KNOB_COLOR_HOT_TILE_FORMAT)
+            {
+                // blending needs the float hot tile. a float tile that is no
+                // longer blended stays float until it is reloaded or cleared.
+                HotTileMgr::ExpandColorHotTile(pHotTile);
             }
         }
     }
@@ -393,16 +407,14 @@ void InitializeHotTiles(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, uint32_t macro
             RDTSC_START(BELoadTiles);
             // invalid hottile before draw requires a load from surface before we can draw to it
             pContext->pfnLoadTile(GetPrivateState(pDC), KNOB_DEPTH_HOT_TILE_FORMAT, SWR_ATTACHMENT_DEPTH, x, y, pHotTile->renderTargetArrayIndex, pHotTile->pBuffer);
+            pHotTile->pDepthBounds->SetUnknown();
+            pHotTile->clearMask = 0;
             pHotTile->state = HOTTILE_DIRTY;
             RDTSC_STOP(BELoadTiles, 0, 0);
         }
         else if (pHotTile->state == HOTTILE_CLEAR)
         {
-            RDTSC_START(BELoadTiles);
-            // Clear the tile.
-            ClearDepthHotTile(pHotTile);
-            pHotTile->state = HOTTILE_DIRTY;
-            RDTSC_STOP(BELoadTiles, 0, 0);
+            HotTileMgr::DeferClear(pHotTile);
         }
     }
 
@@ -415,27 +427,41 @@ void InitializeHotTiles(SWR_CONTEXT* pContext, DRAW_CONTEXT* pDC, uint32_t macro
             RDTSC_START(BELoadTiles);
             // invalid hottile before draw requires a load from surface before we can draw to it
             pContext->pfnLoadTile(GetPrivateState(pDC), KNOB_STENCIL_HOT_TILE_FORMAT, SWR_ATTACHMENT_STENCIL, x, y, pHotTile->renderTargetArrayIndex, pHotTile->pBuffer);
+            pHotTile->clearMask = 0;
             pHotTile->state = HOTTILE_DIRTY;
             RDTSC_STOP(BELoadTiles, 0, 0);
         }
         else if (pHotTile->state == HOTTILE_CLEAR)
         {
-            RDTSC_START(BELoadTiles);
-            // Clear the tile.
-            ClearStencilHotTile(pHotTile);
-            pHotTile->state = HOTTILE_DIRTY;
-            RDTSC_STOP(BELoadTiles, 0, 0);
+            HotTileMgr::DeferClear(pHotTile);
         }
     }
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Wakes up the API thread if it is waiting for a draw to retire.
+///        Called by workers after their draw counters moved forward.
+/// @param pContext - pointer to SWR context.
+INLINE void NotifyDrawRetired(SWR_CONTEXT* pContext)
+{
+    // pairs with the fence in WaitForDrawRetire, the counter update has to be
+    // visible before we check whether the API thread is waiting.
+    _mm_mfence();
+
+    if (pContext->ApiWaitingForRetire)
+    {
+        std::lock_guard<std::mutex> lock(pContext->RetireLock);
+        pContext->DrawRetired.notify_one();
+    }
+}
+
 INLINE bool FindFirstIncompleteDraw(SWR_CONTEXT* pContext, volatile uint64_t& curDrawBE)
 {
     // increment our current draw id to the first incomplete draw
     uint64_t drawEnqueued = GetEnqueuedDraw(pContext);
     while (curDrawBE < drawEnqueued)
     {
-        DRAW_CONTEXT *pDC = &pContext->dcRing[curDrawBE % KNOB_MAX_DRAWS_IN_FLIGHT];
+        DRAW_CONTEXT *pDC = &pContext->dcRing[curDrawBE % pContext->MaxDrawsInFlight];
 
         // If its not compute and FE is not done then break out of loop.
         if (!pDC->doneFE && !pDC->isCompute) break;
@@ -464,18 +490,12 @@ INLINE bool FindFirstIncompleteDraw(SWR_CONTEXT* pContext, volatile uint64_t& cu
 /// @param curDrawBE - This tracks the draw contexts that this thread has processed. Each worker thread
 ///                    has its own curDrawBE counter and this ensures that each worker processes all the
 ///                    draws in order.
-/// @param lockedTiles - This is the set of tiles locked by other threads. Each thread maintains its
-///                      own set and each time it fails to lock a macrotile, because its already locked,
-///                      then it will add that tile to the lockedTiles set. As a worker begins to work
-///                      on future draws the lockedTiles ensure that it doesn't work on tiles that may
-///                      still have work pending in a previous draw. Additionally, the lockedTiles is
-///                      hueristic that can steer a worker back to the same macrotile that it had been
-///                      working on in a previous draw.
+/// @param numaNode - NUMA node of the worker. Macrotiles owned by this node are preferred.
 void WorkOnFifoBE(
     SWR_CONTEXT *pContext,
     uint32_t workerId,
     volatile uint64_t &curDrawBE,
-    std::unordered_set<uint32_t>& lockedTiles)
+    uint32_t numaNode)
 {
     // Find the first incomplete draw that has pending work. If no such draw is found then
     // return. FindFirstIncompleteDraw is responsible for incrementing the curDrawBE.
@@ -484,95 +504,84 @@ void WorkOnFifoBE(
         return;
     }
 
-    uint64_t lastRetiredDraw = pContext->dcRing[curDrawBE % KNOB_MAX_DRAWS_IN_FLIGHT].drawId - 1;
-
-    // Reset our history for locked tiles. We'll have to re-learn which tiles are locked.
-    lockedTiles.clear();
+    MacroTileScheduler *pScheduler = pContext->pTileScheduler;
+    uint32_t localNode = numaNode % pContext->pHotTileMgr->GetNumNumaNodes();
 
-    // Try to work on each draw in order of the available draws in flight.
-    //   1. If we're on curDrawBE, we can work on any macrotile that is available.
-    //   2. If we're trying to work on draws after curDrawBE, we are restricted to 
-    //      working on those macrotiles that are known to be complete in the prior draw to
-    //      maintain order. The locked tiles provides the history to ensures this.
-    for (uint64_t i = curDrawBE; i < GetEnqueuedDraw(pContext); ++i)
+    // The scheduler only ever hands out a macrotile once all prior draws are done with it,
+    // so any work we get can be processed right away without tracking locked tiles.
+    bool foundWork;
+    do
     {
-        DRAW_CONTEXT *pDC = &pContext->dcRing[i % KNOB_MAX_DRAWS_IN_FLIGHT];
+        foundWork = false;
 
-        if (pDC->isCompute) return; // We don't look at compute work.
+        RDTSC_START(WorkerPublishDraws);
+        pScheduler->publishDraws(pContext, curDrawBE, workerId);
+        RDTSC_STOP(WorkerPublishDraws, 0, 0);
 
-        // First wait for FE to be finished with this draw. This keeps threading model simple
-        // but if there are lots of bubbles between draws then serializing FE and BE may
-        // need to be revisited.
-        if (!pDC->doneFE) break;
-        
-        // If this draw is dependent on a previous draw then we need to bail.
-        if (CheckDependency(pContext, pDC, lastRetiredDraw))
+        uint32_t dcSlot, tileID;
+        while (pScheduler->getWork(workerId, localNode, dcSlot, tileID))
         {
-            return;
-        }
+            DRAW_CONTEXT *pDC = &pContext->dcRing[dcSlot];
+            MacroTileQueue &tile = pDC->pTileMgr->getMacroTileQueue(tileID);
+            BE_WORK *pWork;
+            bool parked = false;
 
-        // Grab the list of all dirty macrotiles. A tile is dirty if it has work queued to it.
-        std::vector<uint32_t> &macroTiles = pDC->pTileMgr->getDirtyTiles();
+            foundWork = true;
 
-        for (uint32_t tileID : macroTiles)
-        {
-            MacroTileQueue &tile = pDC->pTileMgr->getMacroTileQueue(tileID);
-            
-            // can only work on this draw if it's not in use by other threads
-            if (lockedTiles.find(tileID) == lockedTiles.end())
+            // The FE may still be binning to this macrotile. Keep working as long as
+            // there is binned work, park the macrotile if we catch up with the FE.
+            for (;;)
             {
-                if (tile.getNumQueued())
+                RDTSC_START(WorkerFoundWork);
+
+                uint32_t numWorkItems = tile.getNumQueued();
+
+                if (numWorkItems != 0)
                 {
-                    if (tile.tryLock())
+                    pWork = tile.peek();
+                    SWR_ASSERT(pWork);
+                    if (pWork->type == DRAW)
                     {
-                        BE_WORK *pWork;
-
-                        RDTSC_START(WorkerFoundWork);
-
-                        uint32_t numWorkItems = tile.getNumQueued();
-
-                        if (numWorkItems != 0)
-                        {
-                            pWork = tile.peek();
-                            SWR_ASSERT(pWork);
-                            if (pWork->type == DRAW)
-                            {
-                                InitializeHotTiles(pContext, pDC, tileID, (const TRIANGLE_WORK_DESC*)&pWork->desc);
-                            }
-                        }
-
-                        while ((pWork = tile.peek()) != nullptr)
-                        {
-                            pWork->pfnWork(pDC, workerId, tileID, &pWork->desc);
-                            tile.dequeue();
-                        }
-                        RDTSC_STOP(WorkerFoundWork, numWorkItems, pDC->drawId);
-
-                        _ReadWriteBarrier();
-
-                        pDC->pTileMgr->markTileComplete(tileID);
-
-                        // Optimization: If the draw is complete and we're the last one to have worked on it then
-                        // we can reset the locked list as we know that all previous draws before the next are guaranteed to be complete.
-                        if ((curDrawBE == i) && pDC->pTileMgr->isWorkComplete())
-                        {
-                            // We can increment the current BE and safely move to next draw since we know this draw is complete.
-                            curDrawBE++;
-                            lastRetiredDraw++;
-
-                            lockedTiles.clear();
-                            break;
-                        }
+                        InitializeHotTiles(pContext, pDC, tileID, (const TRIANGLE_WORK_DESC*)&pWork->desc);
                     }
-                    else
+                }
+
+                while ((pWork = tile.peek()) != nullptr)
+                {
+                    pWork->pfnWork(pDC, workerId, tileID, &pWork->desc);
+                    tile.dequeue();
+                }
+                RDTSC_STOP(WorkerFoundWork, numWorkItems, pDC->drawId);
+
+                if (pDC->doneFE)
+                {
+                    // Anything binned before doneFE was set is visible now.
+                    _ReadWriteBarrier();
+                    if (tile.getNumQueued() == 0)
                     {
-                        // This tile is already locked. So let's add it to our locked tiles set. This way we don't try locking this one again.
-                        lockedTiles.insert(tileID);
+                        break;
                     }
                 }
+                else if (pScheduler->parkTile(pDC, tileID))
+                {
+                    // The scheduler hands it out again once there is more work.
+                    // Another worker may own the macrotile from here on.
+                    parked = true;
+                    break;
+                }
             }
+
+            if (parked)
+            {
+                continue;
+            }
+
+            pScheduler->completeTile(pContext, pDC->drawId, tileID, workerId);
+            pDC->pTileMgr->markTileComplete(tileID);
         }
-    }
+
+        // Completed work can unblock dependent draws, so try publishing again.
+    } while (foundWork && FindFirstIncompleteDraw(pContext, curDrawBE));
 }
 
 void WorkOnFifoFE(SWR_CONTEXT *pContext, uint32_t workerId, volatile uint64_t &curDrawFE, UCHAR numaNode)
@@ -581,7 +590,7 @@ void WorkOnFifoFE(SWR_CONTEXT *pContext, uint32_t workerId, volatile uint64_t &c
     uint64_t drawEnqueued = GetEnqueuedDraw(pContext);
     while (curDrawFE < drawEnqueued)
     {
-        uint32_t dcSlot = curDrawFE % KNOB_MAX_DRAWS_IN_FLIGHT;
+        uint32_t dcSlot = curDrawFE % pContext->MaxDrawsInFlight;
         DRAW_CONTEXT *pDC = &pContext->dcRing[dcSlot];
         if (pDC->isCompute || pDC->doneFE || pDC->FeLock)
         {
@@ -596,7 +605,7 @@ void WorkOnFifoFE(SWR_CONTEXT *pContext, uint32_t workerId, volatile uint64_t &c
     uint64_t curDraw = curDrawFE;
     while (curDraw < drawEnqueued)
     {
-        uint32_t dcSlot = curDraw % KNOB_MAX_DRAWS_IN_FLIGHT;
+        uint32_t dcSlot = curDraw % pContext->MaxDrawsInFlight;
         DRAW_CONTEXT *pDC = &pContext->dcRing[dcSlot];
 
         if (!pDC->isCompute && !pDC->FeLock)
@@ -606,6 +615,14 @@ void WorkOnFifoFE(SWR_CONTEXT *pContext, uint32_t workerId, volatile uint64_t &c
             {
                 // successfully grabbed the DC, now run the FE
                 pDC->FeWork.pfnWork(pContext, pDC, workerId, &pDC->FeWork.desc);
+
+                // Wake enough workers for the binned macrotiles, we take one ourselves.
+                // A streaming draw already woke them as the macrotiles were binned.
+                uint32_t numTiles = pDC->pTileMgr->getNumDirtyTiles();
+                if (!pDC->streamBE && numTiles > 1)
+                {
+                    WakeWorkers(pContext, numTiles - 1);
+                }
             }
         }
         curDraw++;
@@ -629,9 +646,9 @@ void WorkOnCompute(
         return;
     }
 
-    uint64_t lastRetiredDraw = pContext->dcRing[curDrawBE % KNOB_MAX_DRAWS_IN_FLIGHT].drawId - 1;
+    uint64_t lastRetiredDraw = pContext->dcRing[curDrawBE % pContext->MaxDrawsInFlight].drawId - 1;
 
-    DRAW_CONTEXT *pDC = &pContext->dcRing[curDrawBE % KNOB_MAX_DRAWS_IN_FLIGHT];
+    DRAW_CONTEXT *pDC = &pContext->dcRing[curDrawBE % pContext->MaxDrawsInFlight];
     if (pDC->isCompute == false) return;
 
     // check dependencies
@@ -677,15 +694,11 @@ DWORD workerThread(LPVOID pData)
 
     RDTSC_INIT(threadId);
 
-    int numaNode = (int)pThreadData->numaId;
+    uint32_t numaNode = pThreadData->numaId;
 
     // flush denormals to 0
     _mm_setcsr(_mm_getcsr() | _MM_FLUSH_ZERO_ON | _MM_DENORMALS_ZERO_ON);
 
-    // Track tiles locked by other threads. If we try to lock a macrotile and find its already
-    // locked then we'll add it to this list so that we don't try and lock it again.
-    std::unordered_set<uint32_t> lockedTiles;
-
     // each worker has the ability to work on any of the queued draws as long as certain
     // conditions are met. the data associated
     // with a draw is guaranteed to be active as long as a worker hasn't signaled that he 
@@ -703,17 +716,32 @@ DWORD workerThread(LPVOID pData)
     //    any work left by comparing the total # of binned work items and the total # of completed
     //    work items. If they are equal, then there is no more work to do for this draw, and
     //    the worker can safely increment its oldestDraw counter and move on to the next draw.
+    // The spin time before parking adapts to how often spinning found new work.
+    const uint32_t minSpinLoopCount = std::max(KNOB_WORKER_SPIN_LOOP_COUNT / 16, 1u);
+    const uint32_t maxSpinLoopCount = KNOB_WORKER_SPIN_LOOP_COUNT * 4;
+    uint32_t spinLoopCount = KNOB_WORKER_SPIN_LOOP_COUNT;
+
     std::unique_lock<std::mutex> lock(pContext->WaitLock, std::defer_lock);
     while (pContext->threadPool.inThreadShutdown == false)
     {
         uint32_t loop = 0;
-        while (loop++ < KNOB_WORKER_SPIN_LOOP_COUNT && pContext->WorkerBE[workerId] == pContext->DrawEnqueued)
+        while (loop < spinLoopCount && pContext->WorkerBE[workerId] == pContext->DrawEnqueued)
         {
             _mm_pause();
+            loop++;
         }
 
-        if (pContext->WorkerBE[workerId] == pContext->DrawEnqueued)
+        if (pContext->WorkerBE[workerId] != pContext->DrawEnqueued)
         {
+            if (loop > 0)
+            {
+                spinLoopCount = std::min(spinLoopCount * 2, maxSpinLoopCount);
+            }
+        }
+        else
+        {
+            spinLoopCount = std::max(spinLoopCount / 2, minSpinLoopCount);
+
             lock.lock();
 
             // check for thread idle condition again under lock
@@ -729,12 +757,38 @@ DWORD workerThread(LPVOID pData)
                 break;
             }
 
-            RDTSC_START(WorkerWaitForThreadEvent);
+            // Park. From here on the API thread may move our draw counters forward.
+            pContext->NumParkedWorkers++;
+            pContext->WorkerState[workerId] = WORKER_PARKED;
 
-            pContext->FifosNotEmpty.wait(lock);
-            lock.unlock();
+            // Pairs with the fence in WakeWorkers, either the API thread sees us
+            // parked or we see the draw it just enqueued.
+            _mm_mfence();
+
+            if (pContext->WorkerBE[workerId] == pContext->DrawEnqueued)
+            {
+                pContext->NumWorkerParks++;
+
+                // WakeWorkers marks us running before notifying.
+                RDTSC_START(WorkerWaitForThreadEvent);
+                pContext->WorkerWake[workerId].wait(lock, [&] {
+                    return pContext->WorkerState[workerId] == WORKER_RUNNING || pContext->threadPool.inThreadShutdown;
+                });
+                RDTSC_STOP(WorkerWaitForThreadEvent, 0, 0);
+            }
+
+            // Unpark ourselves unless woken, waiting for the API thread if it is
+            // updating our counters.
+            if (pContext->WorkerState[workerId] != WORKER_RUNNING)
+            {
+                pContext->NumParkedWorkers--;
+                while (InterlockedCompareExchange(&pContext->WorkerState[workerId], WORKER_RUNNING, WORKER_PARKED) != WORKER_PARKED)
+                {
+                    _mm_pause();
+                }
+            }
 
-            RDTSC_STOP(WorkerWaitForThreadEvent, 0, 0);
+            lock.unlock();
 
             if (pContext->threadPool.inThreadShutdown)
             {
@@ -742,29 +796,94 @@ DWORD workerThread(LPVOID pData)
             }
         }
 
+        uint64_t prevDrawBE = pContext->WorkerBE[workerId];
+        uint64_t prevDrawFE = pContext->WorkerFE[workerId];
+
         RDTSC_START(WorkerWorkOnFifoBE);
-        WorkOnFifoBE(pContext, workerId, pContext->WorkerBE[workerId], lockedTiles);
+        WorkOnFifoBE(pContext, workerId, pContext->WorkerBE[workerId], numaNode);
         RDTSC_STOP(WorkerWorkOnFifoBE, 0, 0);
 
         WorkOnCompute(pContext, workerId, pContext->WorkerBE[workerId]);
 
         WorkOnFifoFE(pContext, workerId, pContext->WorkerFE[workerId], numaNode);
+
+        // Moving past a draw can retire it, which the API thread may be waiting on.
+        if (pContext->WorkerBE[workerId] != prevDrawBE || pContext->WorkerFE[workerId] != prevDrawFE)
+        {
+            NotifyDrawRetired(pContext);
+        }
     }
 
     return 0;
 }
 
-void CreateThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
+//////////////////////////////////////////////////////////////////////////
+/// @brief Number of HW threads available when using at most numNodes nodes,
+///        numCores cores per node and numThreads threads per core.
+static uint32_t CountHWThreads(const CPUNumaNodes& nodes, uint32_t numNodes, uint32_t numCores, uint32_t numThreads)
 {
-    // Bind application thread to HW thread 0
-    bindThread(0);
+    uint32_t count = 0;
+    for (uint32_t n = 0; n < numNodes && n < nodes.size(); ++n)
+    {
+        const NumaNode& node = nodes[n];
+        for (uint32_t c = 0; c < numCores && c < node.cores.size(); ++c)
+        {
+            count += std::min(numThreads, (uint32_t)node.cores[c].threadIds.size());
+        }
+    }
+    return count;
+}
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Prints the detected processor topology, in the order workers are
+///        assigned to HW threads.
+static void DumpProcessorTopology(const CPUNumaNodes& nodes)
+{
+    printf("SWR processor topology: %u NUMA node(s)\n", (uint32_t)nodes.size());
+    for (uint32_t n = 0; n < nodes.size(); ++n)
+    {
+        const NumaNode& node = nodes[n];
+        printf("  node %u (os node %u): %u core(s)\n", n, node.numaId, (uint32_t)node.cores.size());
+        for (uint32_t c = 0; c < node.cores.size(); ++c)
+        {
+            const Core& core = node.cores[c];
+            printf("    core %u: procGroup %u, cacheGroup 0x%x, threads", c, core.procGroup, core.cacheGroup);
+            for (uint32_t threadId : core.threadIds)
+            {
+                printf(" %u", threadId);
+            }
+            printf("\n");
+        }
+    }
+}
+
+void CreateThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
+{
     CPUNumaNodes nodes;
     CalculateProcessorTopology(nodes);
 
+    // Bind application thread to the first HW thread we're allowed to run on,
+    // which is reserved for it below.
+    bindThread(nodes[0].cores[0].threadIds[0], nodes[0].cores[0].procGroup);
+
+    if (KNOB_DUMP_TOPOLOGY)
+    {
+        DumpProcessorTopology(nodes);
+    }
+
+    // With cpusets or offline CPUs nodes and cores can differ in size, size the
+    // pool after the largest ones and skip what a node doesn't have below.
     uint32_t numHWNodes         = (uint32_t)nodes.size();
-    uint32_t numHWCoresPerNode  = (uint32_t)nodes[0].cores.size();
-    uint32_t numHWHyperThreads  = (uint32_t)nodes[0].cores[0].threadIds.size();
+    uint32_t numHWCoresPerNode  = 0;
+    uint32_t numHWHyperThreads  = 0;
+    for (auto& node : nodes)
+    {
+        numHWCoresPerNode = std::max(numHWCoresPerNode, (uint32_t)node.cores.size());
+        for (auto& core : node.cores)
+        {
+            numHWHyperThreads = std::max(numHWHyperThreads, (uint32_t)core.threadIds.size());
+        }
+    }
 
     uint32_t numNodes           = numHWNodes;
     uint32_t numCoresPerNode    = numHWCoresPerNode;
@@ -786,13 +905,14 @@ void CreateThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
     }
 
     // Calculate numThreads
-    uint32_t numThreads = numNodes * numCoresPerNode * numHyperThreads;
+    uint32_t numThreads = CountHWThreads(nodes, numNodes, numCoresPerNode, numHyperThreads);
 
     if (numThreads > KNOB_MAX_NUM_THREADS)
     {
         printf("WARNING: system thread count %u exceeds max %u, "
             "performance will be degraded\n",
             numThreads, KNOB_MAX_NUM_THREADS);
+        numThreads = KNOB_MAX_NUM_THREADS;
     }
 
     if (numThreads == 1)
@@ -825,21 +945,32 @@ void CreateThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
     }
 
     pPool->numThreads = numThreads;
+    pPool->numNumaNodes = KNOB_NUMA_HOT_TILES ? numNodes : 1;
     pContext->NumWorkerThreads = pPool->numThreads;
 
     pPool->inThreadShutdown = false;
     pPool->pThreadData = (THREAD_DATA *)malloc(pPool->numThreads * sizeof(THREAD_DATA));
 
+    // workers and the allocators index nodes densely, numa allocations need the OS id
+    pPool->pNumaNodeIds = (uint32_t *)malloc(pPool->numNumaNodes * sizeof(uint32_t));
+    for (uint32_t n = 0; n < pPool->numNumaNodes; ++n)
+    {
+        pPool->pNumaNodeIds[n] = nodes[n].numaId;
+    }
+
+    // Widening a limit for a single worker above can make the topology walk
+    // reach more HW threads than were allocated for, stop at numThreads.
     uint32_t workerId = 0;
-    for (uint32_t n = 0; n < numNodes; ++n)
+    for (uint32_t n = 0; n < numNodes && workerId < pPool->numThreads; ++n)
     {
         auto& node = nodes[n];
 
-        uint32_t numCores = numCoresPerNode;
-        for (uint32_t c = 0; c < numCores; ++c)
+        uint32_t numCores = std::min(numCoresPerNode, (uint32_t)node.cores.size());
+        for (uint32_t c = 0; c < numCores && workerId < pPool->numThreads; ++c)
         {
             auto& core = node.cores[c];
-            for (uint32_t t = 0; t < numHyperThreads; ++t)
+            uint32_t numCoreThreads = std::min(numHyperThreads, (uint32_t)core.threadIds.size());
+            for (uint32_t t = 0; t < numCoreThreads && workerId < pPool->numThreads; ++t)
             {
                 if (c == 0 && n == 0 && t == 0)
                 {
@@ -851,6 +982,7 @@ void CreateThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
                 pPool->pThreadData[workerId].procGroupId = core.procGroup;
                 pPool->pThreadData[workerId].threadId = core.threadIds[t];
                 pPool->pThreadData[workerId].numaId = n;
+                pPool->pThreadData[workerId].cacheGroup = core.cacheGroup;
                 pPool->pThreadData[workerId].pContext = pContext;
                 pPool->threads[workerId] = new std::thread(workerThread, &pPool->pThreadData[workerId]);
 
@@ -868,7 +1000,10 @@ void DestroyThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
         std::unique_lock<std::mutex> lock(pContext->WaitLock);
         pPool->inThreadShutdown = true;
         _mm_mfence();
-        pContext->FifosNotEmpty.notify_all();
+        for (uint32_t t = 0; t < pPool->numThreads; ++t)
+        {
+            pContext->WorkerWake[t].notify_one();
+        }
         lock.unlock();
 
         // Wait for threads to finish and destroy them
@@ -880,5 +1015,6 @@ void DestroyThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool)
 
         // Clean up data used by threads
         free(pPool->pThreadData);
+        free(pPool->pNumaNodeIds);
     }
 }
@@ -39,7 +39,8 @@ struct THREAD_DATA
 {
     uint32_t procGroupId;   // Will always be 0 for non-Windows OS
     uint32_t threadId;      // within the procGroup for Windows
-    uint32_t numaId;        // NUMA node id
+    uint32_t numaId;        // NUMA node index, see THREAD_POOL::pNumaNodeIds for the OS id
+    uint32_t cacheGroup;    // workers with the same cacheGroup share an L3
     uint32_t workerId;
     SWR_CONTEXT *pContext;
 };
@@ -49,6 +50,8 @@ struct THREAD_POOL
 {
     THREAD_PTR threads[KNOB_MAX_NUM_THREADS];
     uint32_t numThreads;
+    uint32_t numNumaNodes;  // NUMA nodes that macrotiles are distributed across
+    uint32_t *pNumaNodeIds; // OS NUMA node id of each of the numNumaNodes node indices
     volatile bool inThreadShutdown;
     THREAD_DATA *pThreadData;
 };
@@ -58,5 +61,5 @@ void DestroyThreadPool(SWR_CONTEXT *pContext, THREAD_POOL *pPool);
 
 // Expose FE and BE worker functions to the API thread if single threaded
 void WorkOnFifoFE(SWR_CONTEXT *pContext, uint32_t workerId, volatile uint64_t &curDrawFE, UCHAR numaNode);
-void WorkOnFifoBE(SWR_CONTEXT *pContext, uint32_t workerId, volatile uint64_t &curDrawBE, std::unordered_set<uint32_t> &usedTiles);
+void WorkOnFifoBE(SWR_CONTEXT *pContext, uint32_t workerId, volatile uint64_t &curDrawBE, uint32_t numaNode);
 void WorkOnCompute(SWR_CONTEXT *pContext, uint32_t workerId, volatile uint64_t &curDrawBE);
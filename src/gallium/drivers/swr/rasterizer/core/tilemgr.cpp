@@ -26,10 +26,11 @@
 *        for threads to work on an macro tile.
 *
 ******************************************************************************/
-#include <unordered_map>
+#include <new>
 
 #include "fifo.hpp"
 #include "tilemgr.h"
+#include "format_conversion.h"
 
 #define TILE_ID(x,y) ((x << 16 | y))
 
@@ -58,12 +59,91 @@ MacroTileMgr::MacroTileMgr()
 {
 }
 
+MacroTileMgr::~MacroTileMgr()
+{
+    for (uint32_t i = 0; i < mTilesX * mTilesY; ++i)
+    {
+        mpTiles[i].destroy();
+        mpTiles[i].~MacroTileQueue();
+    }
+    _aligned_free(mpTiles);
+}
+
 void MacroTileMgr::initialize()
 {
     mWorkItemsProduced = 0;
     mWorkItemsConsumed = 0;
 
+    // Only the tiles dirtied by the previous draw need to be reset.
+    for (uint32_t id : mDirtyTiles)
+    {
+        uint32_t index = getTileIndex(id);
+        mDirtyMask[index / 64] &= ~(1ULL << (index % 64));
+    }
+
     mDirtyTiles.clear();
+    mNumDirtyTiles = 0;
+    mReserved = false;
+    mpWakeContext = nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Make sure the tile grid covers tilesX x tilesY macrotiles before
+///        the FE starts binning. The grid must not grow while the backend
+///        is streaming work from the draw.
+void MacroTileMgr::reserveTiles(uint32_t tilesX, uint32_t tilesY)
+{
+    if (tilesX > mTilesX || tilesY > mTilesY)
+    {
+        growTiles(tilesX, tilesY);
+    }
+    mReserved = true;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Grow the tile grid to cover at least tilesX x tilesY macrotiles.
+///        Existing tile queues keep their fifo backing.
+void MacroTileMgr::growTiles(uint32_t tilesX, uint32_t tilesY)
+{
+    tilesX = std::max(tilesX, mTilesX);
+    tilesY = std::max(tilesY, mTilesY);
+
+    MacroTileQueue* pTiles = (MacroTileQueue*)_aligned_malloc(sizeof(MacroTileQueue) * tilesX * tilesY, 64);
+    SWR_ASSERT(pTiles);
+
+    for (uint32_t y = 0; y < tilesY; ++y)
+    {
+        for (uint32_t x = 0; x < tilesX; ++x)
+        {
+            MacroTileQueue* pTile = &pTiles[y * tilesX + x];
+            if (x < mTilesX && y < mTilesY)
+            {
+                MacroTileQueue& oldTile = mpTiles[y * mTilesX + x];
+                new (pTile) MacroTileQueue(std::move(oldTile));
+                oldTile.~MacroTileQueue();
+            }
+            else
+            {
+                new (pTile) MacroTileQueue();
+            }
+        }
+    }
+
+    _aligned_free(mpTiles);
+    mpTiles = pTiles;
+    mTilesX = tilesX;
+    mTilesY = tilesY;
+
+    // A tile is dirtied at most once per draw so the dirty list never has to grow.
+    mDirtyTiles.reserve(tilesX * tilesY);
+
+    // Tile indices changed, rebuild the dirty mask.
+    mDirtyMask.assign((tilesX * tilesY + 63) / 64, 0);
+    for (uint32_t id : mDirtyTiles)
+    {
+        uint32_t index = getTileIndex(id);
+        mDirtyMask[index / 64] |= 1ULL << (index % 64);
+    }
 }
 
 void MacroTileMgr::enqueue(uint32_t x, uint32_t y, BE_WORK *pWork)
@@ -72,25 +152,46 @@ void MacroTileMgr::enqueue(uint32_t x, uint32_t y, BE_WORK *pWork)
     SWR_ASSERT(x < KNOB_NUM_HOT_TILES_X);
     SWR_ASSERT(y < KNOB_NUM_HOT_TILES_Y);
 
-    uint32_t id = TILE_ID(x, y);
+    if (x >= mTilesX || y >= mTilesY)
+    {
+        // Binners clamp to the scissor, which the grid was reserved for. Growing
+        // would reallocate the grid under backend workers streaming this draw.
+        SWR_ASSERT(!mReserved, "Binned outside of the reserved macrotile grid");
+        growTiles(x + 1, y + 1);
+    }
 
-    MacroTileQueue &tile = mTiles[id];
+    uint32_t index = y * mTilesX + x;
+
+    MacroTileQueue &tile = mpTiles[index];
     tile.mWorkItemsFE++;
 
-    if (tile.mWorkItemsFE == 1)
+    bool firstWork = (tile.mWorkItemsFE == 1);
+    if (firstWork)
     {
         tile.clear();
-        mDirtyTiles.push_back(id);
+        mDirtyTiles.push_back(TILE_ID(x, y));
+        mDirtyMask[index / 64] |= 1ULL << (index % 64);
     }
 
     mWorkItemsProduced++;
     tile.enqueue_try_nosync(pWork);
+
+    if (firstWork)
+    {
+        // The tile has work now, make it visible to the backend.
+        _ReadWriteBarrier();
+        mNumDirtyTiles++;
+
+        if (mpWakeContext)
+        {
+            WakeWorkers(mpWakeContext, 1);
+        }
+    }
 }
 
 void MacroTileMgr::markTileComplete(uint32_t id)
 {
-    SWR_ASSERT(mTiles.find(id) != mTiles.end());
-    MacroTileQueue &tile = mTiles[id];
+    MacroTileQueue &tile = mpTiles[getTileIndex(id)];
     uint32_t numTiles = tile.mWorkItemsFE;
     InterlockedExchangeAdd(&mWorkItemsConsumed, numTiles);
 
@@ -103,3 +204,384 @@ void MacroTileMgr::markTileComplete(uint32_t id)
     tile.mWorkItemsFE = 0;
     tile.mWorkItemsBE = 0;
 }
+
+// fill a raster tile of a color hot tile from its float4 clear data.
+template<SWR_FORMAT HotTileFormat>
+static void ClearColorRasterTile(const HOTTILE* pHotTile, BYTE* pRasterTile)
+{
+    float *pClearData = (float*)(pHotTile->clearData);
+    simdvector vClear;
+    vClear.x = _simd_broadcast_ss(&pClearData[0]);
+    vClear.y = _simd_broadcast_ss(&pClearData[1]);
+    vClear.z = _simd_broadcast_ss(&pClearData[2]);
+    vClear.w = _simd_broadcast_ss(&pClearData[3]);
+
+    // same conversion the backend uses when writing the hot tile
+    for (uint32_t si = 0; si < (KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM * pHotTile->numSamples); si += SIMD_TILE_X_DIM * SIMD_TILE_Y_DIM)
+    {
+        StoreSOA<HotTileFormat>(vClear, pRasterTile);
+        pRasterTile += KNOB_SIMD_WIDTH * FormatTraits<HotTileFormat>::bpp / 8;
+    }
+}
+
+static void ClearDepthRasterTile(const HOTTILE* pHotTile, BYTE* pRasterTile)
+{
+    float *pClearData = (float*)(pHotTile->clearData);
+    simdscalar valZ = _simd_broadcast_ss(&pClearData[0]);
+
+    float *pfBuf = (float*)pRasterTile;
+    for (uint32_t si = 0; si < (KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM * pHotTile->numSamples); si += SIMD_TILE_X_DIM * SIMD_TILE_Y_DIM)
+    {
+        _simd_store_ps(pfBuf, valZ);
+        pfBuf += KNOB_SIMD_WIDTH;
+    }
+}
+
+static void ClearStencilRasterTile(const HOTTILE* pHotTile, BYTE* pRasterTile)
+{
+    // convert from F32 to U8.
+    uint8_t clearVal = (uint8_t)(pHotTile->clearData[0]);
+    //broadcast 32x into __m256i...
+    simdscalari valS = _simd_set1_epi8(clearVal);
+
+    simdscalari* pBuf = (simdscalari*)pRasterTile;
+
+    // We're putting 4 pixels in each of the 32-bit slots, so increment 4 times as quickly.
+    for (uint32_t si = 0; si < (KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM * pHotTile->numSamples); si += SIMD_TILE_X_DIM * SIMD_TILE_Y_DIM * 4)
+    {
+        _simd_store_si(pBuf, valS);
+        pBuf += 1;
+    }
+}
+
+void HotTileMgr::DeferClear(HOTTILE* pHotTile)
+{
+    pHotTile->clearMask = ALL_RASTER_TILES;
+    if (pHotTile->pDepthBounds)
+    {
+        float clearDepth = *(float*)&pHotTile->clearData[0];
+        pHotTile->pDepthBounds->Set(clearDepth, clearDepth);
+    }
+    pHotTile->state = HOTTILE_DIRTY;
+}
+
+void HotTileMgr::ResolveClear(HOTTILE* pHotTile, SWR_RENDERTARGET_ATTACHMENT attachment, uint64_t resolveMask)
+{
+    resolveMask &= pHotTile->clearMask;
+    if (resolveMask == 0)
+    {
+        return;
+    }
+
+    uint32_t bpp;
+    void(*pfnClearRasterTile)(const HOTTILE*, BYTE*);
+    switch (attachment)
+    {
+    case SWR_ATTACHMENT_DEPTH:
+        bpp = FormatTraits<KNOB_DEPTH_HOT_TILE_FORMAT>::bpp;
+        pfnClearRasterTile = ClearDepthRasterTile;
+        break;
+    case SWR_ATTACHMENT_STENCIL:
+        bpp = FormatTraits<KNOB_STENCIL_HOT_TILE_FORMAT>::bpp;
+        pfnClearRasterTile = ClearStencilRasterTile;
+        break;
+    default:
+        SWR_ASSERT(attachment <= SWR_ATTACHMENT_COLOR7, "Unknown attachment: %d", attachment);
+        if (pHotTile->format == KNOB_COMPACT_COLOR_HOT_TILE_FORMAT)
+        {
+            bpp = FormatTraits<KNOB_COMPACT_COLOR_HOT_TILE_FORMAT>::bpp;
+            pfnClearRasterTile = ClearColorRasterTile<KNOB_COMPACT_COLOR_HOT_TILE_FORMAT>;
+        }
+        else
+        {
+            SWR_ASSERT(pHotTile->format == KNOB_COLOR_HOT_TILE_FORMAT);
+            bpp = FormatTraits<KNOB_COLOR_HOT_TILE_FORMAT>::bpp;
+            pfnClearRasterTile = ClearColorRasterTile<KNOB_COLOR_HOT_TILE_FORMAT>;
+        }
+        break;
+    }
+
+    // raster tiles are stored linearly in the hot tile, see ComputeTileOffset2D for SWR_TILE_SWRZ
+    const uint32_t rasterTileSize = KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM * (bpp / 8) * pHotTile->numSamples;
+    for (uint32_t i = 0; i < KNOB_MACROTILE_X_DIM_IN_TILES * KNOB_MACROTILE_Y_DIM_IN_TILES; ++i)
+    {
+        if (resolveMask & (1ULL << i))
+        {
+            pfnClearRasterTile(pHotTile, pHotTile->pBuffer + i * rasterTileSize);
+        }
+    }
+
+    pHotTile->clearMask &= ~resolveMask;
+}
+
+void HotTileMgr::ExpandColorHotTile(HOTTILE* pHotTile)
+{
+    SWR_ASSERT(pHotTile->format == KNOB_COMPACT_COLOR_HOT_TILE_FORMAT);
+
+    // simd tiles keep their order, only their size grows. walk backwards so
+    // each one is read before the wider ones below it overwrite it.
+    const uint32_t srcSimdSize = KNOB_SIMD_WIDTH * FormatTraits<KNOB_COMPACT_COLOR_HOT_TILE_FORMAT>::bpp / 8;
+    const uint32_t dstSimdSize = KNOB_SIMD_WIDTH * FormatTraits<KNOB_COLOR_HOT_TILE_FORMAT>::bpp / 8;
+    const uint32_t numSimdTiles = KNOB_MACROTILE_X_DIM * KNOB_MACROTILE_Y_DIM * pHotTile->numSamples / (SIMD_TILE_X_DIM * SIMD_TILE_Y_DIM);
+    for (uint32_t i = numSimdTiles; i-- > 0;)
+    {
+        simdvector color;
+        LoadSOA<KNOB_COMPACT_COLOR_HOT_TILE_FORMAT>(pHotTile->pBuffer + i * srcSimdSize, color);
+        StoreSOA<KNOB_COLOR_HOT_TILE_FORMAT>(color, pHotTile->pBuffer + i * dstSimdSize);
+    }
+
+    // raster tiles in clearMask are refilled by ResolveClear in the new format
+    pHotTile->format = KNOB_COLOR_HOT_TILE_FORMAT;
+}
+
+// override new/delete for alignment
+void *MacroTileScheduler::operator new(size_t size)
+{
+    return _aligned_malloc(size, 64);
+}
+
+void MacroTileScheduler::operator delete(void *p)
+{
+    _aligned_free(p);
+}
+
+MacroTileScheduler::MacroTileScheduler(uint32_t numWorkers, uint32_t numNumaNodes)
+{
+    mNumWorkers = std::max(numWorkers, 1u);
+    mNumNumaNodes = std::max(numNumaNodes, 1u);
+
+    // the deques hold cache line aligned members, plain new[] doesn't honor that
+    mpDeques = (WorkStealingDeque<uint64_t>*)_aligned_malloc(
+        mNumWorkers * mNumNumaNodes * sizeof(WorkStealingDeque<uint64_t>), 64);
+    for (uint32_t i = 0; i < mNumWorkers * mNumNumaNodes; ++i)
+    {
+        new (&mpDeques[i]) WorkStealingDeque<uint64_t>();
+        mpDeques[i].initialize(256);
+    }
+
+    memset((void*)&mTilePending[0][0], 0, sizeof(mTilePending));
+
+    // draws start at 1
+    mNextPublish = 1;
+    mNumTilesPublished = 0;
+    mPublishLock = 0;
+
+    mParkedTiles.reserve(KNOB_NUM_HOT_TILES_X);
+    mParkLock = 0;
+}
+
+MacroTileScheduler::~MacroTileScheduler()
+{
+    for (uint32_t i = 0; i < mNumWorkers * mNumNumaNodes; ++i)
+    {
+        mpDeques[i].destroy();
+        mpDeques[i].~WorkStealingDeque<uint64_t>();
+    }
+    _aligned_free(mpDeques);
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Hand out the macrotiles of draws that are ready for the backend.
+///        Draws are published in order by whichever worker grabs the lock,
+///        other workers move on and look for work. A streaming draw has its
+///        macrotiles handed out as the FE bins work to them.
+/// @param curDrawBE - First incomplete draw of the calling worker.
+void MacroTileScheduler::publishDraws(SWR_CONTEXT *pContext, uint64_t curDrawBE, uint32_t workerId)
+{
+    if (mPublishLock || InterlockedCompareExchange(&mPublishLock, 1, 0) != 0)
+    {
+        return;
+    }
+
+    uint64_t lastRetiredDraw = curDrawBE - 1;
+    uint64_t drawEnqueued = pContext->DrawEnqueued;
+
+    while (mNextPublish < drawEnqueued)
+    {
+        DRAW_CONTEXT *pDC = &pContext->dcRing[mNextPublish % pContext->MaxDrawsInFlight];
+
+        // Draws after a dispatch have to wait for it to complete.
+        if (pDC->isCompute)
+        {
+            if (!pDC->pDispatch->isWorkComplete())
+            {
+                break;
+            }
+
+            mNextPublish++;
+            continue;
+        }
+
+        bool doneFE = pDC->doneFE;
+        if (!doneFE && !pDC->streamBE)
+        {
+            break;
+        }
+
+        if (pDC->dependency > lastRetiredDraw)
+        {
+            break;
+        }
+
+        // Dirty tiles have to be read after doneFE.
+        _ReadWriteBarrier();
+
+        MacroTileMgr *pTileMgr = pDC->pTileMgr;
+        uint32_t numDirtyTiles = pTileMgr->getNumDirtyTiles();
+        for (; mNumTilesPublished < numDirtyTiles; ++mNumTilesPublished)
+        {
+            uint32_t tileID = pTileMgr->getDirtyTile(mNumTilesPublished);
+            uint32_t x, y;
+            MacroTileMgr::getTileIndices(tileID, x, y);
+
+            // If an older draw still has this macrotile in flight then that draw
+            // will hand it out once it completes.
+            if (InterlockedIncrement(&mTilePending[x][y]) == 1)
+            {
+                pushTile(pContext, workerId, mNextPublish, tileID);
+            }
+        }
+
+        if (pDC->streamBE)
+        {
+            resumeParkedTiles(pContext, pDC, workerId);
+        }
+
+        // Later draws can't be published until the FE has binned all of this one.
+        if (!doneFE)
+        {
+            break;
+        }
+
+        mNumTilesPublished = 0;
+        mNextPublish++;
+    }
+
+    _ReadWriteBarrier();
+    mPublishLock = 0;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Called once a worker finished a macrotile for a draw. Hands out
+///        the macrotile of the next published draw touching it, if any.
+///        Must be called before the tile is marked complete in the draw.
+void MacroTileScheduler::completeTile(SWR_CONTEXT *pContext, uint64_t drawId, uint32_t tileID, uint32_t workerId)
+{
+    uint32_t x, y;
+    MacroTileMgr::getTileIndices(tileID, x, y);
+
+    if (InterlockedDecrement(&mTilePending[x][y]) == 0)
+    {
+        return;
+    }
+
+    // Draws are published in order so every draw up to the next one touching
+    // this macrotile has been published and can't retire before it.
+    uint64_t drawEnqueued = pContext->DrawEnqueued;
+    for (uint64_t i = drawId + 1; i < drawEnqueued; ++i)
+    {
+        DRAW_CONTEXT *pDC = &pContext->dcRing[i % pContext->MaxDrawsInFlight];
+        if (!pDC->isCompute && pDC->pTileMgr->isTileDirty(tileID))
+        {
+            pushTile(pContext, workerId, i, tileID);
+            return;
+        }
+    }
+
+    SWR_ASSERT(false, "Pending macrotile work not found");
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Park a macrotile of a streaming draw that ran out of binned work.
+/// @return false if the FE binned more work or finished in the meantime and
+///         the caller should keep working on the macrotile.
+bool MacroTileScheduler::parkTile(DRAW_CONTEXT *pDC, uint32_t tileID)
+{
+    lockParkedTiles();
+
+    // Checked under the lock so the publisher can't miss a parked tile once the FE is done.
+    bool park = !pDC->doneFE && (pDC->pTileMgr->getMacroTileQueue(tileID).getNumQueued() == 0);
+    if (park)
+    {
+        mParkedTiles.push_back(tileID);
+    }
+
+    unlockParkedTiles();
+    return park;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Hand out parked macrotiles of the streaming draw that have new
+///        work, or all of them once the FE is done.
+void MacroTileScheduler::resumeParkedTiles(SWR_CONTEXT *pContext, DRAW_CONTEXT *pDC, uint32_t workerId)
+{
+    lockParkedTiles();
+
+    bool doneFE = pDC->doneFE;
+    _ReadWriteBarrier();
+
+    uint32_t numParked = 0;
+    for (uint32_t tileID : mParkedTiles)
+    {
+        if (doneFE || pDC->pTileMgr->getMacroTileQueue(tileID).getNumQueued() > 0)
+        {
+            pushTile(pContext, workerId, pDC->drawId, tileID);
+        }
+        else
+        {
+            mParkedTiles[numParked++] = tileID;
+        }
+    }
+    mParkedTiles.resize(numParked);
+
+    unlockParkedTiles();
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Find a macrotile to work on. Node local work is preferred over
+///        remote work and own work over stolen work.
+/// @param dcSlot - Draw context ring slot of the draw the work belongs to.
+bool MacroTileScheduler::getWork(uint32_t workerId, uint32_t numaNode, uint32_t &dcSlot, uint32_t &tileID)
+{
+    uint64_t item;
+    bool found = popOrSteal(workerId, numaNode, item);
+
+    for (uint32_t n = 1; !found && n < mNumNumaNodes; ++n)
+    {
+        found = popOrSteal(workerId, (numaNode + n) % mNumNumaNodes, item);
+    }
+
+    if (found)
+    {
+        dcSlot = (uint32_t)(item >> 32);
+        tileID = (uint32_t)item;
+    }
+
+    return found;
+}
+
+void MacroTileScheduler::pushTile(SWR_CONTEXT *pContext, uint32_t workerId, uint64_t drawId, uint32_t tileID)
+{
+    uint32_t numaNode = pContext->pHotTileMgr->GetTileNumaNode(tileID);
+    uint64_t dcSlot = drawId % pContext->MaxDrawsInFlight;
+
+    getDeque(workerId, numaNode).push((dcSlot << 32) | tileID);
+}
+
+bool MacroTileScheduler::popOrSteal(uint32_t workerId, uint32_t numaNode, uint64_t &item)
+{
+    if (getDeque(workerId, numaNode).pop(item))
+    {
+        return true;
+    }
+
+    for (uint32_t w = 1; w < mNumWorkers; ++w)
+    {
+        if (getDeque((workerId + w) % mNumWorkers, numaNode).steal(item))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
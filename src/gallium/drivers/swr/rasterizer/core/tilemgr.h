@@ -30,6 +30,13 @@
 
 #include <set>
 #include <unordered_map>
+#include <vector>
+#include <cfloat>
+
+#if defined(__linux__) || defined(__gnu_linux__)
+#include <numa.h>
+#endif
+
 #include "common/formats.h"
 #include "fifo.hpp"
 #include "context.h"
@@ -40,10 +47,7 @@
 //////////////////////////////////////////////////////////////////////////
 struct MacroTileQueue
 {
-    MacroTileQueue()
-    {
-        mFifo.initialize();
-    }
+    MacroTileQueue() { }
 
     ~MacroTileQueue() { }
 
@@ -62,10 +66,18 @@ struct MacroTileQueue
     }
 
     //////////////////////////////////////////////////////////////////////////
-    /// @brief Clear fifo and unlock it.
+    /// @brief Clear fifo and unlock it. The fifo backing is allocated the
+    ///        first time a tile is used so untouched tiles stay cheap.
     void clear()
     {
-        mFifo.clear();
+        if (mFifo.mBlocks.size() == 0)
+        {
+            mFifo.initialize();
+        }
+        else
+        {
+            mFifo.clear();
+        }
     }
 
     //////////////////////////////////////////////////////////////////////////
@@ -109,19 +121,41 @@ class MacroTileMgr
 {
 public:
     MacroTileMgr();
-    ~MacroTileMgr()
-    {
-        for (auto &tile : mTiles)
-        {
-            tile.second.destroy();
-        }
-    }
+    ~MacroTileMgr();
 
     void initialize();
+    void reserveTiles(uint32_t tilesX, uint32_t tilesY);
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Wake a parked worker for every macrotile the FE starts binning
+    ///        to, so workers join a streaming draw while its FE still runs.
+    INLINE void wakeOnBin(SWR_CONTEXT *pContext) { mpWakeContext = pContext; }
     INLINE std::vector<uint32_t>& getDirtyTiles() { return mDirtyTiles; }
-    INLINE MacroTileQueue& getMacroTileQueue(uint32_t id) { return mTiles[id]; }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Dirty tiles that already have work the backend can see. Safe to
+    ///        use while the FE is still binning as long as the grid was
+    ///        reserved up front.
+    INLINE uint32_t getNumDirtyTiles() { return mNumDirtyTiles; }
+    INLINE uint32_t getDirtyTile(uint32_t i) { return mDirtyTiles[i]; }
+    INLINE MacroTileQueue& getMacroTileQueue(uint32_t id) { return mpTiles[getTileIndex(id)]; }
     void markTileComplete(uint32_t id);
 
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Returns true if work was queued to the tile for this draw.
+    INLINE bool isTileDirty(uint32_t id)
+    {
+        uint32_t x, y;
+        getTileIndices(id, x, y);
+        if (x >= mTilesX || y >= mTilesY)
+        {
+            return false;
+        }
+
+        uint32_t index = y * mTilesX + x;
+        return (mDirtyMask[index / 64] & (1ULL << (index % 64))) != 0;
+    }
+
     INLINE bool isWorkComplete()
     {
         return mWorkItemsProduced == mWorkItemsConsumed;
@@ -139,11 +173,32 @@ public:
     void operator delete (void *p);
 
 private:
+    void growTiles(uint32_t tilesX, uint32_t tilesY);
+
+    INLINE uint32_t getTileIndex(uint32_t id)
+    {
+        uint32_t x, y;
+        getTileIndices(id, x, y);
+        SWR_ASSERT(x < mTilesX && y < mTilesY);
+        return y * mTilesX + x;
+    }
+
     SWR_FORMAT mFormat;
-    std::unordered_map<uint32_t, MacroTileQueue> mTiles;
+
+    // Dense grid of tile queues covering the macrotiles touched so far. The grid
+    // lives as long as the draw context so it is reused by every draw in the ring.
+    MacroTileQueue* mpTiles = nullptr;
+    uint32_t mTilesX = 0;
+    uint32_t mTilesY = 0;
 
     // Any tile that has work queued to it is a dirty tile.
     std::vector<uint32_t> mDirtyTiles;
+    std::vector<uint64_t> mDirtyMask;
+    volatile uint32_t mNumDirtyTiles = 0;
+
+    // Set by reserveTiles until the next draw, the grid must not grow meanwhile.
+    bool mReserved = false;
+    SWR_CONTEXT *mpWakeContext = nullptr;
 
     OSALIGNLINE(LONG) mWorkItemsProduced;
     OSALIGNLINE(volatile LONG) mWorkItemsConsumed;
@@ -242,6 +297,85 @@ enum HOTTILE_STATE
     HOTTILE_RESOLVED,       // tile has been stored to memory
 };
 
+//////////////////////////////////////////////////////////////////////////
+/// DEPTH_BOUNDS - Conservative [min, max] range of the depth values in each
+///   raster tile of a depth hot tile, and of the whole macrotile. Covers all
+///   samples. Only meaningful while the hot tile holds valid data.
+//////////////////////////////////////////////////////////////////////////
+struct DEPTH_BOUNDS
+{
+    float tileMin[KNOB_MACROTILE_Y_DIM_IN_TILES][KNOB_MACROTILE_X_DIM_IN_TILES];
+    float tileMax[KNOB_MACROTILE_Y_DIM_IN_TILES][KNOB_MACROTILE_X_DIM_IN_TILES];
+    float macroMin;
+    float macroMax;
+
+    // Contents unknown, e.g. just loaded from the surface.
+    void SetUnknown()
+    {
+        Set(-FLT_MAX, FLT_MAX);
+    }
+
+    void Set(float minZ, float maxZ)
+    {
+        for (uint32_t y = 0; y < KNOB_MACROTILE_Y_DIM_IN_TILES; ++y)
+        {
+            for (uint32_t x = 0; x < KNOB_MACROTILE_X_DIM_IN_TILES; ++x)
+            {
+                tileMin[y][x] = minZ;
+                tileMax[y][x] = maxZ;
+            }
+        }
+        macroMin = minZ;
+        macroMax = maxZ;
+    }
+
+    // Recomputes the bounds of a raster tile from its depth values.
+    // UpdateMacroTile must be called once done updating raster tiles.
+    void UpdateTile(uint32_t tileX, uint32_t tileY, const float* pDepth, uint32_t numSamples)
+    {
+        simdscalar vMin = _simd_load_ps(pDepth);
+        simdscalar vMax = vMin;
+        for (uint32_t i = KNOB_SIMD_WIDTH; i < KNOB_TILE_X_DIM * KNOB_TILE_Y_DIM * numSamples; i += KNOB_SIMD_WIDTH)
+        {
+            simdscalar vZ = _simd_load_ps(&pDepth[i]);
+            vMin = _simd_min_ps(vMin, vZ);
+            vMax = _simd_max_ps(vMax, vZ);
+        }
+
+        OSALIGNSIMD(float) aMin[KNOB_SIMD_WIDTH];
+        OSALIGNSIMD(float) aMax[KNOB_SIMD_WIDTH];
+        _simd_store_ps(aMin, vMin);
+        _simd_store_ps(aMax, vMax);
+
+        float minZ = aMin[0];
+        float maxZ = aMax[0];
+        for (uint32_t i = 1; i < KNOB_SIMD_WIDTH; ++i)
+        {
+            minZ = std::min(minZ, aMin[i]);
+            maxZ = std::max(maxZ, aMax[i]);
+        }
+
+        tileMin[tileY][tileX] = minZ;
+        tileMax[tileY][tileX] = maxZ;
+    }
+
+    void UpdateMacroTile()
+    {
+        float minZ = tileMin[0][0];
+        float maxZ = tileMax[0][0];
+        for (uint32_t y = 0; y < KNOB_MACROTILE_Y_DIM_IN_TILES; ++y)
+        {
+            for (uint32_t x = 0; x < KNOB_MACROTILE_X_DIM_IN_TILES; ++x)
+            {
+                minZ = std::min(minZ, tileMin[y][x]);
+                maxZ = std::max(maxZ, tileMax[y][x]);
+            }
+        }
+        macroMin = minZ;
+        macroMax = maxZ;
+    }
+};
+
 struct HOTTILE
 {
     BYTE *pBuffer;
@@ -249,8 +383,14 @@ struct HOTTILE
     DWORD clearData[4];                 // May need to change based on pfnClearTile implementation.  Reorder for alignment?
     uint32_t numSamples;
     uint32_t renderTargetArrayIndex;    // current render target array index loaded
+    DEPTH_BOUNDS *pDepthBounds;         // depth attachment only
+    uint64_t clearMask;                 // raster tiles that still hold clearData, their pBuffer contents are stale
+    SWR_FORMAT format;                  // layout of pBuffer, color hot tiles pick theirs when (re)loaded or cleared
 };
 
+static_assert(KNOB_MACROTILE_X_DIM_IN_TILES * KNOB_MACROTILE_Y_DIM_IN_TILES <= 64,
+    "HOTTILE::clearMask needs a bit per raster tile");
+
 union HotTileSet
 {
     struct
@@ -265,11 +405,34 @@ union HotTileSet
 class HotTileMgr
 {
 public:
-    HotTileMgr()
+    /// @param pNumaNodeIds - OS node id of each of the numNumaNodes node
+    ///        indices, may be null for a single node.
+    HotTileMgr(uint32_t numNumaNodes = 1, const uint32_t* pNumaNodeIds = nullptr)
     {
         memset(&mHotTiles[0][0], 0, sizeof(mHotTiles));
 
-        // cache hottile size
+        mNumNumaNodes = std::max(numNumaNodes, 1u);
+        if (mNumNumaNodes > 1)
+        {
+            mNumaNodeIds.assign(pNumaNodeIds, pNumaNodeIds + mNumNumaNodes);
+        }
+#if defined(__linux__) || defined(__gnu_linux__)
+        // Only distribute across nodes the OS can actually allocate memory from.
+        if (numa_available() < 0)
+        {
+            mNumNumaNodes = 1;
+        }
+        for (uint32_t id : mNumaNodeIds)
+        {
+            if (id > (uint32_t)numa_max_node())
+            {
+                mNumNumaNodes = 1;
+            }
+        }
+#endif
+
+        // cache hottile size. color hot tiles are sized for the widest format so
+        // they can switch formats without being reallocated.
         for (uint32_t i = SWR_ATTACHMENT_COLOR0; i <= SWR_ATTACHMENT_COLOR7; ++i)
         {
             mHotTileSize[i] = KNOB_MACROTILE_X_DIM * KNOB_MACROTILE_Y_DIM * FormatTraits<KNOB_COLOR_HOT_TILE_FORMAT>::bpp / 8;
@@ -286,10 +449,16 @@ public:
             {
                 for (int a = 0; a < SWR_NUM_ATTACHMENTS; ++a)
                 {
-                    if (mHotTiles[x][y].Attachment[a].pBuffer != NULL)
+                    HOTTILE& hotTile = mHotTiles[x][y].Attachment[a];
+                    if (hotTile.pBuffer != NULL)
                     {
-                        _aligned_free(mHotTiles[x][y].Attachment[a].pBuffer);
-                        mHotTiles[x][y].Attachment[a].pBuffer = NULL;
+                        FreeHotTileMem(hotTile.pBuffer, hotTile.numSamples * mHotTileSize[a]);
+                        hotTile.pBuffer = NULL;
+                    }
+                    if (hotTile.pDepthBounds != NULL)
+                    {
+                        _aligned_free(hotTile.pDepthBounds);
+                        hotTile.pDepthBounds = NULL;
                     }
                 }
             }
@@ -312,10 +481,18 @@ public:
             if (create)
             {
                 uint32_t size = numSamples * mHotTileSize[attachment];
-                hotTile.pBuffer = (BYTE*)_aligned_malloc(size, KNOB_SIMD_WIDTH * 4);
+                hotTile.pBuffer = (BYTE*)AllocHotTileMem(size, KNOB_SIMD_WIDTH * 4, GetTileNumaNode(macroID));
                 hotTile.state = HOTTILE_INVALID;
                 hotTile.numSamples = numSamples;
                 hotTile.renderTargetArrayIndex = renderTargetArrayIndex;
+                hotTile.clearMask = 0;
+                hotTile.format = GetDefaultHotTileFormat(attachment);
+
+                if (attachment == SWR_ATTACHMENT_DEPTH)
+                {
+                    hotTile.pDepthBounds = (DEPTH_BOUNDS*)_aligned_malloc(sizeof(DEPTH_BOUNDS), 64);
+                    hotTile.pDepthBounds->SetUnknown();
+                }
             }
             else
             {
@@ -331,43 +508,36 @@ public:
                 // new sample count
                 assert((hotTile.state == HOTTILE_INVALID) ||
                        (hotTile.state == HOTTILE_RESOLVED));
-                _aligned_free(hotTile.pBuffer);
+                FreeHotTileMem(hotTile.pBuffer, hotTile.numSamples * mHotTileSize[attachment]);
 
                 uint32_t size = numSamples * mHotTileSize[attachment];
-                hotTile.pBuffer = (BYTE*)_aligned_malloc(size, KNOB_SIMD_WIDTH * 4);
+                hotTile.pBuffer = (BYTE*)AllocHotTileMem(size, KNOB_SIMD_WIDTH * 4, GetTileNumaNode(macroID));
                 hotTile.state = HOTTILE_INVALID;
                 hotTile.numSamples = numSamples;
+                hotTile.clearMask = 0;
             }
 
             // if requested render target array index isn't currently loaded, need to store out the current hottile 
             // and load the requested array slice
             if (renderTargetArrayIndex != hotTile.renderTargetArrayIndex)
             {
-                SWR_FORMAT format;
-                switch (attachment)
-                {
-                case SWR_ATTACHMENT_COLOR0:
-                case SWR_ATTACHMENT_COLOR1:
-                case SWR_ATTACHMENT_COLOR2:
-                case SWR_ATTACHMENT_COLOR3:
-                case SWR_ATTACHMENT_COLOR4:
-                case SWR_ATTACHMENT_COLOR5:
-                case SWR_ATTACHMENT_COLOR6:
-                case SWR_ATTACHMENT_COLOR7: format = KNOB_COLOR_HOT_TILE_FORMAT; break;
-                case SWR_ATTACHMENT_DEPTH: format = KNOB_DEPTH_HOT_TILE_FORMAT; break;
-                case SWR_ATTACHMENT_STENCIL: format = KNOB_STENCIL_HOT_TILE_FORMAT; break;
-                default: SWR_ASSERT(false, "Unknown attachment: %d", attachment); format = KNOB_COLOR_HOT_TILE_FORMAT; break;
-                }
-
+                // the new slice keeps the hot tile format, it belongs to the same surface
                 if (hotTile.state == HOTTILE_DIRTY)
                 {
-                    pContext->pfnStoreTile(GetPrivateState(pDC), format, attachment,
+                    ResolveClear(&hotTile, attachment, hotTile.clearMask);
+                    pContext->pfnStoreTile(GetPrivateState(pDC), hotTile.format, attachment,
                         x * KNOB_MACROTILE_X_DIM, y * KNOB_MACROTILE_Y_DIM, hotTile.renderTargetArrayIndex, hotTile.pBuffer);
                 }
 
-                pContext->pfnLoadTile(GetPrivateState(pDC), format, attachment,
+                pContext->pfnLoadTile(GetPrivateState(pDC), hotTile.format, attachment,
                     x * KNOB_MACROTILE_X_DIM, y * KNOB_MACROTILE_Y_DIM, renderTargetArrayIndex, hotTile.pBuffer);
 
+                if (hotTile.pDepthBounds)
+                {
+                    hotTile.pDepthBounds->SetUnknown();
+                }
+
+                hotTile.clearMask = 0;
                 hotTile.renderTargetArrayIndex = renderTargetArrayIndex;
                 hotTile.state = HOTTILE_DIRTY;
             }
@@ -385,8 +555,191 @@ public:
         return mHotTiles[x][y];
     }
 
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Returns the hot tile format of an attachment before any render
+    ///        target state has picked one.
+    static INLINE SWR_FORMAT GetDefaultHotTileFormat(SWR_RENDERTARGET_ATTACHMENT attachment)
+    {
+        switch (attachment)
+        {
+        case SWR_ATTACHMENT_COLOR0:
+        case SWR_ATTACHMENT_COLOR1:
+        case SWR_ATTACHMENT_COLOR2:
+        case SWR_ATTACHMENT_COLOR3:
+        case SWR_ATTACHMENT_COLOR4:
+        case SWR_ATTACHMENT_COLOR5:
+        case SWR_ATTACHMENT_COLOR6:
+        case SWR_ATTACHMENT_COLOR7: return KNOB_COLOR_HOT_TILE_FORMAT;
+        case SWR_ATTACHMENT_DEPTH: return KNOB_DEPTH_HOT_TILE_FORMAT;
+        case SWR_ATTACHMENT_STENCIL: return KNOB_STENCIL_HOT_TILE_FORMAT;
+        default: SWR_ASSERT(false, "Unknown attachment: %d", attachment); return KNOB_COLOR_HOT_TILE_FORMAT;
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Validates a color hot tile format requested through
+    ///        SWR_RASTSTATE::colorHotTileFormat. Only the compact format has
+    ///        a backend path besides the default one, and it is only taken
+    ///        when the render target is not blended: the float hot tile keeps
+    ///        unquantized blend inputs that the compact one would round.
+    static INLINE SWR_FORMAT GetColorHotTileFormat(SWR_FORMAT requested, bool blendEnable)
+    {
+        if (KNOB_COMPACT_COLOR_HOT_TILES && !blendEnable && requested == KNOB_COMPACT_COLOR_HOT_TILE_FORMAT)
+        {
+            return KNOB_COMPACT_COLOR_HOT_TILE_FORMAT;
+        }
+        return KNOB_COLOR_HOT_TILE_FORMAT;
+    }
+
+    static const uint64_t ALL_RASTER_TILES = ~0ULL >> (64 - KNOB_MACROTILE_X_DIM_IN_TILES * KNOB_MACROTILE_Y_DIM_IN_TILES);
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Returns the clearMask bit of a raster tile within the macrotile.
+    static INLINE uint64_t GetRasterTileBit(uint32_t rtX, uint32_t rtY)
+    {
+        return 1ULL << (rtY * KNOB_MACROTILE_X_DIM_IN_TILES + rtX);
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Applies a pending fast clear to a hot tile. Only the metadata is
+    ///        updated, each raster tile is filled by ResolveClear when it is
+    ///        first drawn to, or written directly to the surface on store.
+    static void DeferClear(HOTTILE* pHotTile);
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Fills the raster tiles in resolveMask that still hold the clear
+    ///        value and removes them from the hot tile's clearMask.
+    static void ResolveClear(HOTTILE* pHotTile, SWR_RENDERTARGET_ATTACHMENT attachment, uint64_t resolveMask);
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Converts a compact color hot tile to KNOB_COLOR_HOT_TILE_FORMAT
+    ///        in place, for draws that can not use the compact format.
+    static void ExpandColorHotTile(HOTTILE* pHotTile);
+
+    INLINE uint32_t GetNumNumaNodes() const { return mNumNumaNodes; }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Returns the NUMA node that owns the hot tiles of a macrotile.
+    ///        Macrotiles are interleaved across nodes in a checkerboard so
+    ///        that every node gets a share of any region of the render target.
+    INLINE uint32_t GetTileNumaNode(uint32_t macroID) const
+    {
+        if (mNumNumaNodes == 1)
+        {
+            return 0;
+        }
+
+        uint32_t x, y;
+        MacroTileMgr::getTileIndices(macroID, x, y);
+        return (x ^ y) % mNumNumaNodes;
+    }
+
 private:
+    void* AllocHotTileMem(uint32_t size, uint32_t align, uint32_t numaNode)
+    {
+        void* p = nullptr;
+        if (mNumNumaNodes > 1)
+        {
+#if defined(_WIN32)
+            p = VirtualAllocExNuma(GetCurrentProcess(), nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE, mNumaNodeIds[numaNode]);
+#else
+            // numa allocations are page aligned which satisfies any hot tile alignment.
+            p = numa_alloc_onnode(size, mNumaNodeIds[numaNode]);
+#endif
+        }
+        else
+        {
+            p = _aligned_malloc(size, align);
+        }
+        SWR_ASSERT(p != nullptr);
+        return p;
+    }
+
+    void FreeHotTileMem(void* pBuffer, uint32_t size)
+    {
+        if (mNumNumaNodes > 1)
+        {
+#if defined(_WIN32)
+            VirtualFree(pBuffer, 0, MEM_RELEASE);
+#else
+            numa_free(pBuffer, size);
+#endif
+        }
+        else
+        {
+            _aligned_free(pBuffer);
+        }
+    }
+
     HotTileSet mHotTiles[KNOB_NUM_HOT_TILES_X][KNOB_NUM_HOT_TILES_Y];
     uint32_t mHotTileSize[SWR_NUM_ATTACHMENTS];
+    std::vector<uint32_t> mNumaNodeIds;     // OS node id of each node index
+    uint32_t mNumNumaNodes;
 };
 
+//////////////////////////////////////////////////////////////////////////
+/// MacroTileScheduler - Schedules backend macrotile work across workers.
+///   Each macrotile of a draw becomes a work item once the FE is done with
+///   the draw. A macrotile only has a single work item in flight at a time,
+///   the work item for the next draw touching the macrotile is handed out
+///   when the previous one completes which keeps draw order per macrotile.
+///   Work items live in per worker, per NUMA node work stealing deques.
+//////////////////////////////////////////////////////////////////////////
+class MacroTileScheduler
+{
+public:
+    MacroTileScheduler(uint32_t numWorkers, uint32_t numNumaNodes);
+    ~MacroTileScheduler();
+
+    void publishDraws(SWR_CONTEXT *pContext, uint64_t curDrawBE, uint32_t workerId);
+    void completeTile(SWR_CONTEXT *pContext, uint64_t drawId, uint32_t tileID, uint32_t workerId);
+    bool parkTile(DRAW_CONTEXT *pDC, uint32_t tileID);
+    bool getWork(uint32_t workerId, uint32_t numaNode, uint32_t &dcSlot, uint32_t &tileID);
+
+    void *operator new(size_t size);
+    void operator delete (void *p);
+
+private:
+    void pushTile(SWR_CONTEXT *pContext, uint32_t workerId, uint64_t drawId, uint32_t tileID);
+    bool popOrSteal(uint32_t workerId, uint32_t numaNode, uint64_t &item);
+    void resumeParkedTiles(SWR_CONTEXT *pContext, DRAW_CONTEXT *pDC, uint32_t workerId);
+
+    INLINE void lockParkedTiles()
+    {
+        while (mParkLock || InterlockedCompareExchange(&mParkLock, 1, 0) != 0)
+        {
+            _mm_pause();
+        }
+    }
+
+    INLINE void unlockParkedTiles()
+    {
+        _ReadWriteBarrier();
+        mParkLock = 0;
+    }
+
+    INLINE WorkStealingDeque<uint64_t>& getDeque(uint32_t workerId, uint32_t numaNode)
+    {
+        return mpDeques[workerId * mNumNumaNodes + numaNode];
+    }
+
+    uint32_t mNumWorkers;
+    uint32_t mNumNumaNodes;
+    WorkStealingDeque<uint64_t>* mpDeques;
+
+    // Number of published draws with work queued to each macrotile that haven't completed yet.
+    volatile LONG mTilePending[KNOB_NUM_HOT_TILES_X][KNOB_NUM_HOT_TILES_Y];
+
+    // Next draw to publish macrotiles for. Only the worker holding the lock publishes.
+    // The draw can be published while its FE is still binning, mNumTilesPublished
+    // tracks how many of its dirty tiles were handed out so far.
+    OSALIGNLINE(volatile uint64_t) mNextPublish;
+    uint32_t mNumTilesPublished;
+    OSALIGNLINE(volatile LONG) mPublishLock;
+
+    // Macrotiles of the draw being streamed that ran out of binned work
+    // before its FE was done. They are handed out again once more work
+    // is binned to them or the FE is done.
+    std::vector<uint32_t> mParkedTiles;
+    OSALIGNLINE(volatile LONG) mParkLock;
+};
@@ -38,8 +38,11 @@
 #if defined(_WIN32)
 #include "llvm/ADT/Triple.h"
 #endif
+#include "llvm/IR/Constants.h"
 #include "llvm/IR/Function.h"
+#include "llvm/Object/ObjectFile.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/Path.h"
 
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/SourceMgr.h"
@@ -51,6 +54,8 @@
 #include "state_llvm.h"
 
 #include <sstream>
+#include <iomanip>
+#include <stdio.h>
 #if defined(_WIN32)
 #include <psapi.h>
 #include <cstring>
@@ -58,6 +63,10 @@
 #define INTEL_OUTPUT_DIR "c:\\Intel"
 #define RASTY_OUTPUT_DIR INTEL_OUTPUT_DIR "\\Rasty"
 #define JITTER_OUTPUT_DIR RASTY_OUTPUT_DIR "\\Jitter"
+#else
+#include <dlfcn.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 using namespace llvm;
@@ -66,13 +75,13 @@ using namespace llvm;
 /// @brief Contructor for JitManager.
 /// @param simdWidth - SIMD width to be used in generated program.
 JitManager::JitManager(uint32_t simdWidth, const char *arch)
-    : mContext(), mBuilder(mContext), mIsModuleFinalized(true), mJitNumber(0), mVWidth(simdWidth), mArch(arch)
+    : mContext(), mBuilder(mContext), mpCurrentModule(nullptr), mIsModuleFinalized(true), mJitNumber(0), mVWidth(simdWidth), mArch(arch)
 {
     InitializeNativeTarget();
     InitializeNativeTargetAsmPrinter();
     InitializeNativeTargetDisassembler();
 
-    TargetOptions    tOpts;
+    TargetOptions    &tOpts = mTargetOptions;
     tOpts.AllowFPOpFusion = FPOpFusion::Fast;
     tOpts.NoInfsFPMath = false;
     tOpts.NoNaNsFPMath = false;
@@ -83,15 +92,6 @@ JitManager::JitManager(uint32_t simdWidth, const char *arch)
 
     //tOpts.PrintMachineCode    = true;
 
-    std::stringstream fnName("JitModule", std::ios_base::in | std::ios_base::out | std::ios_base::ate);
-    fnName << mJitNumber++;
-    std::unique_ptr<Module> newModule(new Module(fnName.str(), mContext));
-    mpCurrentModule = newModule.get();
-
-    auto &&EB = EngineBuilder(std::move(newModule));
-    EB.setTargetOptions(tOpts);
-    EB.setOptLevel(CodeGenOpt::Aggressive);
-
     StringRef hostCPUName;
 
     // force JIT to use the same CPU arch as the rest of rasty
@@ -136,20 +136,12 @@ JitManager::JitManager(uint32_t simdWidth, const char *arch)
         }
     }
 
-    EB.setMCPU(hostCPUName);
+    mCpuName = hostCPUName.str();
 
-#if defined(_WIN32)
-    // Needed for MCJIT on windows
-    Triple hostTriple(sys::getProcessTriple());
-    hostTriple.setObjectFormat(Triple::ELF);
-    mpCurrentModule->setTargetTriple(hostTriple.getTriple());
-#endif // _WIN32
-
-    mpExec = EB.create();
+    mCache.Init(mCpuName, mVWidth);
 
 #if LLVM_USE_INTEL_JITEVENTS
-    JITEventListener *vTune = JITEventListener::createIntelJITEventListener();
-    mpExec->RegisterJITEventListener(vTune);
+    mpVTune = JITEventListener::createIntelJITEventListener();
 #endif
 
     mFP32Ty = Type::getFloatTy(mContext);   // float type
@@ -192,6 +184,128 @@ JitManager::JitManager(uint32_t simdWidth, const char *arch)
 #endif
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Destructor for JitManager.  Frees the code of every function
+///        it handed out that hasn't been freed yet.
+JitManager::~JitManager()
+{
+    if (!mIsModuleFinalized)
+    {
+        delete mpCurrentModule;
+    }
+
+    for (auto& func : mFunctions)
+    {
+        delete func.second.pExec;
+        if (func.second.pfnFree)
+        {
+            func.second.pfnFree(func.second.pFreeData);
+        }
+    }
+
+#if LLVM_USE_INTEL_JITEVENTS
+    delete mpVTune;
+#endif
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Create an engine to compile or load one function.
+/// @param pModule - module the engine takes ownership of.
+ExecutionEngine* JitManager::CreateEngine(Module* pModule)
+{
+    auto &&EB = EngineBuilder(std::unique_ptr<Module>(pModule));
+    EB.setTargetOptions(mTargetOptions);
+    EB.setOptLevel(CodeGenOpt::Aggressive);
+    EB.setMCPU(mCpuName);
+
+    ExecutionEngine* pExec = EB.create();
+
+    // Always set, for the object sizes; it only writes to disk if enabled
+    pExec->setObjectCache(&mCache);
+
+#if LLVM_USE_INTEL_JITEVENTS
+    pExec->RegisterJITEventListener(mpVTune);
+#endif
+
+    return pExec;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Compile the current module with an engine of its own and drop
+///        its IR.  The code stays until FreeFunction.
+/// @param funcName - name of the function to return.
+/// @return Address of the function.
+void* JitManager::FinalizeFunction(const std::string& funcName)
+{
+    Module* pModule = mpCurrentModule;
+    ExecutionEngine* pExec = CreateEngine(pModule);
+
+    mCache.mLastObjectSize = 0;
+    void* pfn = (void*)pExec->getFunctionAddress(funcName);
+    // MCJIT finalizes modules the first time you JIT code from them. After finalized, you cannot add new IR to the module
+    mIsModuleFinalized = true;
+
+    // The object is loaded; nothing needs the IR anymore
+    pExec->removeModule(pModule);
+    delete pModule;
+    mpCurrentModule = nullptr;
+
+    if (!pfn)
+    {
+        delete pExec;
+        return nullptr;
+    }
+
+    AddFunction(pfn, pExec, mCache.mLastObjectSize);
+    return pfn;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Track a function handed out, until FreeFunction.
+/// @param pfn - address of the function.
+/// @param pExec - engine holding its code, deleted to free it.
+/// @param size - size of its object, in bytes.
+/// @param pfnFree - called with pFreeData to free code held elsewhere.
+void JitManager::AddFunction(const void* pfn, ExecutionEngine* pExec, size_t size,
+                             PFN_JIT_FREE pfnFree, void* pFreeData)
+{
+    std::lock_guard<std::mutex> lock(mFunctionsLock);
+
+    SWR_ASSERT(mFunctions.count(pfn) == 0);
+    mFunctions[pfn] = JitFunction{ pExec, pfnFree, pFreeData, size };
+    mCodeSize += size;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Free the code of a function.  The caller makes sure nothing
+///        can run it anymore.  Safe from any thread: freeing doesn't touch
+///        the LLVM context, the IR is gone already.
+/// @param pfn - address of the function.
+void JitManager::FreeFunction(const void* pfn)
+{
+    JitFunction func;
+    {
+        std::lock_guard<std::mutex> lock(mFunctionsLock);
+
+        auto it = mFunctions.find(pfn);
+        if (it == mFunctions.end())
+        {
+            SWR_ASSERT(0, "Freeing a function this JitManager doesn't hold.");
+            return;
+        }
+        func = it->second;
+        mFunctions.erase(it);
+        mCodeSize -= func.size;
+        mNumFreed++;
+    }
+
+    delete func.pExec;
+    if (func.pfnFree)
+    {
+        func.pfnFree(func.pFreeData);
+    }
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief Create new LLVM module.
 void JitManager::SetupNewModule()
@@ -200,16 +314,15 @@ void JitManager::SetupNewModule()
     
     std::stringstream fnName("JitModule", std::ios_base::in | std::ios_base::out | std::ios_base::ate);
     fnName << mJitNumber++;
-    std::unique_ptr<Module> newModule(new Module(fnName.str(), mContext));
-    mpCurrentModule = newModule.get();
+    // Compiled by FinalizeFunction, or by gallivm for shaders
+    mpCurrentModule = new Module(fnName.str(), mContext);
 #if defined(_WIN32)
     // Needed for MCJIT on windows
     Triple hostTriple(sys::getProcessTriple());
     hostTriple.setObjectFormat(Triple::ELF);
-    newModule->setTargetTriple(hostTriple.getTriple());
+    mpCurrentModule->setTargetTriple(hostTriple.getTriple());
 #endif // _WIN32
 
-    mpExec->addModule(std::move(newModule));
     mIsModuleFinalized = false;
 }
 
@@ -228,15 +341,14 @@ bool JitManager::SetupModuleFromIR(const uint8_t *pIR)
         return false;
     }
 
-    mpCurrentModule = newModule.get();
+    mpCurrentModule = newModule.release();
 #if defined(_WIN32)
     // Needed for MCJIT on windows
     Triple hostTriple(sys::getProcessTriple());
     hostTriple.setObjectFormat(Triple::ELF);
-    newModule->setTargetTriple(hostTriple.getTriple());
+    mpCurrentModule->setTargetTriple(hostTriple.getTriple());
 #endif // _WIN32
 
-    mpExec->addModule(std::move(newModule));
     mIsModuleFinalized = false;
 
     return true;
@@ -273,6 +385,378 @@ void JitManager::DumpToFile(Function *f, const char *fileName)
     }
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// @brief Look up a jitted function in the cache before building it.
+/// @param pKind - kind of function, e.g. "FetchShader".
+/// @param pState - state the function is compiled from.
+/// @param stateSize - size of the state in bytes.
+/// @param funcName - set to the name the function must be given if it
+///                   has to be built, or left empty if caching is off.
+/// @return Address of the function, or nullptr if it has to be built.
+void* JitManager::GetCachedFunction(const char* pKind, const void* pState, size_t stateSize, std::string& funcName)
+{
+    funcName.clear();
+    if (!mCache.Enabled())
+    {
+        return nullptr;
+    }
+
+    SWR_ASSERT(mIsModuleFinalized == true && "Current module is not finalized!");
+
+    std::string key = mCache.GetKey(pKind, pState, stateSize);
+    funcName = mCache.GetFuncName(pKind, key);
+
+    std::unique_ptr<MemoryBuffer> pObjBuffer = mCache.Load(funcName, key);
+    if (pObjBuffer)
+    {
+        auto obj = object::ObjectFile::createObjectFile(pObjBuffer->getMemBufferRef());
+        if (obj)
+        {
+            // MCJIT wants a module to create an engine; it stays empty
+            Module* pModule = new Module("JitCacheModule", mContext);
+#if defined(_WIN32)
+            // Needed for MCJIT on windows
+            Triple hostTriple(sys::getProcessTriple());
+            hostTriple.setObjectFormat(Triple::ELF);
+            pModule->setTargetTriple(hostTriple.getTriple());
+#endif // _WIN32
+            ExecutionEngine* pExec = CreateEngine(pModule);
+
+            size_t size = pObjBuffer->getBufferSize();
+            pExec->addObjectFile(object::OwningBinary<object::ObjectFile>(std::move(*obj), std::move(pObjBuffer)));
+
+            // MCJIT relocates and finalizes the object on first lookup
+            uint64_t address = pExec->getFunctionAddress(funcName);
+            pExec->removeModule(pModule);
+            delete pModule;
+
+            if (address)
+            {
+                mCache.mNumHits++;
+                AddFunction((void*)address, pExec, size);
+                return (void*)address;
+            }
+            delete pExec;
+        }
+    }
+
+    mCache.mNumMisses++;
+    mCache.AddPending(funcName, std::move(key));
+    return nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Identify the binary the jitter is built into, so objects cached
+///        by another build of the driver are never loaded.
+static std::string GetBuildId()
+{
+    std::stringstream id;
+#if defined(_WIN32)
+    HMODULE hModule = NULL;
+    char path[MAX_PATH];
+    WIN32_FILE_ATTRIBUTE_DATA attribs;
+    if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                           (LPCSTR)&GetBuildId, &hModule) &&
+        GetModuleFileNameA(hModule, path, MAX_PATH) &&
+        GetFileAttributesExA(path, GetFileExInfoStandard, &attribs))
+    {
+        id << path << ":" << attribs.nFileSizeHigh << ":" << attribs.nFileSizeLow << ":"
+           << attribs.ftLastWriteTime.dwHighDateTime << ":" << attribs.ftLastWriteTime.dwLowDateTime;
+    }
+#else
+    Dl_info info;
+    struct stat st;
+    if (dladdr((void*)&GetBuildId, &info) && info.dli_fname &&
+        stat(info.dli_fname, &st) == 0)
+    {
+        id << info.dli_fname << ":" << st.st_size << ":" << st.st_mtime;
+    }
+#endif
+    return id.str();
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Returns true if the module bakes in addresses of this process,
+///        e.g. gallivm's helper function pointers.  Such objects can't be
+///        reused by another process.
+static bool UsesHostAddress(const Constant* pConst)
+{
+    const ConstantExpr* pExpr = dyn_cast<ConstantExpr>(pConst);
+    if (!pExpr)
+    {
+        return false;
+    }
+
+    if (pExpr->getOpcode() == Instruction::IntToPtr && isa<ConstantInt>(pExpr->getOperand(0)))
+    {
+        return true;
+    }
+
+    for (const Use& op : pExpr->operands())
+    {
+        if (UsesHostAddress(cast<Constant>(op.get())))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool UsesHostAddress(const Module* pModule)
+{
+    for (const GlobalVariable& global : pModule->globals())
+    {
+        if (global.hasInitializer() && UsesHostAddress(global.getInitializer()))
+        {
+            return true;
+        }
+    }
+
+    for (const Function& func : *pModule)
+    {
+        for (const BasicBlock& block : func)
+        {
+            for (const Instruction& inst : block)
+            {
+                for (const Use& op : inst.operands())
+                {
+                    const Constant* pConst = dyn_cast<Constant>(op.get());
+                    if (!pConst)
+                    {
+                        continue;
+                    }
+                    if (UsesHostAddress(pConst) ||
+                        (isa<IntToPtrInst>(inst) && isa<ConstantInt>(pConst)))
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+    return false;
+}
+
+/// Header of a cache file, followed by the full key and the object.
+struct JitCacheFileHeader
+{
+    static const uint64_t MAGIC = 0x31454843544a5753ULL; // "SWJTCHE1"
+
+    uint64_t magic;
+    uint64_t keySize;
+    uint64_t objSize;
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Set up the cache.  It stays disabled if there's no directory
+///        for it or the driver binary can't be identified.
+/// @param cpuName - CPU the jitter generates code for.
+/// @param simdWidth - SIMD width of the generated code.
+void JitCache::Init(const std::string& cpuName, uint32_t simdWidth)
+{
+    mCacheDir.clear();
+    if (!KNOB_JIT_ENABLE_CACHE)
+    {
+        return;
+    }
+
+    std::string buildId = GetBuildId();
+    if (buildId.empty())
+    {
+        return;
+    }
+
+    SmallString<256> dir(KNOB_JIT_CACHE_DIR);
+    if (dir.empty())
+    {
+#if defined(_WIN32)
+        const char* pBase = getenv("LOCALAPPDATA");
+        if (!pBase)
+        {
+            return;
+        }
+        dir = pBase;
+#else
+        const char* pBase = getenv("XDG_CACHE_HOME");
+        if (pBase && *pBase)
+        {
+            dir = pBase;
+        }
+        else
+        {
+            pBase = getenv("HOME");
+            if (!pBase)
+            {
+                return;
+            }
+            dir = pBase;
+            sys::path::append(dir, ".cache");
+        }
+#endif
+        sys::path::append(dir, "mesa", "swr");
+    }
+    mCacheDir = dir.str();
+
+    // Gallivm generates shader IR for the host cpu, the jitter for cpuName
+    std::stringstream prefix;
+    prefix << "LLVM " << LLVM_VERSION_MAJOR << "." << LLVM_VERSION_MINOR
+           << "|" << cpuName << "|" << sys::getHostCPUName().str()
+           << "|" << simdWidth << "|" << buildId;
+    mKeyPrefix = prefix.str();
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Build the full key of a function.
+std::string JitCache::GetKey(const char* pKind, const void* pState, size_t stateSize) const
+{
+    std::string key = mKeyPrefix;
+    key += '\0';
+    key += pKind;
+    key += '\0';
+    key.append((const char*)pState, stateSize);
+    return key;
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Name a function after a 64-bit FNV-1a hash of its key.
+std::string JitCache::GetFuncName(const char* pKind, const std::string& key) const
+{
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : key)
+    {
+        hash = (hash ^ (uint8_t)c) * 0x100000001b3ULL;
+    }
+
+    std::stringstream name;
+    name << pKind << "_" << std::hex << std::setw(16) << std::setfill('0') << hash;
+    return name.str();
+}
+
+std::string JitCache::GetFilePath(const std::string& funcName) const
+{
+    SmallString<256> path(mCacheDir);
+    sys::path::append(path, funcName + ".o");
+    return path.str();
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Read a cached object.  The stored key must match in full, so a
+///        hash collision is just a miss.
+std::unique_ptr<MemoryBuffer> JitCache::Load(const std::string& funcName, const std::string& key)
+{
+    auto file = MemoryBuffer::getFile(GetFilePath(funcName), -1, false);
+    if (!file)
+    {
+        return nullptr;
+    }
+
+    const char* pData = (*file)->getBufferStart();
+    size_t size = (*file)->getBufferSize();
+
+    JitCacheFileHeader header;
+    if (size < sizeof(header))
+    {
+        return nullptr;
+    }
+    memcpy(&header, pData, sizeof(header));
+
+    if (header.magic != JitCacheFileHeader::MAGIC ||
+        header.keySize != key.size() ||
+        size - sizeof(header) < header.keySize ||
+        size - sizeof(header) - header.keySize < header.objSize ||
+        memcmp(pData + sizeof(header), key.data(), key.size()))
+    {
+        return nullptr;
+    }
+
+    // Copy so the object is suitably aligned
+    return MemoryBuffer::getMemBufferCopy(
+        StringRef(pData + sizeof(header) + header.keySize, header.objSize), funcName);
+}
+
+void JitCache::AddPending(const std::string& funcName, std::string&& key)
+{
+    mPending[funcName] = std::move(key);
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Called by MCJIT after compiling a module.  Notes the object size
+///        and writes the object to the cache if the module holds a function
+///        that missed it.
+void JitCache::notifyObjectCompiled(const Module* pModule, MemoryBufferRef obj)
+{
+    mLastObjectSize = obj.getBufferSize();
+
+    auto pending = mPending.end();
+    for (const Function& func : *pModule)
+    {
+        pending = mPending.find(func.getName().str());
+        if (pending != mPending.end())
+        {
+            break;
+        }
+    }
+    if (pending == mPending.end())
+    {
+        return;
+    }
+
+    std::string funcName = pending->first;
+    std::string key = std::move(pending->second);
+    mPending.erase(pending);
+
+    if (UsesHostAddress(pModule))
+    {
+        return;
+    }
+
+    if (sys::fs::create_directories(mCacheDir))
+    {
+        return;
+    }
+
+    // Write to a temporary file and rename it so concurrent processes never
+    // see a partial object.  Each JitManager has its own cache, so the
+    // process id and cache address make the temporary name unique.
+    std::string path = GetFilePath(funcName);
+    std::stringstream tmpPath;
+#if defined(_WIN32)
+    tmpPath << path << "." << GetCurrentProcessId() << "." << this << ".tmp";
+#else
+    tmpPath << path << "." << getpid() << "." << this << ".tmp";
+#endif
+
+    FILE* pFile = fopen(tmpPath.str().c_str(), "wb");
+    if (!pFile)
+    {
+        return;
+    }
+
+    JitCacheFileHeader header;
+    header.magic = JitCacheFileHeader::MAGIC;
+    header.keySize = key.size();
+    header.objSize = obj.getBufferSize();
+
+    bool written =
+        fwrite(&header, sizeof(header), 1, pFile) == 1 &&
+        fwrite(key.data(), 1, key.size(), pFile) == key.size() &&
+        fwrite(obj.getBufferStart(), 1, obj.getBufferSize(), pFile) == obj.getBufferSize();
+    written = (fclose(pFile) == 0) && written;
+
+    if (!written || rename(tmpPath.str().c_str(), path.c_str()) != 0)
+    {
+        remove(tmpPath.str().c_str());
+    }
+}
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Cached objects are loaded directly by JitManager::GetCachedFunction
+///        before any IR is built, so there's never one for a module.
+std::unique_ptr<MemoryBuffer> JitCache::getObject(const Module* pModule)
+{
+    return nullptr;
+}
+
 extern "C"
 {
     //////////////////////////////////////////////////////////////////////////
@@ -289,4 +773,41 @@ extern "C"
     {
         delete reinterpret_cast<JitManager*>(hJitContext);
     }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Get statistics of the on-disk jit cache.
+    void JITCALL JitGetCacheStats(HANDLE hJitContext, JIT_CACHE_STATS& stats)
+    {
+        JitManager* pJitMgr = reinterpret_cast<JitManager*>(hJitContext);
+        stats.numHits = pJitMgr->mCache.mNumHits;
+        stats.numMisses = pJitMgr->mCache.mNumMisses;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Get statistics of the code held by a JIT context.
+    void JITCALL JitGetCodeStats(HANDLE hJitContext, JIT_CODE_STATS& stats)
+    {
+        JitManager* pJitMgr = reinterpret_cast<JitManager*>(hJitContext);
+        std::lock_guard<std::mutex> lock(pJitMgr->mFunctionsLock);
+        stats.numFunctions = pJitMgr->mFunctions.size();
+        stats.codeSize = pJitMgr->mCodeSize;
+        stats.numFreed = pJitMgr->mNumFreed;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Get the size of a jitted function's object, in bytes.
+    size_t JITCALL JitGetFunctionSize(HANDLE hJitContext, const void* pfn)
+    {
+        JitManager* pJitMgr = reinterpret_cast<JitManager*>(hJitContext);
+        std::lock_guard<std::mutex> lock(pJitMgr->mFunctionsLock);
+        auto it = pJitMgr->mFunctions.find(pfn);
+        return it != pJitMgr->mFunctions.end() ? it->second.size : 0;
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Free the code of a jitted function.
+    void JITCALL JitFreeFunction(HANDLE hJitContext, const void* pfn)
+    {
+        reinterpret_cast<JitManager*>(hJitContext)->FreeFunction(pfn);
+    }
 }
@@ -58,12 +58,16 @@
 #include "llvm/PassManager.h"
 #include "llvm/CodeGen/Passes.h"
 #include "llvm/ExecutionEngine/ExecutionEngine.h"
+#include "llvm/ExecutionEngine/ObjectCache.h"
+#include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/TargetSelect.h"
 #include "llvm/Transforms/IPO.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Support/Host.h"
 
+#include <mutex>
+#include <unordered_map>
 
 using namespace llvm;
 //////////////////////////////////////////////////////////////////////////
@@ -129,19 +133,76 @@ struct JitLLVMContext : LLVMContext
 };
 
 
+//////////////////////////////////////////////////////////////////////////
+/// JitCache
+/// @brief On-disk cache of compiled jit objects.  Objects are filed under
+/// a hash of everything that affects the generated code, so a later run
+/// can load a function without building or compiling its IR.
+//////////////////////////////////////////////////////////////////////////
+class JitCache : public ObjectCache
+{
+public:
+    void Init(const std::string& cpuName, uint32_t simdWidth);
+
+    bool Enabled() const { return !mCacheDir.empty(); }
+
+    std::string GetKey(const char* pKind, const void* pState, size_t stateSize) const;
+    std::string GetFuncName(const char* pKind, const std::string& key) const;
+
+    std::unique_ptr<MemoryBuffer> Load(const std::string& funcName, const std::string& key);
+    void AddPending(const std::string& funcName, std::string&& key);
+
+    // ObjectCache interface
+    void notifyObjectCompiled(const Module* pModule, MemoryBufferRef obj) override;
+    std::unique_ptr<MemoryBuffer> getObject(const Module* pModule) override;
+
+    uint64_t mNumHits = 0;
+    uint64_t mNumMisses = 0;
+
+    /// Size of the last object compiled by an engine using this cache
+    size_t mLastObjectSize = 0;
+
+private:
+    std::string GetFilePath(const std::string& funcName) const;
+
+    std::string mCacheDir;
+    std::string mKeyPrefix;     ///< LLVM version, target cpu, simd width and driver build
+
+    /// Full keys of functions being compiled, by function name
+    std::unordered_map<std::string, std::string> mPending;
+};
+
+
+/// Frees code a JitManager doesn't compile itself, e.g. gallivm's
+typedef void(*PFN_JIT_FREE)(void* pData);
+
+//////////////////////////////////////////////////////////////////////////
+/// JitFunction
+/// @brief Code of a jitted function.  Each function gets an engine of its
+/// own, so its code can be freed without touching any other function.
+//////////////////////////////////////////////////////////////////////////
+struct JitFunction
+{
+    ExecutionEngine* pExec;     ///< engine holding the code, or nullptr
+    PFN_JIT_FREE pfnFree;       ///< frees code held elsewhere, or nullptr
+    void* pFreeData;
+    size_t size;                ///< size of the object, in bytes
+};
+
 //////////////////////////////////////////////////////////////////////////
 /// JitManager
 //////////////////////////////////////////////////////////////////////////
 struct JitManager
 {
     JitManager(uint32_t w, const char *arch);
-    ~JitManager(){};
+    ~JitManager();
 
     JitLLVMContext          mContext;   ///< LLVM compiler
     IRBuilder<>             mBuilder;   ///< LLVM IR Builder
-    ExecutionEngine*        mpExec;
+    TargetOptions           mTargetOptions; ///< options of every engine
 
-    // Need to be rebuilt after a JIT and before building new IR
+    // Need to be rebuilt after a JIT and before building new IR.  Owned by
+    // the JitManager until an engine compiles it.
     Module* mpCurrentModule;
     bool mIsModuleFinalized;
     uint32_t mJitNumber;
@@ -174,9 +235,30 @@ struct JitManager
     FunctionType*        mFetchShaderTy;
 
     JitInstructionSet mArch;
+    std::string mCpuName;
+
+    JitCache mCache;
+
+#if LLVM_USE_INTEL_JITEVENTS
+    JITEventListener* mpVTune;
+#endif
+
+    /// Functions handed out and not freed yet, by address.  Functions are
+    /// freed by whichever thread evicts them, so this is locked.
+    std::mutex mFunctionsLock;
+    std::unordered_map<const void*, JitFunction> mFunctions;
+    uint64_t mCodeSize = 0;
+    uint64_t mNumFreed = 0;
 
     void SetupNewModule();
+    void* GetCachedFunction(const char* pKind, const void* pState, size_t stateSize, std::string& funcName);
     bool SetupModuleFromIR(const uint8_t *pIR);
 
+    ExecutionEngine* CreateEngine(Module* pModule);
+    void* FinalizeFunction(const std::string& funcName);
+    void AddFunction(const void* pfn, ExecutionEngine* pExec, size_t size,
+                     PFN_JIT_FREE pfnFree = nullptr, void* pFreeData = nullptr);
+    void FreeFunction(const void* pfn);
+
     static void DumpToFile(Function *f, const char *fileName);
 };
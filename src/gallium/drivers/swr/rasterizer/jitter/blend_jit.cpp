@@ -34,6 +34,7 @@
 #include "common/containers.hpp"
 #include "llvm/IR/DataLayout.h"
 
+#include <atomic>
 #include <sstream>
 
 // components with bit-widths <= the QUANTIZE_THRESHOLD will be quantized
@@ -306,7 +307,7 @@ struct BlendJit : public Builder
 
     Function* Create(const BLEND_COMPILE_STATE& state)
     {
-        static std::size_t jitNum = 0;
+        static std::atomic<std::size_t> jitNum{ 0 };
 
         std::stringstream fnName("BlendShader", std::ios_base::in | std::ios_base::out | std::ios_base::ate);
         fnName << jitNum++;
@@ -449,9 +450,8 @@ PFN_BLEND_JIT_FUNC JitBlendFunc(HANDLE hJitMgr, const HANDLE hFunc)
     const llvm::Function *func = (const llvm::Function*)hFunc;
     JitManager* pJitMgr = reinterpret_cast<JitManager*>(hJitMgr);
     PFN_BLEND_JIT_FUNC pfnBlend;
-    pfnBlend = (PFN_BLEND_JIT_FUNC)(pJitMgr->mpExec->getFunctionAddress(func->getName().str()));
-    // MCJIT finalizes modules the first time you JIT code from them. After finalized, you cannot add new IR to the module
-    pJitMgr->mIsModuleFinalized = true;
+    // Compiles the module in an engine of its own and frees the IR
+    pfnBlend = (PFN_BLEND_JIT_FUNC)(pJitMgr->FinalizeFunction(func->getName().str()));
 
     return pfnBlend;
 }
@@ -464,10 +464,22 @@ extern "C" PFN_BLEND_JIT_FUNC JITCALL JitCompileBlend(HANDLE hJitMgr, const BLEN
 {
     JitManager* pJitMgr = reinterpret_cast<JitManager*>(hJitMgr);
 
+    // The state is zero-initialized by its callers, so it hashes as is
+    std::string funcName;
+    PFN_BLEND_JIT_FUNC pfn = (PFN_BLEND_JIT_FUNC)pJitMgr->GetCachedFunction("BlendShader", &state, sizeof(state), funcName);
+    if (pfn)
+    {
+        return pfn;
+    }
+
     pJitMgr->SetupNewModule();
 
     BlendJit theJit(pJitMgr);
     HANDLE hFunc = theJit.Create(state);
+    if (!funcName.empty())
+    {
+        ((Function*)hFunc)->setName(funcName);
+    }
 
     return JitBlendFunc(hJitMgr, hFunc);
 }
@@ -33,6 +33,7 @@
 #include "state_llvm.h"
 #include "common/containers.hpp"
 #include "llvm/IR/DataLayout.h"
+#include <atomic>
 #include <sstream>
 #include <tuple>
 
@@ -80,7 +81,7 @@ struct FetchJit : public Builder
 
 Function* FetchJit::Create(const FETCH_COMPILE_STATE& fetchState)
 {
-    static std::size_t fetchNum = 0;
+    static std::atomic<std::size_t> fetchNum{ 0 };
 
     std::stringstream fnName("FetchShader", std::ios_base::in | std::ios_base::out | std::ios_base::ate);
     fnName << fetchNum++;
@@ -1416,14 +1417,14 @@ PFN_FETCH_FUNC JitFetchFunc(HANDLE hJitMgr, const HANDLE hFunc)
     const llvm::Function* func = (const llvm::Function*)hFunc;
     JitManager* pJitMgr = reinterpret_cast<JitManager*>(hJitMgr);
     PFN_FETCH_FUNC pfnFetch;
+    std::string name = func->getName().str();
 
-    pfnFetch = (PFN_FETCH_FUNC)(pJitMgr->mpExec->getFunctionAddress(func->getName().str()));
-    // MCJIT finalizes modules the first time you JIT code from them. After finalized, you cannot add new IR to the module
-    pJitMgr->mIsModuleFinalized = true;
+    // Compiles the module in an engine of its own and frees the IR
+    pfnFetch = (PFN_FETCH_FUNC)(pJitMgr->FinalizeFunction(name));
 
 #if defined(KNOB_SWRC_TRACING)
     char fName[1024];
-    const char *funcName = func->getName().data();
+    const char *funcName = name.c_str();
     sprintf(fName, "%s.bin", funcName);
     FILE *fd = fopen(fName, "wb");
     fwrite((void *)pfnFetch, 1, 2048, fd);
@@ -1441,10 +1442,39 @@ extern "C" PFN_FETCH_FUNC JITCALL JitCompileFetch(HANDLE hJitMgr, const FETCH_CO
 {
     JitManager* pJitMgr = reinterpret_cast<JitManager*>(hJitMgr);
 
+    // Key on just the fields FETCH_COMPILE_STATE::operator== compares
+    FETCH_COMPILE_STATE key;
+    memset(&key, 0, sizeof(key));
+    key.numAttribs = state.numAttribs;
+    key.indexType = state.indexType;
+    key.cutIndex = state.cutIndex;
+    key.bDisableVGATHER = state.bDisableVGATHER;
+    key.bDisableIndexOOBCheck = state.bDisableIndexOOBCheck;
+    key.bEnableCutIndex = state.bEnableCutIndex;
+    for (uint32_t i = 0; i < state.numAttribs; ++i)
+    {
+        key.layout[i].bits = state.layout[i].bits;
+        if (state.layout[i].InstanceEnable)
+        {
+            key.layout[i].InstanceDataStepRate = state.layout[i].InstanceDataStepRate;
+        }
+    }
+
+    std::string funcName;
+    PFN_FETCH_FUNC pfn = (PFN_FETCH_FUNC)pJitMgr->GetCachedFunction("FetchShader", &key, sizeof(key), funcName);
+    if (pfn)
+    {
+        return pfn;
+    }
+
     pJitMgr->SetupNewModule();
 
     FetchJit theJit(pJitMgr);
     HANDLE hFunc = theJit.Create(state);
+    if (!funcName.empty())
+    {
+        ((Function*)hFunc)->setName(funcName);
+    }
 
     return JitFetchFunc(hJitMgr, hFunc);
 }
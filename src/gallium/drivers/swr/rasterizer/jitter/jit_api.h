@@ -53,6 +53,50 @@ HANDLE JITCALL JitCreateContext(uint32_t targetSimdWidth, const char* arch);
 /// @brief Destroy JIT context.
 void JITCALL JitDestroyContext(HANDLE hJitContext);
 
+//////////////////////////////////////////////////////////////////////////
+/// Jit Cache Statistics
+//////////////////////////////////////////////////////////////////////////
+struct JIT_CACHE_STATS
+{
+    uint64_t numHits;       ///< Functions found in the on-disk cache.
+    uint64_t numMisses;     ///< Functions built because they weren't cached.
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Get statistics of the on-disk jit cache.
+/// @param hJitContext - Jit Context
+/// @param stats - Receives the statistics
+void JITCALL JitGetCacheStats(HANDLE hJitContext, JIT_CACHE_STATS& stats);
+
+//////////////////////////////////////////////////////////////////////////
+/// Jit Code Statistics
+//////////////////////////////////////////////////////////////////////////
+struct JIT_CODE_STATS
+{
+    uint64_t numFunctions;  ///< Functions whose code is held.
+    uint64_t codeSize;      ///< Bytes of object code they take.
+    uint64_t numFreed;      ///< Functions freed with JitFreeFunction.
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Get statistics of the code held by a JIT context.
+/// @param hJitContext - Jit Context
+/// @param stats - Receives the statistics
+void JITCALL JitGetCodeStats(HANDLE hJitContext, JIT_CODE_STATS& stats);
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Get the size of a jitted function's object code.
+/// @param hJitContext - Jit Context that compiled the function
+/// @param pfn - The function
+size_t JITCALL JitGetFunctionSize(HANDLE hJitContext, const void* pfn);
+
+//////////////////////////////////////////////////////////////////////////
+/// @brief Free the code of a jitted function.  No draw may still use it.
+///        May be called from any thread.
+/// @param hJitContext - Jit Context that compiled the function
+/// @param pfn - The function
+void JITCALL JitFreeFunction(HANDLE hJitContext, const void* pfn);
+
 //////////////////////////////////////////////////////////////////////////
 /// Jit Compile Info Input
 //////////////////////////////////////////////////////////////////////////
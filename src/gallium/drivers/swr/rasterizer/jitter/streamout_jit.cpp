@@ -34,6 +34,7 @@
 #include "common/containers.hpp"
 #include "llvm/IR/DataLayout.h"
 
+#include <atomic>
 #include <sstream>
 #include <unordered_set>
 
@@ -257,7 +258,7 @@ struct StreamOutJit : public Builder
 
     Function* Create(const STREAMOUT_COMPILE_STATE& state)
     {
-        static std::size_t soNum = 0;
+        static std::atomic<std::size_t> soNum{ 0 };
 
         std::stringstream fnName("SOShader", std::ios_base::in | std::ios_base::out | std::ios_base::ate);
         fnName << soNum++;
@@ -324,9 +325,8 @@ PFN_SO_FUNC JitStreamoutFunc(HANDLE hJitMgr, const HANDLE hFunc)
     const llvm::Function *func = (const llvm::Function*)hFunc;
     JitManager* pJitMgr = reinterpret_cast<JitManager*>(hJitMgr);
     PFN_SO_FUNC pfnStreamOut;
-    pfnStreamOut = (PFN_SO_FUNC)(pJitMgr->mpExec->getFunctionAddress(func->getName().str()));
-    // MCJIT finalizes modules the first time you JIT code from them. After finalized, you cannot add new IR to the module
-    pJitMgr->mIsModuleFinalized = true;
+    // Compiles the module in an engine of its own and frees the IR
+    pfnStreamOut = (PFN_SO_FUNC)(pJitMgr->FinalizeFunction(func->getName().str()));
 
     return pfnStreamOut;
 }
@@ -339,10 +339,22 @@ extern "C" PFN_SO_FUNC JITCALL JitCompileStreamout(HANDLE hJitMgr, const STREAMO
 {
     JitManager* pJitMgr = reinterpret_cast<JitManager*>(hJitMgr);
 
+    // The state is zero-initialized by its callers, so it hashes as is
+    std::string funcName;
+    PFN_SO_FUNC pfn = (PFN_SO_FUNC)pJitMgr->GetCachedFunction("StreamOut", &state, sizeof(state), funcName);
+    if (pfn)
+    {
+        return pfn;
+    }
+
     pJitMgr->SetupNewModule();
 
     StreamOutJit theJit(pJitMgr);
     HANDLE hFunc = theJit.Create(state);
+    if (!funcName.empty())
+    {
+        ((Function*)hFunc)->setName(funcName);
+    }
 
     return JitStreamoutFunc(hJitMgr, hFunc);
 }
@@ -32,8 +32,9 @@
 #include "memory/TilingFunctions.h"
 #include "memory/tilingtraits.h"
 #include "memory/Convert.h"
+#include "core/format_conversion.h"
 
-typedef void(*PFN_STORE_TILES_CLEAR)(const FLOAT*, SWR_SURFACE_STATE*, UINT, UINT);
+typedef void(*PFN_STORE_TILES_CLEAR)(const FLOAT*, SWR_SURFACE_STATE*, UINT, UINT, uint32_t);
 
 //////////////////////////////////////////////////////////////////////////
 /// Clear Raster Tile Function Tables.
@@ -50,45 +51,107 @@ struct StoreRasterTileClear
 {
     //////////////////////////////////////////////////////////////////////////
     /// @brief Stores an 8x8 raster tile to the destination surface.
-    /// @param pColor - Pointer to clear color.
+    /// @param dstFormattedColor - Clear color converted to the destination format.
     /// @param pDstSurface - Destination surface state
     /// @param x, y - Coordinates to raster tile.
+    /// @param sampleNum - Sample to write.
+    /// @param renderTargetArrayIndex - Array slice to write.
     INLINE static void StoreClear(
         const BYTE* dstFormattedColor,
         UINT dstBytesPerPixel,
         SWR_SURFACE_STATE* pDstSurface,
-        UINT x, UINT y) // (x, y) pixel coordinate to start of raster tile.
+        UINT x, UINT y, // (x, y) pixel coordinate to start of raster tile.
+        uint32_t sampleNum, uint32_t renderTargetArrayIndex)
     {
-        // Compute destination address for raster tile.
-        BYTE* pDstTile = (BYTE*)pDstSurface->pBaseAddress +
-            (y * pDstSurface->pitch) + (x * dstBytesPerPixel);
+        uint32_t lodWidth = std::max(pDstSurface->width >> pDstSurface->lod, 1U);
+        uint32_t lodHeight = std::max(pDstSurface->height >> pDstSurface->lod, 1U);
+        uint32_t arrayIndex = pDstSurface->arrayIndex + renderTargetArrayIndex;
 
-        // start of first row
-        BYTE* pDst = pDstTile;
-        UINT dstBytesPerRow = 0;
-
-        // For each raster tile pixel in row 0 (rx, 0)
-        for (UINT rx = 0; (rx < KNOB_TILE_X_DIM) && ((x + rx) < pDstSurface->width); ++rx)
+        // For each raster tile row within the surface
+        for (UINT ry = 0; (ry < KNOB_TILE_Y_DIM) && ((y + ry) < lodHeight); ++ry)
         {
-            memcpy(pDst, dstFormattedColor, dstBytesPerPixel);
+            if (pDstSurface->tileMode == SWR_TILE_NONE)
+            {
+                BYTE* pDst = (BYTE*)ComputeSurfaceAddress<false>(x, (y + ry), arrayIndex, arrayIndex,
+                    sampleNum, pDstSurface->lod, pDstSurface);
 
-            // Increment pointer to next pixel in row.
-            pDst += dstBytesPerPixel;
-            dstBytesPerRow += dstBytesPerPixel;
+                for (UINT rx = 0; (rx < KNOB_TILE_X_DIM) && ((x + rx) < lodWidth); ++rx)
+                {
+                    memcpy(pDst, dstFormattedColor, dstBytesPerPixel);
+                    pDst += dstBytesPerPixel;
+                }
+            }
+            else
+            {
+                // pixels of a row aren't necessarily adjacent in a tiled surface
+                for (UINT rx = 0; (rx < KNOB_TILE_X_DIM) && ((x + rx) < lodWidth); ++rx)
+                {
+                    BYTE* pDst = (BYTE*)ComputeSurfaceAddress<false>((x + rx), (y + ry), arrayIndex, arrayIndex,
+                        sampleNum, pDstSurface->lod, pDstSurface);
+                    memcpy(pDst, dstFormattedColor, dstBytesPerPixel);
+                }
+            }
         }
+    }
+};
+
+//////////////////////////////////////////////////////////////////////////
+/// ConvertClearColor - Converts the clear color to the destination format
+/// once per macro tile. Formats the hot tile store converts with StoreSOA
+/// (see OptStoreRasterTile) go through the same SIMD conversion, so a
+/// cleared tile written here matches one written from the hot tile.
+//////////////////////////////////////////////////////////////////////////
+template<SWR_FORMAT SrcFormat, SWR_FORMAT DstFormat>
+struct ConvertClearColor
+{
+    template<typename TransposeT>
+    static auto HasTranspose(int) -> decltype(TransposeT::Transpose((const BYTE*)nullptr, (BYTE*)nullptr), std::true_type());
+    template<typename TransposeT>
+    static std::false_type HasTranspose(...);
+
+    static const UINT bpp = FormatTraits<DstFormat>::bpp;
+    static const bool bSimd = decltype(HasTranspose<typename FormatTraits<DstFormat>::TransposeT>(0))::value &&
+        ((bpp == 8) || (bpp == 16) || (bpp == 32) || (bpp == 64) || (bpp == 128));
 
-        // start of second row
-        pDst = pDstTile + pDstSurface->pitch;
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Converts one pixel of clear color.
+    /// @param pColor - Clear color in SrcFormat.
+    /// @param pDst - Receives bpp / 8 bytes in DstFormat.
+    INLINE static void Convert(const FLOAT *pColor, BYTE *pDst)
+    {
+        Convert(pColor, pDst, std::integral_constant<bool, bSimd>());
+    }
 
-        // For each remaining row in the rest of the raster tile
-        for (UINT ry = 1; (ry < KNOB_TILE_Y_DIM) && ((y + ry) < pDstSurface->height); ++ry)
+    INLINE static void Convert(const FLOAT *pColor, BYTE *pDst, std::true_type)
+    {
+        static const uint32_t MAX_RASTER_TILE_BYTES = 128; // 8 pixels * 16 bytes per pixel
+
+        OSALIGNSIMD(BYTE) soaTile[MAX_RASTER_TILE_BYTES];
+        OSALIGNSIMD(BYTE) aosTile[MAX_RASTER_TILE_BYTES];
+
+        simdvector vColor;
+        for (UINT comp = 0; comp < 4; ++comp)
         {
-            // copy row
-            memcpy(pDst, pDstTile, dstBytesPerRow);
+            vColor.v[comp] = (comp < FormatTraits<SrcFormat>::numComps) ? _simd_set1_ps(pColor[comp]) : _simd_setzero_ps();
+        }
 
-            // Increment pointer to first pixel in next row.
-            pDst += pDstSurface->pitch;
+        StoreSOA<DstFormat>(vColor, soaTile);
+        FormatTraits<DstFormat>::TransposeT::Transpose(soaTile, aosTile);
+
+        memcpy(pDst, aosTile, bpp / 8);
+    }
+
+    INLINE static void Convert(const FLOAT *pColor, BYTE *pDst, std::false_type)
+    {
+        FLOAT srcColor[4];
+
+        for (UINT comp = 0; comp < FormatTraits<DstFormat>::numComps; ++comp)
+        {
+            srcColor[comp] = pColor[FormatTraits<DstFormat>::swizzle(comp)];
         }
+
+        // packed, 24bpp and 48bpp formats are stored with ConvertPixelFromFloat too
+        ConvertPixelFromFloat<DstFormat>(pDst, srcColor);
     }
 };
 
@@ -103,54 +166,57 @@ struct StoreMacroTileClear
     /// @param pColor - Pointer to color to write to pixels.
     /// @param pDstSurface - Destination surface state
     /// @param x, y - Coordinates to macro tile
+    /// @param renderTargetArrayIndex - Array slice to write.
     static void StoreClear(
         const FLOAT *pColor,
         SWR_SURFACE_STATE* pDstSurface,
-        UINT x, UINT y)
+        UINT x, UINT y, uint32_t renderTargetArrayIndex)
     {
         UINT dstBytesPerPixel = (FormatTraits<DstFormat>::bpp / 8);
 
         BYTE dstFormattedColor[16]; // max bpp is 128, so 16 is all we need here for one pixel
 
-        FLOAT srcColor[4];
-
-        for (UINT comp = 0; comp < FormatTraits<DstFormat>::numComps; ++comp)
-        {
-            srcColor[comp] = pColor[FormatTraits<DstFormat>::swizzle(comp)];
-        }
-
-        // using this helper function, but the Tiling Traits is unused inside it so just using a dummy value
-        ConvertPixelFromFloat<DstFormat>(dstFormattedColor, srcColor);
+        ConvertClearColor<SrcFormat, DstFormat>::Convert(pColor, dstFormattedColor);
 
         // Store each raster tile from the hot tile to the destination surface.
-        // TODO:  Put in check for partial coverage on x/y -- SWR_ASSERT if it happens.
-        //        Intent is for this function to only handle full tiles.
         for (UINT row = 0; row < KNOB_MACROTILE_Y_DIM; row += KNOB_TILE_Y_DIM)
         {
             for (UINT col = 0; col < KNOB_MACROTILE_X_DIM; col += KNOB_TILE_X_DIM)
             {
-                StoreRasterTileClear<SrcFormat, DstFormat>::StoreClear(dstFormattedColor, dstBytesPerPixel, pDstSurface, (x + col), (y + row));
+                for (uint32_t sampleNum = 0; sampleNum < pDstSurface->numSamples; sampleNum++)
+                {
+                    StoreRasterTileClear<SrcFormat, DstFormat>::StoreClear(dstFormattedColor, dstBytesPerPixel, pDstSurface,
+                        (x + col), (y + row), sampleNum, renderTargetArrayIndex);
+                }
             }
         }
     }
 };
 
 //////////////////////////////////////////////////////////////////////////
-/// @brief Writes clear color to every pixel of a render surface
-/// @param hPrivateContext - Handle to private DC
+/// @brief Writes clear color to every pixel of a macro tile of a render surface
+/// @param pDstSurface - Destination surface
 /// @param renderTargetIndex - Index to destination render target
-/// @param x, y - Coordinates to raster tile.
+/// @param x, y - Coordinates to macro tile.
+/// @param renderTargetArrayIndex - Array slice to write.
 /// @param pClearColor - Pointer to clear color
-void StoreHotTileClear(
+/// @return false if the surface format isn't supported, the caller has to
+///         store the cleared hot tile instead.
+bool StoreHotTileClear(
     SWR_SURFACE_STATE *pDstSurface,
     SWR_RENDERTARGET_ATTACHMENT renderTargetIndex,
     UINT x,
     UINT y,
+    uint32_t renderTargetArrayIndex,
     const float* pClearColor)
 {
     PFN_STORE_TILES_CLEAR pfnStoreTilesClear = NULL;
 
-    SWR_ASSERT(renderTargetIndex != SWR_ATTACHMENT_STENCIL);  ///@todo Not supported yet.
+    if (renderTargetIndex == SWR_ATTACHMENT_STENCIL)
+    {
+        ///@todo Not supported yet.
+        return false;
+    }
 
     if (renderTargetIndex != SWR_ATTACHMENT_DEPTH)
     {
@@ -161,14 +227,14 @@ void StoreHotTileClear(
         pfnStoreTilesClear = sStoreTilesClearDepthTable[pDstSurface->format];
     }
 
-    SWR_ASSERT(pfnStoreTilesClear != NULL);
-
-    // Store a macro tile.
-    /// @todo Once all formats are supported then if check can go away. This is to help us near term to make progress.
-    if (pfnStoreTilesClear != NULL)
+    if (pfnStoreTilesClear == NULL)
     {
-        pfnStoreTilesClear(pClearColor, pDstSurface, x, y);
+        return false;
     }
+
+    // Store a macro tile.
+    pfnStoreTilesClear(pClearColor, pDstSurface, x, y, renderTargetArrayIndex);
+    return true;
 }
 
 //////////////////////////////////////////////////////////////////////////
@@ -277,6 +343,7 @@ void StoreHotTileClear(
     \
     sStoreTilesClearDepthTable[R32_FLOAT] = StoreMacroTileClear<R32_FLOAT, R32_FLOAT>::StoreClear; \
     sStoreTilesClearDepthTable[R24_UNORM_X8_TYPELESS] = StoreMacroTileClear<R32_FLOAT, R24_UNORM_X8_TYPELESS>::StoreClear; \
+    sStoreTilesClearDepthTable[R16_UNORM] = StoreMacroTileClear<R32_FLOAT, R16_UNORM>::StoreClear; \
 
 //////////////////////////////////////////////////////////////////////////
 /// @brief Sets up tables for ClearTile
@@ -259,8 +259,10 @@ static void ConvertPixelFromFloat(
             // Float scale to integer scale.
             UINT scale = (1 << FormatTraits<DstFormat>::GetBPC(comp)) - 1;
             src = (float)scale * src;
-            src = roundf(src);
-            outColor[comp] = (UINT)src; // Drop fractional part.
+
+            // Round to nearest even like the simd store path (_simd_cvtps_epi32),
+            // partial raster tiles must store the same bits as full ones.
+            outColor[comp] = (UINT)_mm_cvtss_si32(_mm_set_ss(src));
             break;
         }
         case SWR_TYPE_SNORM:
@@ -278,10 +280,8 @@ static void ConvertPixelFromFloat(
             UINT scale = (1 << (FormatTraits<DstFormat>::GetBPC(comp) - 1)) - 1;
             src = (float)scale * src;
 
-            // Round
-            src += (src >= 0) ? 0.5f : -0.5f;
-
-            INT out = (INT)src;
+            // Round to nearest even like the simd store path (_simd_cvtps_epi32)
+            INT out = _mm_cvtss_si32(_mm_set_ss(src));
 
             outColor[comp] = *(UINT*)&out;
 
@@ -46,6 +46,11 @@ static PFN_LOAD_TILES sLoadTilesColorTable_SWR_TILE_MODE_XMAJOR[NUM_SWR_FORMATS]
 
 static PFN_LOAD_TILES sLoadTilesDepthTable_SWR_TILE_MODE_YMAJOR[NUM_SWR_FORMATS];
 
+// color surfaces that can be loaded into a KNOB_COMPACT_COLOR_HOT_TILE_FORMAT hot tile
+static PFN_LOAD_TILES sLoadTilesCompactColorTable_SWR_TILE_NONE[NUM_SWR_FORMATS];
+static PFN_LOAD_TILES sLoadTilesCompactColorTable_SWR_TILE_MODE_YMAJOR[NUM_SWR_FORMATS];
+static PFN_LOAD_TILES sLoadTilesCompactColorTable_SWR_TILE_MODE_XMAJOR[NUM_SWR_FORMATS];
+
 //////////////////////////////////////////////////////////////////////////
 /// LoadRasterTile
 //////////////////////////////////////////////////////////////////////////
@@ -185,8 +190,27 @@ void LoadHotTile(
         return;
     }
     
-    if (renderTargetIndex < SWR_ATTACHMENT_DEPTH)
+    if (renderTargetIndex < SWR_ATTACHMENT_DEPTH && dstFormat == KNOB_COMPACT_COLOR_HOT_TILE_FORMAT)
     {
+        switch (pSrcSurface->tileMode)
+        {
+        case SWR_TILE_NONE:
+            pfnLoadTiles = sLoadTilesCompactColorTable_SWR_TILE_NONE[pSrcSurface->format];
+            break;
+        case SWR_TILE_MODE_YMAJOR:
+            pfnLoadTiles = sLoadTilesCompactColorTable_SWR_TILE_MODE_YMAJOR[pSrcSurface->format];
+            break;
+        case SWR_TILE_MODE_XMAJOR:
+            pfnLoadTiles = sLoadTilesCompactColorTable_SWR_TILE_MODE_XMAJOR[pSrcSurface->format];
+            break;
+        default:
+            SWR_ASSERT(0, "Unsupported tiling mode");
+            break;
+        }
+    }
+    else if (renderTargetIndex < SWR_ATTACHMENT_DEPTH)
+    {
+        SWR_ASSERT(dstFormat == KNOB_COLOR_HOT_TILE_FORMAT);
         switch (pSrcSurface->tileMode)
         {
         case SWR_TILE_NONE:
@@ -368,10 +392,23 @@ void LoadHotTile(
     sLoadTilesDepthTable_##tilemode[R32_FLOAT] = LoadMacroTile<TilingTraits<tilemode, 32>, R32_FLOAT, R32_FLOAT>::Load; \
     sLoadTilesDepthTable_##tilemode[R24_UNORM_X8_TYPELESS] = LoadMacroTile<TilingTraits<tilemode, 32>, R24_UNORM_X8_TYPELESS, R32_FLOAT>::Load; \
 
+//////////////////////////////////////////////////////////////////////////
+/// INIT_LOAD_TILES_COMPACT_COLOR_TABLE - Helper macro for setting up the tables.
+/// Only unorm8 surfaces convert exactly to and from the compact hot tile.
+#define INIT_LOAD_TILES_COMPACT_COLOR_TABLE(tilemode) \
+    memset(sLoadTilesCompactColorTable_##tilemode, 0, sizeof(sLoadTilesCompactColorTable_##tilemode)); \
+    \
+    sLoadTilesCompactColorTable_##tilemode[R8G8B8A8_UNORM] = LoadMacroTile<TilingTraits<tilemode, 32>, R8G8B8A8_UNORM, KNOB_COMPACT_COLOR_HOT_TILE_FORMAT>::Load; \
+    sLoadTilesCompactColorTable_##tilemode[B8G8R8A8_UNORM] = LoadMacroTile<TilingTraits<tilemode, 32>, B8G8R8A8_UNORM, KNOB_COMPACT_COLOR_HOT_TILE_FORMAT>::Load; \
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief Sets up tables for LoadTile
 void InitSimLoadTilesTable()
 {
+    INIT_LOAD_TILES_COMPACT_COLOR_TABLE(SWR_TILE_NONE);
+    INIT_LOAD_TILES_COMPACT_COLOR_TABLE(SWR_TILE_MODE_YMAJOR);
+    INIT_LOAD_TILES_COMPACT_COLOR_TABLE(SWR_TILE_MODE_XMAJOR);
+
     INIT_LOAD_TILES_COLOR_TABLE(SWR_TILE_NONE);
     INIT_LOAD_TILES_DEPTH_TABLE(SWR_TILE_NONE);
 
@@ -48,6 +48,9 @@ static PFN_STORE_TILES sStoreTilesTableColor[SWR_TILE_MODE_COUNT][NUM_SWR_FORMAT
 static PFN_STORE_TILES sStoreTilesTableDepth[SWR_TILE_MODE_COUNT][NUM_SWR_FORMATS] = {};
 static PFN_STORE_TILES sStoreTilesTableStencil[SWR_TILE_MODE_COUNT][NUM_SWR_FORMATS] = {};
 
+// color surfaces that can be stored from a KNOB_COMPACT_COLOR_HOT_TILE_FORMAT hot tile
+static PFN_STORE_TILES sStoreTilesTableCompactColor[SWR_TILE_MODE_COUNT][NUM_SWR_FORMATS] = {};
+
 //////////////////////////////////////////////////////////////////////////
 /// StorePixels
 /// @brief Stores a 4x2 (AVX) raster-tile to two rows.
@@ -1456,8 +1459,13 @@ void StoreHotTile(
     SWR_ASSERT(pDstSurface->type != SURFACE_NULL);
 
     PFN_STORE_TILES pfnStoreTiles = nullptr;
-    if(renderTargetIndex <= SWR_ATTACHMENT_COLOR7)
+    if(renderTargetIndex <= SWR_ATTACHMENT_COLOR7 && srcFormat == KNOB_COMPACT_COLOR_HOT_TILE_FORMAT)
+    {
+        pfnStoreTiles = sStoreTilesTableCompactColor[pDstSurface->tileMode][pDstSurface->format];
+    }
+    else if(renderTargetIndex <= SWR_ATTACHMENT_COLOR7)
     {
+        SWR_ASSERT(srcFormat == KNOB_COLOR_HOT_TILE_FORMAT);
         pfnStoreTiles = sStoreTilesTableColor[pDstSurface->tileMode][pDstSurface->format];
     }
     else if(renderTargetIndex == SWR_ATTACHMENT_DEPTH)
@@ -1629,10 +1637,25 @@ void InitStoreTilesTableStencil(
     table[TileModeT][R8_UINT]                   = StoreMacroTile<TilingTraits<TileModeT, 8>, R8_UINT, R8_UINT>::Store;
 }
 
+//////////////////////////////////////////////////////////////////////////
+/// InitStoreTilesTableCompactColor - Helper for setting up the tables.
+/// Only unorm8 surfaces convert exactly to and from the compact hot tile.
+template <SWR_TILE_MODE TileModeT, size_t NumTileModes, size_t ArraySizeT>
+void InitStoreTilesTableCompactColor(
+    PFN_STORE_TILES(&table)[NumTileModes][ArraySizeT])
+{
+    table[TileModeT][R8G8B8A8_UNORM]            = StoreMacroTile<TilingTraits<TileModeT, 32>, KNOB_COMPACT_COLOR_HOT_TILE_FORMAT, R8G8B8A8_UNORM>::Store;
+    table[TileModeT][B8G8R8A8_UNORM]            = StoreMacroTile<TilingTraits<TileModeT, 32>, KNOB_COMPACT_COLOR_HOT_TILE_FORMAT, B8G8R8A8_UNORM>::Store;
+}
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief Sets up tables for StoreTile
 void InitSimStoreTilesTable()
 {
+    InitStoreTilesTableCompactColor<SWR_TILE_NONE>(sStoreTilesTableCompactColor);
+    InitStoreTilesTableCompactColor<SWR_TILE_MODE_YMAJOR>(sStoreTilesTableCompactColor);
+    InitStoreTilesTableCompactColor<SWR_TILE_MODE_XMAJOR>(sStoreTilesTableCompactColor);
+
     InitStoreTilesTableColor<SWR_TILE_NONE>(sStoreTilesTableColor);
     InitStoreTilesTableDepth<SWR_TILE_NONE>(sStoreTilesTableDepth);
     InitStoreTilesTableStencil<SWR_TILE_NONE>(sStoreTilesTableStencil);
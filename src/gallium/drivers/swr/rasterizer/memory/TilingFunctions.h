@@ -153,6 +153,71 @@ struct SimdTile <R8_UINT,R8_UINT>
     }
 };
 
+//////////////////////////////////////////////////////////////////////////
+/// SimdTile - compact unorm8 color hot tile (KNOB_COMPACT_COLOR_HOT_TILE_FORMAT)
+//////////////////////////////////////////////////////////////////////////
+template<SWR_FORMAT SrcOrDstFormat>
+struct SimdTile <R8G8B8A8_UNORM, SrcOrDstFormat>
+{
+    // SimdTile is SOA (e.g. rrrrrrrr gggggggg bbbbbbbb aaaaaaaa )
+    uint8_t color[FormatTraits<R8G8B8A8_UNORM>::numComps][KNOB_SIMD_WIDTH];
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Retrieve color from simd.
+    /// @param index - linear index to color within simd.
+    /// @param outputColor - output color
+    INLINE void GetSwizzledColor(
+        uint32_t index,
+        float outputColor[4])
+    {
+        // SOA pattern for 2x2 is a subset of 4x2.
+        //   0 1 4 5
+        //   2 3 6 7
+        // The offset converts pattern to linear
+#if (SIMD_TILE_X_DIM == 4)
+        static const uint32_t offset[] = { 0, 1, 4, 5, 2, 3, 6, 7 };
+#elif (SIMD_TILE_X_DIM == 2)
+        static const uint32_t offset[] = { 0, 1, 2, 3 };
+#endif
+
+        // same scale as LoadSOA so both paths expand to identical floats
+        for (uint32_t i = 0; i < FormatTraits<SrcOrDstFormat>::numComps; ++i)
+        {
+            uint32_t comp = FormatTraits<SrcOrDstFormat>::swizzle(i);
+            outputColor[i] = (float)this->color[comp][offset[index]] * FormatTraits<R8G8B8A8_UNORM>::toFloat(comp);
+        }
+    }
+
+    //////////////////////////////////////////////////////////////////////////
+    /// @brief Retrieve color from simd.
+    /// @param index - linear index to color within simd.
+    /// @param outputColor - output color
+    INLINE void SetSwizzledColor(
+        uint32_t index,
+        const float src[4])
+    {
+        // SOA pattern for 2x2 is a subset of 4x2.
+        //   0 1 4 5
+        //   2 3 6 7
+        // The offset converts pattern to linear
+#if (SIMD_TILE_X_DIM == 4)
+        static const uint32_t offset[] = { 0, 1, 4, 5, 2, 3, 6, 7 };
+#elif (SIMD_TILE_X_DIM == 2)
+        static const uint32_t offset[] = { 0, 1, 2, 3 };
+#endif
+
+        // Only loop over the components needed for destination.
+        // same unorm conversion as ConvertPixelFromFloat: NaN to 0, clamp,
+        // scale and round to nearest even.
+        for (uint32_t i = 0; i < FormatTraits<SrcOrDstFormat>::numComps; ++i)
+        {
+            float value = (src[i] != src[i]) ? 0.0f : src[i];
+            value = std::max(0.0f, std::min(value, 1.0f));
+            this->color[i][offset[index]] = (uint8_t)_mm_cvtss_si32(_mm_set_ss(value * FormatTraits<R8G8B8A8_UNORM>::fromFloat(i)));
+        }
+    }
+};
+
 //////////////////////////////////////////////////////////////////////////
 /// @brief Computes lod offset for 1D surface at specified lod.
 /// @param baseWidth - width of basemip (mip 0).
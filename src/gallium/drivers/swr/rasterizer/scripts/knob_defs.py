@@ -49,6 +49,14 @@ KNOBS = [
                        'defer clear execution to first backend op on hottile, or hottile store'],
     }],
 
+    ['COMPACT_COLOR_HOT_TILES', {
+        'type'      : 'bool',
+        'default'   : 'true',
+        'desc'      : ['Keep color hot tiles of unorm8 render targets as RGBA8 instead of',
+                       'RGBA32_FLOAT when the driver requests it. Cuts blend, load and store',
+                       'bandwidth for those targets by 4x.'],
+    }],
+
     ['MAX_NUMA_NODES', {
         'type'      : 'uint32_t',
         'default'   : '0',
@@ -73,6 +81,43 @@ KNOBS = [
                        '  N == Use at most N hyper-threads per physical core'],
     }],
 
+    ['DUMP_TOPOLOGY', {
+        'type'      : 'bool',
+        'default'   : 'false',
+        'desc'      : ['Print the detected NUMA node, core, L3 group and HW thread layout',
+                       'when the thread pool is created.'],
+    }],
+
+    ['NUMA_HOT_TILES', {
+        'type'      : 'bool',
+        'default'   : 'true',
+        'desc'      : ['Distribute macrotiles across the NUMA-nodes used for rendering.',
+                       'Hot tiles are allocated from the memory of the owning node and',
+                       'workers prefer macrotiles owned by their own node.'],
+    }],
+
+    ['STREAMING_BE', {
+        'type'      : 'bool',
+        'default'   : 'true',
+        'desc'      : ['Let backend workers start on macrotiles of a draw while the',
+                       'FE is still binning it instead of waiting for the FE to finish.'],
+    }],
+
+    ['DEPTH_BOUNDS_CULL', {
+        'type'      : 'bool',
+        'default'   : 'true',
+        'desc'      : ['Track the depth range of each raster tile and macrotile of the depth',
+                       'hot tiles and reject triangles that fail the depth test against it',
+                       'before rasterization and shading.'],
+    }],
+
+    ['VERTEX_CACHE', {
+        'type'      : 'bool',
+        'default'   : 'true',
+        'desc'      : ['Cache vertex shader outputs of indexed draws so that vertices',
+                       'referenced again shortly after are only shaded once.'],
+    }],
+
     ['BUCKETS_START_FRAME', {
         'type'      : 'uint32_t',
         'default'   : '1200',
@@ -159,7 +204,9 @@ KNOBS = [
         'type'      : 'uint32_t',
         'default'   : '5000',
         'desc'      : ['Number of spin-loop iterations worker threads will perform',
-                       'before going to sleep when waiting for work'],
+                       'before going to sleep when waiting for work.',
+                       'Each worker adapts this between 1/16x and 4x at runtime',
+                       'depending on how often spinning finds new work.'],
     }],
 
     ['MAX_DRAWS_IN_FLIGHT', {
@@ -208,5 +255,65 @@ KNOBS = [
        'desc'       : ['Dumps shader LLVM IR at various stages of jit compilation.'],
     }],
 
+    ['JIT_ENABLE_CACHE', {
+        'type'      : 'bool',
+        'default'   : 'true',
+        'desc'      : ['Keep compiled fetch, blend, streamout and shader functions',
+                       'in an on-disk cache so later runs can skip compiling them.'],
+    }],
+
+    ['JIT_CACHE_DIR', {
+        'type'      : 'std::string',
+        'default'   : '""',
+        'desc'      : ['Directory of the on-disk jit cache.',
+                       'Empty uses $XDG_CACHE_HOME/mesa/swr (or ~/.cache/mesa/swr).'],
+    }],
+
+    ['ASYNC_COMPILE_THREADS', {
+        'type'      : 'uint32_t',
+        'default'   : '1',
+        'desc'      : ['Number of threads jitting shaders, fetch and blend functions',
+                       'ahead of the draws that need them.',
+                       '0 compiles everything on the API thread at first use.'],
+    }],
+
+    ['JIT_VARIANT_BUDGET_MB', {
+        'type'      : 'uint32_t',
+        'default'   : '64',
+        'desc'      : ['MB of jitted code the fragment shader and blend variants of',
+                       'a context may take.  Least recently used variants are freed',
+                       'beyond it.  0 keeps every variant.'],
+    }],
+
+    ['TILED_RENDER_TARGETS', {
+        'type'      : 'bool',
+        'default'   : 'true',
+        'desc'      : ['Lay out render targets and depth buffers the driver owns as',
+                       'Y-major tiles so hot tile loads and stores touch whole 4KB',
+                       'tiles.  They are converted to linear on map and display.'],
+    }],
+
+    ['SCRATCH_CHUNK_KB', {
+        'type'      : 'uint32_t',
+        'default'   : '256',
+        'desc'      : ['KB per chunk of the scratch space client arrays and constants',
+                       'are copied to.  Larger copies get a chunk of their own.'],
+    }],
+
+    ['SCRATCH_MAX_CHUNKS', {
+        'type'      : 'uint32_t',
+        'default'   : '16',
+        'desc'      : ['Chunks of each scratch space allocated before a copy waits for',
+                       'the draws using the oldest one to finish.'],
+    }],
+
+    ['USER_BUFFERS_IN_PLACE', {
+        'type'      : 'bool',
+        'default'   : 'false',
+        'desc'      : ['Read client vertex and index arrays in place instead of copying',
+                       'them to scratch space.  Only safe if the application leaves them',
+                       'unchanged until the draws using them have finished.'],
+    }],
+
 
 ]
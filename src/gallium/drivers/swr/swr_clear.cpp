@@ -22,6 +22,7 @@
  ***************************************************************************/
 
 #include "swr_context.h"
+#include "swr_resource.h"
 #include "swr_query.h"
 
 static void
@@ -74,9 +75,11 @@ swr_clear(struct pipe_context *pipe,
    SWR_VIEWPORT vp = {0};
    vp.width = ctx->framebuffer.width;
    vp.height = ctx->framebuffer.height;
-   SwrSetViewports(ctx->swrContext, 1, &vp, NULL);
+   ctx->api.pfnSwrSetViewports(ctx->swrContext, 1, &vp, NULL);
 
-   SwrClearRenderTarget(ctx->swrContext, clearMask, color->f, depth, stencil);
+   ctx->api.pfnSwrClearRenderTarget(ctx->swrContext, clearMask, color->f, depth, stencil);
+
+   swr_mark_targets_dirty(ctx);
 }
 
 
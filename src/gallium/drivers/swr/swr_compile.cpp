@@ -0,0 +1,225 @@
+/****************************************************************************
+ * Copyright (C) 2015 Intel Corporation.   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ ***************************************************************************/
+
+#include "swr_compile.h"
+
+#include <assert.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+enum swr_compile_state {
+   SWR_COMPILE_QUEUED,
+   SWR_COMPILE_RUNNING,
+   SWR_COMPILE_DONE,
+   SWR_COMPILE_CANCELLED,
+};
+
+struct swr_compile_job {
+   swr_compile_func compile;
+   swr_compile_state state;
+   void *func;
+   HANDLE jit_mgr; /* that compiled func */
+};
+
+struct swr_compile_queue {
+   std::mutex mutex;
+   std::condition_variable work_cv; /* a job was queued, or shutdown */
+   std::condition_variable done_cv; /* a job finished */
+
+   /* Jobs taken by swr_compile_finish/cancel stay here until a thread
+    * pops and skips them */
+   std::deque<std::shared_ptr<swr_compile_job>> jobs;
+   bool shutdown;
+
+   std::vector<std::thread> threads;
+   std::vector<HANDLE> jit_mgrs;
+};
+
+/* Runs a job the caller has moved to SWR_COMPILE_RUNNING */
+static void
+swr_compile_run(struct swr_compile_queue *queue,
+                std::unique_lock<std::mutex> &lock,
+                swr_compile_job *job,
+                HANDLE hJitMgr)
+{
+   lock.unlock();
+   void *func = job->compile(hJitMgr);
+   lock.lock();
+
+   job->func = func;
+   job->jit_mgr = hJitMgr;
+   job->compile = nullptr;
+   job->state = SWR_COMPILE_DONE;
+   queue->done_cv.notify_all();
+}
+
+static void
+swr_compile_thread(struct swr_compile_queue *queue, HANDLE hJitMgr)
+{
+   std::unique_lock<std::mutex> lock(queue->mutex);
+
+   for (;;) {
+      queue->work_cv.wait(lock, [queue] {
+         return queue->shutdown || !queue->jobs.empty();
+      });
+      if (queue->shutdown)
+         break;
+
+      std::shared_ptr<swr_compile_job> job = queue->jobs.front();
+      queue->jobs.pop_front();
+      if (job->state != SWR_COMPILE_QUEUED)
+         continue;
+
+      job->state = SWR_COMPILE_RUNNING;
+      swr_compile_run(queue, lock, job.get(), hJitMgr);
+   }
+}
+
+struct swr_compile_queue *
+swr_compile_queue_create(unsigned num_threads,
+                         uint32_t simd_width,
+                         const char *arch)
+{
+   if (!num_threads)
+      return NULL;
+
+   struct swr_compile_queue *queue = new swr_compile_queue;
+   queue->shutdown = false;
+
+   /* JitManagers are created here; only their thread uses them after */
+   for (unsigned i = 0; i < num_threads; i++)
+      queue->jit_mgrs.push_back(JitCreateContext(simd_width, arch));
+
+   for (HANDLE hJitMgr : queue->jit_mgrs)
+      queue->threads.push_back(std::thread(swr_compile_thread, queue, hJitMgr));
+
+   return queue;
+}
+
+void
+swr_compile_queue_destroy(struct swr_compile_queue *queue,
+                          JIT_CACHE_STATS &cache_stats,
+                          JIT_CODE_STATS &code_stats)
+{
+   if (!queue)
+      return;
+
+   {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      queue->shutdown = true;
+      queue->jobs.clear();
+   }
+   queue->work_cv.notify_all();
+
+   for (std::thread &thread : queue->threads)
+      thread.join();
+
+   for (HANDLE hJitMgr : queue->jit_mgrs) {
+      JIT_CACHE_STATS stats;
+      JitGetCacheStats(hJitMgr, stats);
+      cache_stats.numHits += stats.numHits;
+      cache_stats.numMisses += stats.numMisses;
+
+      JIT_CODE_STATS code;
+      JitGetCodeStats(hJitMgr, code);
+      code_stats.numFunctions += code.numFunctions;
+      code_stats.codeSize += code.codeSize;
+      code_stats.numFreed += code.numFreed;
+
+      JitDestroyContext(hJitMgr);
+   }
+
+   delete queue;
+}
+
+std::shared_ptr<swr_compile_job>
+swr_compile_submit(struct swr_compile_queue *queue, swr_compile_func compile)
+{
+   if (!queue)
+      return nullptr;
+
+   std::shared_ptr<swr_compile_job> job = std::make_shared<swr_compile_job>();
+   job->compile = std::move(compile);
+   job->state = SWR_COMPILE_QUEUED;
+   job->func = NULL;
+   job->jit_mgr = NULL;
+
+   {
+      std::lock_guard<std::mutex> lock(queue->mutex);
+      queue->jobs.push_back(job);
+   }
+   queue->work_cv.notify_one();
+
+   return job;
+}
+
+void *
+swr_compile_finish(struct swr_compile_queue *queue,
+                   std::shared_ptr<swr_compile_job> &job,
+                   HANDLE hJitMgr,
+                   HANDLE &owner)
+{
+   std::unique_lock<std::mutex> lock(queue->mutex);
+
+   assert(job->state != SWR_COMPILE_CANCELLED);
+   if (job->state == SWR_COMPILE_QUEUED) {
+      job->state = SWR_COMPILE_RUNNING;
+      swr_compile_run(queue, lock, job.get(), hJitMgr);
+   } else {
+      queue->done_cv.wait(lock, [&job] {
+         return job->state == SWR_COMPILE_DONE;
+      });
+   }
+
+   void *func = job->func;
+   owner = job->jit_mgr;
+   job.reset();
+   return func;
+}
+
+void
+swr_compile_cancel(struct swr_compile_queue *queue,
+                   std::shared_ptr<swr_compile_job> &job)
+{
+   if (!job)
+      return;
+
+   std::unique_lock<std::mutex> lock(queue->mutex);
+
+   if (job->state == SWR_COMPILE_QUEUED) {
+      job->state = SWR_COMPILE_CANCELLED;
+      job->compile = nullptr;
+   } else {
+      /* The compile may still be reading the shader being deleted */
+      queue->done_cv.wait(lock, [&job] {
+         return job->state != SWR_COMPILE_RUNNING;
+      });
+      if (job->func)
+         JitFreeFunction(job->jit_mgr, job->func);
+   }
+
+   job.reset();
+}
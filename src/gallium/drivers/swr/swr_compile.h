@@ -0,0 +1,97 @@
+/****************************************************************************
+ * Copyright (C) 2015 Intel Corporation.   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ ***************************************************************************/
+
+#ifndef SWR_COMPILE_H
+#define SWR_COMPILE_H
+
+#include "jit_api.h"
+
+#include <functional>
+#include <memory>
+
+/*
+ * Background compilation of jitted functions.  Each compile thread owns a
+ * JitManager, since LLVM contexts can't be shared between threads.
+ */
+
+struct swr_compile_queue;
+struct swr_compile_job;
+
+/* Builds one function with the given JitManager and returns it */
+typedef std::function<void *(HANDLE hJitMgr)> swr_compile_func;
+
+/* Returns NULL for num_threads == 0; everything is compiled on demand */
+struct swr_compile_queue *
+swr_compile_queue_create(unsigned num_threads,
+                         uint32_t simd_width,
+                         const char *arch);
+
+/* Drops queued jobs and adds the threads' jit cache and code stats */
+void
+swr_compile_queue_destroy(struct swr_compile_queue *queue,
+                          JIT_CACHE_STATS &cache_stats,
+                          JIT_CODE_STATS &code_stats);
+
+/* Returns NULL if there's no queue; the caller compiles on demand */
+std::shared_ptr<swr_compile_job>
+swr_compile_submit(struct swr_compile_queue *queue, swr_compile_func compile);
+
+/*
+ * Returns the compiled function and releases the job.  A job no thread has
+ * started yet is compiled right here with hJitMgr instead of waiting for
+ * the ones queued ahead of it.  owner is set to the JitManager holding the
+ * function's code.
+ */
+void *
+swr_compile_finish(struct swr_compile_queue *queue,
+                   std::shared_ptr<swr_compile_job> &job,
+                   HANDLE hJitMgr,
+                   HANDLE &owner);
+
+/*
+ * Releases a job whose result isn't needed; waits if it's compiling.  A
+ * function it already compiled is freed, nothing can be using it.
+ */
+void
+swr_compile_cancel(struct swr_compile_queue *queue,
+                   std::shared_ptr<swr_compile_job> &job);
+
+/* A jitted function that may still be compiling */
+struct swr_jit_func {
+   void *func;
+   HANDLE jit_mgr; /* JitManager holding func's code */
+   std::shared_ptr<swr_compile_job> job;
+};
+
+static inline void *
+swr_jit_func_get(struct swr_compile_queue *queue,
+                 swr_jit_func &jit_func,
+                 HANDLE hJitMgr)
+{
+   if (jit_func.job)
+      jit_func.func = swr_compile_finish(queue, jit_func.job, hJitMgr,
+                                         jit_func.jit_mgr);
+   return jit_func.func;
+}
+
+#endif
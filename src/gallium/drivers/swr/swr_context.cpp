@@ -34,6 +34,7 @@ extern "C" {
 #include "swr_memory.h"
 #include "swr_screen.h"
 #include "swr_resource.h"
+#include "swr_fence.h"
 #include "swr_scratch.h"
 #include "swr_query.h"
 
@@ -84,32 +85,18 @@ swr_surface_destroy(struct pipe_context *pipe, struct pipe_surface *surf)
    assert(surf->texture);
    struct pipe_resource *resource = surf->texture;
 
-   /* If the surface being destroyed is a current render target,
-    * call StoreTiles to resolve the hotTile state then set attachment
-    * to NULL.
+   /* If the surface being destroyed is a current render target, store
+    * anything rendered into it and detach it.  Nothing waits here; freeing
+    * the resource waits on its write fence.
     */
-   if (resource->bind & (PIPE_BIND_RENDER_TARGET | PIPE_BIND_DEPTH_STENCIL
-                         | PIPE_BIND_DISPLAY_TARGET)) {
+   struct swr_resource *spr = swr_resource(resource);
+   if (spr->write_fence) {
       struct swr_context *ctx = swr_context(pipe);
-      struct swr_resource *spr = swr_resource(resource);
+      swr_store_dirty_resource(ctx, spr, SWR_TILE_RESOLVED);
       for (uint32_t i = 0; i < SWR_NUM_ATTACHMENTS; i++)
-         if (ctx->current.attachment[i] == &spr->swr) {
-            swr_store_render_target(ctx, i, SWR_TILE_RESOLVED);
+         if (ctx->current.attachment_res[i] == spr) {
             ctx->current.attachment[i] = nullptr;
-            /*
-             * Mesa thinks depth/stencil are fused, so we'll never get an
-             * explicit resource for stencil.  So, if checking depth, then
-             * also
-             * check for stencil.
-             */
-            if (spr->has_stencil && (i == SWR_ATTACHMENT_DEPTH)) {
-               swr_store_render_target(
-                  ctx, SWR_ATTACHMENT_STENCIL, SWR_TILE_RESOLVED);
-               ctx->current.attachment[SWR_ATTACHMENT_STENCIL] = nullptr;
-            }
-
-            SwrWaitForIdle(ctx->swrContext);
-            break;
+            ctx->current.attachment_res[i] = nullptr;
          }
    }
 
@@ -134,36 +121,69 @@ swr_transfer_map(struct pipe_context *pipe,
    assert(level <= resource->last_level);
 
    /*
-    * If mapping any attached rendertarget, store tiles and wait for idle
-    * before giving CPU access to the surface.
-    * (set postStoreTileState to SWR_TILE_INVALID so tiles are reloaded)
+    * Rendering into a render target sits in the hot tiles until stored.
+    * Store them if anything was drawn since the last store, then wait on
+    * the resource's write fence, which only covers the draws queued before
+    * that store.  Writes drop the hot tiles so the next draw reloads them.
+    * Unsynchronized maps don't wait, and maps discarding the whole resource
+    * drop the hot tiles rather than storing them.
     */
-   if (resource->bind & (PIPE_BIND_RENDER_TARGET | PIPE_BIND_DEPTH_STENCIL
-                         | PIPE_BIND_DISPLAY_TARGET)) {
+   if (spr->write_fence && !(usage & PIPE_TRANSFER_UNSYNCHRONIZED)) {
       struct swr_context *ctx = swr_context(pipe);
-      for (uint32_t i = 0; i < SWR_NUM_ATTACHMENTS; i++)
-         if (ctx->current.attachment[i] == &spr->swr) {
-            swr_store_render_target(ctx, i, SWR_TILE_INVALID);
-            /*
-             * Mesa thinks depth/stencil are fused, so we'll never get an
-             * explicit map for stencil.  So, if mapping depth, then also
-             * store tile for stencil.
-             */
-            if (spr->has_stencil && (i == SWR_ATTACHMENT_DEPTH))
-               swr_store_render_target(
-                  ctx, SWR_ATTACHMENT_STENCIL, SWR_TILE_INVALID);
-            SwrWaitForIdle(ctx->swrContext);
-            break;
-         }
+      if (usage & PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE)
+         swr_invalidate_resource(ctx, spr);
+      else if (!(usage & PIPE_TRANSFER_WRITE))
+         swr_store_dirty_resource(ctx, spr, SWR_TILE_RESOLVED);
+      else if (spr->tiles_dirty)
+         swr_store_dirty_resource(ctx, spr, SWR_TILE_INVALID);
+      else
+         swr_invalidate_resource(ctx, spr);
+
+      /* Only stores queued earlier can still be writing the surface */
+      swr_fence_finish(pipe->screen, spr->write_fence, 0);
    }
 
-
-   pt = CALLOC_STRUCT(pipe_transfer);
-   if (!pt)
+   struct swr_transfer *st = CALLOC_STRUCT(swr_transfer);
+   if (!st)
       return NULL;
+   pt = &st->base;
    pipe_resource_reference(&pt->resource, resource);
    pt->level = level;
+   pt->usage = usage;
    pt->box = *box;
+
+   if (swr_resource_is_tiled(spr)) {
+      /* Hand out a linear copy of just the mapped box */
+      pt->stride = box->width * GetFormatInfo(spr->swr.format).Bpp;
+      pt->layer_stride = pt->stride * box->height;
+      st->staging = _aligned_malloc(pt->layer_stride, 64);
+      if (!st->staging) {
+         pipe_resource_reference(&pt->resource, NULL);
+         FREE(st);
+         return NULL;
+      }
+
+      if (!(usage & (PIPE_TRANSFER_DISCARD_RANGE
+                     | PIPE_TRANSFER_DISCARD_WHOLE_RESOURCE))) {
+         swr_tiled_copy(spr, box, st->staging, pt->stride, true);
+
+         if (spr->base.format == PIPE_FORMAT_Z24_UNORM_S8_UINT
+             && spr->has_stencil) {
+            BYTE *stencil = spr->secondary.pBaseAddress
+               + box->y * spr->secondary.pitch + box->x;
+            for (int y = 0; y < box->height; y++) {
+               BYTE *zs = (BYTE *)st->staging + y * pt->stride;
+               for (int x = 0; x < box->width; x++)
+                  zs[4 * x + 3] = stencil[x];
+               stencil += spr->secondary.pitch;
+            }
+         }
+      }
+
+      *transfer = pt;
+      return st->staging;
+   }
+
    pt->stride = spr->row_stride[level];
    pt->layer_stride = spr->img_stride[level];
 
@@ -198,16 +218,37 @@ swr_transfer_unmap(struct pipe_context *pipe, struct pipe_transfer *transfer)
    struct swr_resource *res = swr_resource(transfer->resource);
    res->bound_to_context = (void *)pipe;
 
-   /* if we're mapping the depth/stencil, copy out stencil */
-   if (res->base.format == PIPE_FORMAT_Z24_UNORM_S8_UINT
-       && res->has_stencil) {
+   struct swr_transfer *st = (struct swr_transfer *)transfer;
+   if (st->staging) {
+      /* Write the linear copy back into the tiles */
+      if (transfer->usage & PIPE_TRANSFER_WRITE) {
+         const struct pipe_box *box = &transfer->box;
+
+         if (res->base.format == PIPE_FORMAT_Z24_UNORM_S8_UINT
+             && res->has_stencil) {
+            BYTE *stencil = res->secondary.pBaseAddress
+               + box->y * res->secondary.pitch + box->x;
+            for (int y = 0; y < box->height; y++) {
+               BYTE *zs = (BYTE *)st->staging + y * transfer->stride;
+               for (int x = 0; x < box->width; x++)
+                  stencil[x] = zs[4 * x + 3];
+               stencil += res->secondary.pitch;
+            }
+         }
+
+         swr_tiled_copy(res, box, st->staging, transfer->stride, false);
+      }
+      _aligned_free(st->staging);
+   } else if (res->base.format == PIPE_FORMAT_Z24_UNORM_S8_UINT
+              && res->has_stencil) {
+      /* if we're mapping the depth/stencil, copy out stencil */
       for (unsigned i = 0; i < res->alignedWidth * res->alignedHeight; i++) {
          res->secondary.pBaseAddress[i] = res->swr.pBaseAddress[4 * i + 3];
       }
    }
 
    pipe_resource_reference(&transfer->resource, NULL);
-   FREE(transfer);
+   FREE(st);
 }
 
 
@@ -265,6 +306,36 @@ swr_blit(struct pipe_context *pipe, const struct pipe_blit_info *blit_info)
       return;
    }
 
+   /* The samplers only read linear surfaces, so blit a tiled source from a
+    * linear copy of the box */
+   struct pipe_resource *staging = NULL;
+   if (swr_resource_is_tiled(swr_resource(info.src.resource))) {
+      struct pipe_box box = info.src.box;
+      if (box.width < 0) {
+         box.x += box.width;
+         box.width = -box.width;
+      }
+      if (box.height < 0) {
+         box.y += box.height;
+         box.height = -box.height;
+      }
+
+      struct pipe_resource templ = *info.src.resource;
+      templ.width0 = box.width;
+      templ.height0 = box.height;
+      templ.bind = PIPE_BIND_SAMPLER_VIEW;
+      staging = pipe->screen->resource_create(pipe->screen, &templ);
+      if (!staging)
+         return;
+      pipe->resource_copy_region(
+         pipe, staging, 0, 0, 0, 0, info.src.resource, info.src.level, &box);
+
+      info.src.resource = staging;
+      info.src.level = 0;
+      info.src.box.x -= box.x;
+      info.src.box.y -= box.y;
+   }
+
    /* XXX turn off occlusion and streamout queries */
 
    util_blitter_save_vertex_buffer_slot(ctx->blitter, ctx->vertex_buffer);
@@ -299,6 +370,8 @@ swr_blit(struct pipe_context *pipe, const struct pipe_blit_info *blit_info)
                                       ctx->render_cond_mode);
 
    util_blitter_blit(ctx->blitter, &info);
+
+   pipe_resource_reference(&staging, NULL);
 }
 
 
@@ -311,10 +384,13 @@ swr_destroy(struct pipe_context *pipe)
       util_blitter_destroy(ctx->blitter);
 
    if (ctx->swrContext)
-      SwrDestroyContext(ctx->swrContext);
+      ctx->api.pfnSwrDestroyContext(ctx->swrContext);
 
+   /* Nothing runs jitted code anymore, free it all */
+   swr_variant_cache_destroy(ctx);
    delete ctx->blendJIT;
 
+   pipe_resource_reference(&ctx->index_buffer.buffer, NULL);
    swr_destroy_scratch_buffers(ctx);
 
    FREE(ctx);
@@ -339,8 +415,10 @@ struct pipe_context *
 swr_create_context(struct pipe_screen *screen, void *priv)
 {
    struct swr_context *ctx = CALLOC_STRUCT(swr_context);
+   ctx->api = swr_screen(screen)->api;
    ctx->blendJIT =
-      new std::unordered_map<BLEND_COMPILE_STATE, PFN_BLEND_JIT_FUNC>;
+      new std::unordered_map<BLEND_COMPILE_STATE, swr_variant *>;
+   swr_variant_cache_init(ctx);
 
    SWR_CREATECONTEXT_INFO createInfo;
    createInfo.driver = GL;
@@ -348,14 +426,20 @@ swr_create_context(struct pipe_screen *screen, void *priv)
    createInfo.pfnLoadTile = swr_LoadHotTile;
    createInfo.pfnStoreTile = swr_StoreHotTile;
    createInfo.pfnClearTile = swr_StoreHotTileClear;
-   ctx->swrContext = SwrCreateContext(&createInfo);
+   createInfo.maxDrawsInFlight = 0; /* core default */
+   ctx->swrContext = ctx->api.pfnSwrCreateContext(&createInfo);
 
    /* Init Load/Store/ClearTiles Tables */
-   swr_InitMemoryModule();
+   swr_InitMemoryModule(&ctx->api);
 
    if (ctx->swrContext == NULL)
       goto fail;
 
+   /* The tile callbacks reach the core through the private state, which
+    * is carried over from draw to draw */
+   ((swr_draw_context *)ctx->api.pfnSwrGetPrivateContextState(
+      ctx->swrContext))->pAPI = &ctx->api;
+
    ctx->pipe.screen = screen;
    ctx->pipe.destroy = swr_destroy;
    ctx->pipe.priv = priv;
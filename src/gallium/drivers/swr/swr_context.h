@@ -28,7 +28,9 @@
 #include "pipe/p_state.h"
 #include "util/u_blitter.h"
 #include "jit_api.h"
+#include "api.h"
 #include "swr_state.h"
+#include "swr_variant.h"
 #include <unordered_map>
 
 #define SWR_NEW_BLEND (1 << 0)
@@ -63,6 +65,7 @@ struct swr_context {
    struct pipe_context pipe; /**< base class */
 
    HANDLE swrContext;
+   SWR_INTERFACE api; /* core entry points, copied from the screen */
 
    /** Constant state objects */
    struct swr_blend_state *blend;
@@ -112,7 +115,10 @@ struct swr_context {
    struct swr_scratch_buffers *scratch;
 
    // blend jit functions
-   std::unordered_map<BLEND_COMPILE_STATE, PFN_BLEND_JIT_FUNC> *blendJIT;
+   std::unordered_map<BLEND_COMPILE_STATE, swr_variant *> *blendJIT;
+
+   /* LRU of FS and blend variants, retired jit functions */
+   struct swr_variant_cache *variants;
 
    /* Shadows of current SWR API DrawState */
    struct swr_shadow_state current;
@@ -151,6 +157,8 @@ struct swr_draw_context {
    swr_jit_sampler samplersFS[PIPE_MAX_SAMPLERS];
 
    SWR_SURFACE_STATE renderTargets[SWR_NUM_ATTACHMENTS];
+
+   SWR_INTERFACE *pAPI; /* core entry points, for the tile callbacks */
 };
 
 
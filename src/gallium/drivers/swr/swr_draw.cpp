@@ -136,7 +136,7 @@ swr_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
          assert(ctx->vs->soFunc[info->mode] && "Error: SoShader = NULL");
       }
 
-      SwrSetSoFunc(ctx->swrContext, ctx->vs->soFunc[info->mode], 0);
+      ctx->api.pfnSwrSetSoFunc(ctx->swrContext, ctx->vs->soFunc[info->mode], 0);
    }
 
    struct swr_vertex_element_state *velems = ctx->velems;
@@ -147,18 +147,28 @@ swr_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
       velems->fsState.cutIndex = info->restart_index;
       velems->fsState.bEnableCutIndex = info->primitive_restart;
 
-      /* Create Fetch Shader */
-      HANDLE hJitMgr = swr_screen(ctx->pipe.screen)->hJitMgr;
-      velems->fsFunc = JitCompileFetch(hJitMgr, velems->fsState);
+      /* Create Fetch Shader, unless it was compiled ahead */
+      struct swr_screen *screen = swr_screen(ctx->pipe.screen);
+      if (velems->fsState == velems->precompileState
+          && (velems->precompiled.func || velems->precompiled.job)) {
+         velems->fsFunc = (PFN_FETCH_FUNC)swr_jit_func_get(
+            screen->compile_queue, velems->precompiled, screen->hJitMgr);
+      } else {
+         swr_jit_retire(ctx, velems->fetch);
+         velems->fetch.func =
+            (void *)JitCompileFetch(screen->hJitMgr, velems->fsState);
+         velems->fetch.jit_mgr = screen->hJitMgr;
+         velems->fsFunc = (PFN_FETCH_FUNC)velems->fetch.func;
+      }
 
       debug_printf("fetch shader %p\n", velems->fsFunc);
       assert(velems->fsFunc && "Error: FetchShader = NULL");
    }
 
-   SwrSetFetchFunc(ctx->swrContext, velems->fsFunc);
+   ctx->api.pfnSwrSetFetchFunc(ctx->swrContext, velems->fsFunc);
 
    if (info->indexed)
-      SwrDrawIndexedInstanced(ctx->swrContext,
+      ctx->api.pfnSwrDrawIndexedInstanced(ctx->swrContext,
                               swr_convert_prim_topology(info->mode),
                               info->count,
                               info->instance_count,
@@ -166,12 +176,14 @@ swr_draw_vbo(struct pipe_context *pipe, const struct pipe_draw_info *info)
                               info->index_bias,
                               info->start_instance);
    else
-      SwrDrawInstanced(ctx->swrContext,
+      ctx->api.pfnSwrDrawInstanced(ctx->swrContext,
                        swr_convert_prim_topology(info->mode),
                        info->count,
                        info->instance_count,
                        info->start,
                        info->start_instance);
+
+   swr_mark_targets_dirty(ctx);
 }
 
 
@@ -189,7 +201,8 @@ swr_flush(struct pipe_context *pipe,
     */
    struct pipe_surface *cb = ctx->framebuffer.cbufs[0];
    if (cb && swr_resource(cb->texture)->display_target)
-      swr_store_render_target(ctx, SWR_ATTACHMENT_COLOR0, SWR_TILE_RESOLVED);
+      swr_store_dirty_resource(
+         ctx, swr_resource(cb->texture), SWR_TILE_RESOLVED);
 
    // SwrStoreTiles is asynchronous, always submit the "flush" fence.
    // flush_frontbuffer needs it.
@@ -197,6 +210,9 @@ swr_flush(struct pipe_context *pipe,
 
    if (fence)
       swr_fence_reference(pipe->screen, fence, screen->flush_fence);
+
+   /* Draws only reap retired jit code on state changes; flushes too */
+   swr_jit_reap(ctx);
 }
 
 void
@@ -221,7 +237,7 @@ swr_store_render_target(struct swr_context *ctx,
                         struct SWR_SURFACE_STATE *surface)
 {
    struct swr_draw_context *pDC =
-      (swr_draw_context *)SwrGetPrivateContextState(ctx->swrContext);
+      (swr_draw_context *)ctx->api.pfnSwrGetPrivateContextState(ctx->swrContext);
    struct SWR_SURFACE_STATE *renderTarget = &pDC->renderTargets[attachment];
 
    /* If the passed in surface isn't already attached, it will be attached and
@@ -241,25 +257,25 @@ swr_store_render_target(struct swr_context *ctx,
          SWR_VIEWPORT vp = {0};
          vp.width = renderTarget->width;
          vp.height = renderTarget->height;
-         SwrSetViewports(ctx->swrContext, 1, &vp, NULL);
+         ctx->api.pfnSwrSetViewports(ctx->swrContext, 1, &vp, NULL);
       }
 
       boolean scissor_enable = ctx->current.rastState.scissorEnable;
       if (scissor_enable) {
          ctx->current.rastState.scissorEnable = FALSE;
-         SwrSetRastState(ctx->swrContext, &ctx->current.rastState);
+         ctx->api.pfnSwrSetRastState(ctx->swrContext, &ctx->current.rastState);
       }
 
-      SwrStoreTiles(ctx->swrContext,
+      ctx->api.pfnSwrStoreTiles(ctx->swrContext,
                     (enum SWR_RENDERTARGET_ATTACHMENT)attachment,
                     post_tile_state);
 
       /* Restore viewport and scissor enable */
       if (change_viewport)
-         SwrSetViewports(ctx->swrContext, 1, &ctx->current.vp, &ctx->current.vpm);
+         ctx->api.pfnSwrSetViewports(ctx->swrContext, 1, &ctx->current.vp, &ctx->current.vpm);
       if (scissor_enable) {
          ctx->current.rastState.scissorEnable = scissor_enable;
-         SwrSetRastState(ctx->swrContext, &ctx->current.rastState);
+         ctx->api.pfnSwrSetRastState(ctx->swrContext, &ctx->current.rastState);
       }
 
       /* Restore surface attachment, if changed */
@@ -268,6 +284,63 @@ swr_store_render_target(struct swr_context *ctx,
    }
 }
 
+/*
+ * Store the hot tiles of every attachment backed by res, if anything was
+ * drawn to it since the last store, and submit its write fence behind them.
+ * Waiting on that fence only waits for the draws queued before the store.
+ */
+void
+swr_store_dirty_resource(struct swr_context *ctx,
+                         struct swr_resource *res,
+                         enum SWR_TILE_STATE post_tile_state)
+{
+   boolean stored = FALSE;
+
+   if (!res->tiles_dirty)
+      return;
+
+   for (uint32_t i = 0; i < SWR_NUM_ATTACHMENTS; i++)
+      if (ctx->current.attachment_res[i] == res) {
+         swr_store_render_target(ctx, i, post_tile_state);
+         stored = TRUE;
+      }
+
+   if (stored) {
+      swr_fence_submit(ctx, res->write_fence);
+      res->tiles_dirty = false;
+   }
+}
+
+/*
+ * Drop the hot tiles of every attachment backed by res, without storing
+ * them, so the next draw reloads them from the surface.
+ */
+void
+swr_invalidate_resource(struct swr_context *ctx, struct swr_resource *res)
+{
+   uint32_t mask = 0;
+
+   for (uint32_t i = 0; i < SWR_NUM_ATTACHMENTS; i++)
+      if (ctx->current.attachment_res[i] == res)
+         mask |= 1 << i;
+
+   if (mask) {
+      ctx->api.pfnSwrInvalidateTiles(ctx->swrContext, mask);
+      res->tiles_dirty = false;
+   }
+}
+
+/*
+ * Note that the attached render targets hold rendering not yet stored.
+ */
+void
+swr_mark_targets_dirty(struct swr_context *ctx)
+{
+   for (uint32_t i = 0; i < SWR_NUM_ATTACHMENTS; i++)
+      if (ctx->current.attachment_res[i])
+         ctx->current.attachment_res[i]->tiles_dirty = true;
+}
+
 
 void
 swr_draw_init(struct pipe_context *pipe)
@@ -32,14 +32,15 @@
 
 /*
  * Fence callback, called by back-end thread on completion of all rendering up
- * to SwrSync call.
+ * to SwrSync call.  userData2 is the write count of that submit, so a fence
+ * submitted again since isn't marked done early.
  */
 static void
 swr_sync_cb(UINT64 userData, UINT64 userData2)
 {
    struct swr_fence *fence = (struct swr_fence *)userData;
 
-   fence->read = fence->write;
+   fence->read = userData2;
 }
 
 /*
@@ -51,7 +52,8 @@ swr_fence_submit(struct swr_context *ctx, struct pipe_fence_handle *fh)
    struct swr_fence *fence = swr_fence(fh);
 
    fence->write++;
-   SwrSync(ctx->swrContext, swr_sync_cb, (UINT64)fence, 0);
+   ctx->api.pfnSwrSync(
+      ctx->swrContext, swr_sync_cb, (UINT64)fence, fence->write);
 }
 
 /*
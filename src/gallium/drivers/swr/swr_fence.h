@@ -33,7 +33,7 @@ struct pipe_screen;
 struct swr_fence {
    struct pipe_reference reference;
 
-   uint64_t read;
+   volatile uint64_t read; /* written by the sync callback */
    uint64_t write;
 
    unsigned id; /* Just for reference */
@@ -0,0 +1,113 @@
+/****************************************************************************
+ * Copyright (C) 2015 Intel Corporation.   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ ***************************************************************************/
+
+#include "util/u_cpu_detect.h"
+#include "util/u_dl.h"
+#include "util/macros.h"
+
+#include "swr_screen.h"
+
+#include <stdio.h>
+#include <strings.h>
+
+/*
+ * The core is built once per ISA into its own library. Pick the best one
+ * this processor can run, unless RASTY_KNOB_ARCH_STR asks for a lower one.
+ */
+struct swr_core_build {
+   const char *arch; /* KNOB_ARCH_STR of the build */
+   const char *library;
+   bool supported;
+};
+
+struct util_dl_library *
+swr_load_core(SWR_INTERFACE *api)
+{
+   util_cpu_detect();
+
+   /* Exit gracefully if there is no AVX support */
+   if (!util_cpu_caps.has_avx) {
+      fprintf(stderr, " !!! This processor does not support AVX or AVX2.  "
+                      "OpenSWR requires AVX.\n");
+      exit(-1);
+   }
+
+   /* Best first */
+   const swr_core_build builds[] = {
+      {"AVX2", UTIL_DL_PREFIX "swrAVX2" UTIL_DL_EXT,
+       util_cpu_caps.has_avx2 != 0},
+      {"AVX", UTIL_DL_PREFIX "swrAVX" UTIL_DL_EXT,
+       util_cpu_caps.has_avx != 0},
+   };
+
+   unsigned first = 0;
+   const char *requested = getenv("RASTY_KNOB_ARCH_STR");
+   if (requested) {
+      first = ARRAY_SIZE(builds);
+      for (unsigned i = 0; i < ARRAY_SIZE(builds); i++) {
+         if (!strcasecmp(requested, builds[i].arch)) {
+            first = i;
+            break;
+         }
+      }
+      if (first == ARRAY_SIZE(builds)) {
+         fprintf(stderr, "SWR: unknown RASTY_KNOB_ARCH_STR %s, ignored.\n",
+                 requested);
+         first = 0;
+      } else if (!builds[first].supported) {
+         fprintf(stderr, "SWR: this processor can't run the %s core.\n",
+                 builds[first].arch);
+      }
+   }
+
+   /* Fall back to lower builds if one isn't installed */
+   for (unsigned i = first; i < ARRAY_SIZE(builds); i++) {
+      if (!builds[i].supported)
+         continue;
+
+      struct util_dl_library *library = util_dl_open(builds[i].library);
+      if (!library) {
+         fprintf(stderr, "SWR: unable to load %s: %s\n",
+                 builds[i].library, util_dl_error());
+         continue;
+      }
+
+      PFN_SWR_GET_INTERFACE pfnSwrGetInterface =
+         (PFN_SWR_GET_INTERFACE)util_dl_get_proc_address(library,
+                                                         "SwrGetInterface");
+      if (!pfnSwrGetInterface) {
+         fprintf(stderr, "SWR: %s has no SwrGetInterface.\n",
+                 builds[i].library);
+         util_dl_close(library);
+         continue;
+      }
+
+      pfnSwrGetInterface(*api);
+      fprintf(stderr, "SWR: using the %s core from %s.\n",
+              api->pArchStr, builds[i].library);
+      return library;
+   }
+
+   fprintf(stderr, " !!! No OpenSWR core library could be loaded.\n");
+   return NULL;
+}
@@ -50,6 +50,11 @@ swr_create_query(struct pipe_context *pipe, unsigned type, unsigned index)
    if (pq) {
       pq->type = type;
       pq->index = index;
+      pq->fence = swr_fence_create();
+      if (!pq->fence) {
+         FREE(pq);
+         return NULL;
+      }
    }
 
    return (struct pipe_query *)pq;
@@ -61,112 +66,111 @@ swr_destroy_query(struct pipe_context *pipe, struct pipe_query *q)
 {
    struct swr_query *pq = swr_query(q);
 
-   if (pq->fence) {
-      if (!swr_is_fence_done(swr_fence(pq->fence))) {
-         swr_fence_submit(swr_context(pipe), pq->fence);
-         swr_fence_finish(pipe->screen, pq->fence, 0);
-      }
-      swr_fence_reference(pipe->screen, &pq->fence, NULL);
-   }
+   /* The backend may still write the snapshots, wait for it */
+   if (pq->stats_pending)
+      swr_fence_submit(swr_context(pipe), pq->fence);
+   swr_fence_finish(pipe->screen, pq->fence, 0);
+   swr_fence_reference(pipe->screen, &pq->fence, NULL);
 
    FREE(pq);
 }
 
 
-// XXX Create a fence callback, rather than stalling SwrWaitForIdle
-static void
-swr_gather_stats(struct pipe_context *pipe, struct swr_query *pq)
+/*
+ * Queries whose results come from the SwrCore counters
+ */
+static boolean
+swr_query_needs_stats(unsigned type)
 {
-   struct swr_context *ctx = swr_context(pipe);
+   switch (type) {
+   case PIPE_QUERY_OCCLUSION_PREDICATE:
+   case PIPE_QUERY_OCCLUSION_COUNTER:
+   case PIPE_QUERY_PRIMITIVES_GENERATED:
+   case PIPE_QUERY_PRIMITIVES_EMITTED:
+   case PIPE_QUERY_SO_STATISTICS:
+   case PIPE_QUERY_SO_OVERFLOW_PREDICATE:
+   case PIPE_QUERY_PIPELINE_STATISTICS:
+      return TRUE;
+   default:
+      return FALSE;
+   }
+}
 
-   assert(pq->result);
-   union pipe_query_result *result = pq->result;
-   boolean enable_stats = pq->enable_stats;
-   SWR_STATS swr_stats = {0};
 
-   if (pq->fence) {
-      if (!swr_is_fence_done(swr_fence(pq->fence))) {
-         swr_fence_submit(ctx, pq->fence);
-         swr_fence_finish(pipe->screen, pq->fence, 0);
-      }
-      swr_fence_reference(pipe->screen, &pq->fence, NULL);
-   }
+/*
+ * Record start or end values.  Counter snapshots are queued to the backend
+ * as QUERYSTATS work and land once every earlier draw has finished; nothing
+ * here waits for them.
+ */
+static void
+swr_gather_stats(struct pipe_context *pipe,
+                 struct swr_query *pq,
+                 union pipe_query_result *result,
+                 SWR_STATS *swr_stats)
+{
+   struct swr_context *ctx = swr_context(pipe);
 
-   /*
-    * These queries don't need SWR Stats enabled in the core
-    * Set and return.
-    */
    switch (pq->type) {
    case PIPE_QUERY_TIMESTAMP:
    case PIPE_QUERY_TIME_ELAPSED:
       result->u64 = swr_get_timestamp(pipe->screen);
-      return;
-      break;
-   case PIPE_QUERY_TIMESTAMP_DISJOINT:
-      /* nothing to do here */
-      return;
-      break;
-   case PIPE_QUERY_GPU_FINISHED:
-      result->b = TRUE; /* XXX TODO Add an api func to SWR to compare drawId
-                           vs LastRetiredId? */
-      return;
       break;
    default:
-      /* Any query that needs SwrCore stats */
+      if (swr_query_needs_stats(pq->type)) {
+         ctx->api.pfnSwrGetStats(ctx->swrContext, swr_stats);
+         pq->stats_pending = TRUE;
+      }
       break;
    }
+}
 
-   /*
-    * All other results are collected from SwrCore counters
-    */
-
-   /* XXX, Should turn this into a fence callback and skip the stall */
-   SwrGetStats(ctx->swrContext, &swr_stats);
-   /* SwrGetStats returns immediately, wait for collection */
-   SwrWaitForIdle(ctx->swrContext);
 
+/*
+ * Convert a landed counter snapshot into query values
+ */
+static void
+swr_stats_to_result(const struct swr_query *pq,
+                    const SWR_STATS *swr_stats,
+                    union pipe_query_result *result)
+{
    switch (pq->type) {
    case PIPE_QUERY_OCCLUSION_PREDICATE:
    case PIPE_QUERY_OCCLUSION_COUNTER:
-      result->u64 = swr_stats.DepthPassCount;
+      result->u64 = swr_stats->DepthPassCount;
       break;
    case PIPE_QUERY_PRIMITIVES_GENERATED:
-      result->u64 = swr_stats.IaPrimitives;
+      result->u64 = swr_stats->IaPrimitives;
       break;
    case PIPE_QUERY_PRIMITIVES_EMITTED:
-      result->u64 = swr_stats.SoNumPrimsWritten[pq->index];
+      result->u64 = swr_stats->SoNumPrimsWritten[pq->index];
       break;
    case PIPE_QUERY_SO_STATISTICS:
    case PIPE_QUERY_SO_OVERFLOW_PREDICATE: {
       struct pipe_query_data_so_statistics *so_stats = &result->so_statistics;
       so_stats->num_primitives_written =
-         swr_stats.SoNumPrimsWritten[pq->index];
+         swr_stats->SoNumPrimsWritten[pq->index];
       so_stats->primitives_storage_needed =
-         swr_stats.SoPrimStorageNeeded[pq->index];
+         swr_stats->SoPrimStorageNeeded[pq->index];
    } break;
    case PIPE_QUERY_PIPELINE_STATISTICS: {
       struct pipe_query_data_pipeline_statistics *p_stats =
          &result->pipeline_statistics;
-      p_stats->ia_vertices = swr_stats.IaVertices;
-      p_stats->ia_primitives = swr_stats.IaPrimitives;
-      p_stats->vs_invocations = swr_stats.VsInvocations;
-      p_stats->gs_invocations = swr_stats.GsInvocations;
-      p_stats->gs_primitives = swr_stats.GsPrimitives;
-      p_stats->c_invocations = swr_stats.CPrimitives;
-      p_stats->c_primitives = swr_stats.CPrimitives;
-      p_stats->ps_invocations = swr_stats.PsInvocations;
-      p_stats->hs_invocations = swr_stats.HsInvocations;
-      p_stats->ds_invocations = swr_stats.DsInvocations;
-      p_stats->cs_invocations = swr_stats.CsInvocations;
+      p_stats->ia_vertices = swr_stats->IaVertices;
+      p_stats->ia_primitives = swr_stats->IaPrimitives;
+      p_stats->vs_invocations = swr_stats->VsInvocations;
+      p_stats->gs_invocations = swr_stats->GsInvocations;
+      p_stats->gs_primitives = swr_stats->GsPrimitives;
+      p_stats->c_invocations = swr_stats->CPrimitives;
+      p_stats->c_primitives = swr_stats->CPrimitives;
+      p_stats->ps_invocations = swr_stats->PsInvocations;
+      p_stats->hs_invocations = swr_stats->HsInvocations;
+      p_stats->ds_invocations = swr_stats->DsInvocations;
+      p_stats->cs_invocations = swr_stats->CsInvocations;
    } break;
    default:
       assert(0 && "Unsupported query");
       break;
    }
-
-   /* Only change stat collection if there are no active queries */
-   if (ctx->active_queries == 0)
-      SwrEnableStats(ctx->swrContext, enable_stats);
 }
 
 
@@ -176,17 +180,26 @@ swr_get_query_result(struct pipe_context *pipe,
                      boolean wait,
                      union pipe_query_result *result)
 {
-   struct swr_context *ctx = swr_context(pipe);
    struct swr_query *pq = swr_query(q);
+   boolean done = swr_is_fence_done(swr_fence(pq->fence));
 
-   if (pq->fence) {
-      if (!swr_is_fence_done(swr_fence(pq->fence))) {
-         swr_fence_submit(ctx, pq->fence);
-         if (!wait)
-            return FALSE;
-         swr_fence_finish(pipe->screen, pq->fence, 0);
-      }
-      swr_fence_reference(pipe->screen, &pq->fence, NULL);
+   /* Report whether everything up to end_query has actually finished */
+   if (pq->type == PIPE_QUERY_GPU_FINISHED && !wait) {
+      result->b = done;
+      return TRUE;
+   }
+
+   /* The fence was submitted at end_query; never resubmit it here, or a
+    * polling caller would keep pushing completion out */
+   if (!done) {
+      if (!wait)
+         return FALSE;
+      swr_fence_finish(pipe->screen, pq->fence, 0);
+   }
+
+   if (swr_query_needs_stats(pq->type)) {
+      swr_stats_to_result(pq, &pq->start_stats, &pq->start);
+      swr_stats_to_result(pq, &pq->end_stats, &pq->end);
    }
 
    /* XXX: Need to handle counter rollover */
@@ -197,7 +210,7 @@ swr_get_query_result(struct pipe_context *pipe,
       result->b = pq->end.u64 != pq->start.u64 ? TRUE : FALSE;
       break;
    case PIPE_QUERY_GPU_FINISHED:
-      result->b = pq->end.b;
+      result->b = TRUE;
       break;
    /* Counters */
    case PIPE_QUERY_OCCLUSION_COUNTER:
@@ -269,9 +282,9 @@ swr_begin_query(struct pipe_context *pipe, struct pipe_query *q)
    memset(&pq->end, 0, sizeof(pq->end));
 
    /* Gather start stats and enable SwrCore counters */
-   pq->result = &pq->start;
-   pq->enable_stats = TRUE;
-   swr_gather_stats(pipe, pq);
+   swr_gather_stats(pipe, pq, &pq->start, &pq->start_stats);
+   if (ctx->active_queries == 0)
+      ctx->api.pfnSwrEnableStats(ctx->swrContext, TRUE);
    ctx->active_queries++;
 
    /* override start timestamp to 0 for TIMESTAMP query */
@@ -291,10 +304,15 @@ swr_end_query(struct pipe_context *pipe, struct pipe_query *q)
           && "swr_end_query, there are no active queries!");
    ctx->active_queries--;
 
-   /* Gather end stats and disable SwrCore counters */
-   pq->result = &pq->end;
-   pq->enable_stats = FALSE;
-   swr_gather_stats(pipe, pq);
+   /* Gather end stats; the fence tells when both snapshots have landed and
+    * all rendering before the end of the query has finished */
+   swr_gather_stats(pipe, pq, &pq->end, &pq->end_stats);
+   swr_fence_submit(ctx, pq->fence);
+   pq->stats_pending = FALSE;
+
+   /* Only change stat collection if there are no active queries */
+   if (ctx->active_queries == 0)
+      ctx->api.pfnSwrEnableStats(ctx->swrContext, FALSE);
 }
 
 
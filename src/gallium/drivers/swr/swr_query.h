@@ -27,19 +27,23 @@
 
 #include <limits.h>
 #include "os/os_thread.h"
+#include "api.h"
 
 
 struct swr_query {
    unsigned type; /* PIPE_QUERY_* */
    unsigned index;
 
-   union pipe_query_result *result;
+   /* Core counter snapshots, written by the QUERYSTATS work items queued at
+    * begin/end and valid once the fence submitted at end is done */
+   SWR_STATS start_stats;
+   SWR_STATS end_stats;
+   bool stats_pending; /* snapshot queued with no fence submitted behind it */
+
    union pipe_query_result start;
    union pipe_query_result end;
 
    struct pipe_fence_handle *fence;
-
-   boolean enable_stats;
 };
 
 extern void swr_query_init(struct pipe_context *pipe);
@@ -49,6 +49,17 @@ struct swr_resource {
 
    /* Opaque pointer to swr_context to mark resource in use */
    void *bound_to_context;
+
+   /* Render targets only.  The write fence is submitted behind each store
+    * of the hot tiles; tiles_dirty is set by draws while attached. */
+   struct pipe_fence_handle *write_fence;
+   bool tiles_dirty;
+};
+
+/* Maps of tiled resources go through a linear staging copy */
+struct swr_transfer {
+   struct pipe_transfer base;
+   void *staging;
 };
 
 
@@ -91,8 +102,29 @@ swr_resource_data(struct pipe_resource *resource)
 }
 
 
+static INLINE boolean
+swr_resource_is_tiled(const struct swr_resource *res)
+{
+   return res->swr.tileMode != SWR_TILE_NONE;
+}
+
+void swr_tiled_copy(const struct swr_resource *res,
+                    const struct pipe_box *box,
+                    void *linear,
+                    unsigned linear_stride,
+                    bool to_linear);
+
 void swr_store_render_target(struct swr_context *ctx,
                              uint32_t attachment,
                              enum SWR_TILE_STATE post_tile_state,
                              struct SWR_SURFACE_STATE *surface = nullptr);
+
+void swr_store_dirty_resource(struct swr_context *ctx,
+                              struct swr_resource *res,
+                              enum SWR_TILE_STATE post_tile_state);
+
+void swr_invalidate_resource(struct swr_context *ctx,
+                             struct swr_resource *res);
+
+void swr_mark_targets_dirty(struct swr_context *ctx);
 #endif
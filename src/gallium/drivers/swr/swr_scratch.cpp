@@ -22,9 +22,105 @@
  ***************************************************************************/
 
 #include "util/u_memory.h"
+#include "util/u_math.h"
+#include "util/u_inlines.h"
 #include "swr_context.h"
 #include "swr_scratch.h"
 #include "api.h"
+#include "gen_knobs.h"
+
+#include <sched.h>
+
+
+static struct swr_scratch_chunk *
+swr_scratch_chunk_create(unsigned int size)
+{
+   struct swr_scratch_chunk *chunk = CALLOC_STRUCT(swr_scratch_chunk);
+   if (!chunk)
+      return NULL;
+
+   chunk->base = (uint8_t *)align_malloc(size, 64);
+   if (!chunk->base) {
+      FREE(chunk);
+      return NULL;
+   }
+   chunk->size = size;
+
+   return chunk;
+}
+
+static void
+swr_scratch_chunk_destroy(struct swr_scratch_chunk *chunk)
+{
+   align_free(chunk->base);
+   FREE(chunk);
+}
+
+/*
+ * Queue the current chunk for reuse once the sync submitted by the next
+ * swr_scratch_reap has passed.  The draw being set up may still copy into
+ * it, so the sync can't be submitted before that draw is queued.
+ */
+static void
+swr_scratch_retire(struct swr_scratch_buffers *scratch,
+                   struct swr_scratch_space *space)
+{
+   struct swr_scratch_chunk *chunk = space->current;
+
+   chunk->sync = scratch->sync_submitted + 1;
+   chunk->next = NULL;
+   if (space->retired_tail)
+      space->retired_tail->next = chunk;
+   else
+      space->retired = chunk;
+   space->retired_tail = chunk;
+
+   space->current = NULL;
+   scratch->sync_pending = true;
+}
+
+/*
+ * Find a chunk with room for size bytes: the oldest retired one if the
+ * draws using it are done, else a new one while under the limit, else the
+ * oldest retired one after waiting for its draws.
+ */
+static struct swr_scratch_chunk *
+swr_scratch_get_chunk(struct swr_scratch_buffers *scratch,
+                      struct swr_scratch_space *space,
+                      unsigned int size)
+{
+   struct swr_scratch_chunk *chunk = space->retired;
+
+   if (chunk && chunk->sync > scratch->sync_done
+       && chunk->sync <= scratch->sync_submitted
+       && space->num_chunks >= KNOB_SCRATCH_MAX_CHUNKS) {
+      scratch->num_stalls++;
+      while (chunk->sync > scratch->sync_done)
+         sched_yield();
+   }
+
+   if (chunk && chunk->sync <= scratch->sync_done) {
+      space->retired = chunk->next;
+      if (!space->retired)
+         space->retired_tail = NULL;
+
+      if (chunk->size >= size) {
+         chunk->used = 0;
+         return chunk;
+      }
+
+      /* Too small for this copy, replace it */
+      swr_scratch_chunk_destroy(chunk);
+      space->num_chunks--;
+   }
+
+   chunk = swr_scratch_chunk_create(
+      MAX2(KNOB_SCRATCH_CHUNK_KB << 10, align(size, 64)));
+   if (chunk)
+      space->num_chunks++;
+
+   return chunk;
+}
 
 
 void *
@@ -33,54 +129,29 @@ swr_copy_to_scratch_space(struct swr_context *ctx,
                           const void *user_buffer,
                           unsigned int size)
 {
+   struct swr_scratch_buffers *scratch = ctx->scratch;
+   struct swr_scratch_chunk *chunk = space->current;
+   unsigned int aligned_size = align(size, 16);
    void *ptr;
    assert(space);
    assert(user_buffer);
    assert(size);
 
-   if (size >= 2048) { /* XXX TODO create KNOB_ for this */
-      /* Use per draw SwrAllocDrawContextMemory for larger copies */
-      ptr = SwrAllocDrawContextMemory(ctx->swrContext, size, 4);
-   } else {
-      /* Allocate enough so that MAX_DRAWS_IN_FLIGHT sets fit. */
-      unsigned int max_size_in_flight = size * KNOB_MAX_DRAWS_IN_FLIGHT;
-
-      /* Need to grow space */
-      if (max_size_in_flight > space->current_size) {
-         /* Must idle the pipeline, this is infrequent */
-         SwrWaitForIdle(ctx->swrContext);
-
-         space->current_size = max_size_in_flight;
-
-         if (space->base) {
-            align_free(space->base);
-            space->base = NULL;
-         }
-
-         if (!space->base) {
-            space->base = (BYTE *)align_malloc(space->current_size, 4);
-            space->head = (void *)space->base;
-         }
-      }
-
-      /* Wrap */
-      if (((BYTE *)space->head + size)
-          >= ((BYTE *)space->base + space->current_size)) {
-         /*
-          * TODO XXX: Should add a fence on wrap.  Assumption is that
-          * current_space >> size, and there are at least MAX_DRAWS_IN_FLIGHT
-          * draws in scratch.  So fence would always be met on wrap.  A fence
-          * would ensure that first frame in buffer is done before wrapping.
-          * If fence ever needs to be waited on, can increase buffer size.
-          * So far in testing, this hasn't been necessary.
-          */
-         space->head = space->base;
-      }
+   if (!chunk || chunk->used + aligned_size > chunk->size) {
+      if (chunk)
+         swr_scratch_retire(scratch, space);
 
-      ptr = space->head;
-      space->head = (BYTE *)space->head + size;
+      chunk = swr_scratch_get_chunk(scratch, space, aligned_size);
+      assert(chunk && "Error: out of scratch space");
+      if (!chunk)
+         return NULL;
+      space->current = chunk;
    }
 
+   ptr = chunk->base + chunk->used;
+   chunk->used += aligned_size;
+   scratch->bytes_streamed += size;
+
    /* Copy user_buffer to scratch */
    memcpy(ptr, user_buffer, size);
 
@@ -88,6 +159,71 @@ swr_copy_to_scratch_space(struct swr_context *ctx,
 }
 
 
+/*
+ * Called by the backend once every draw queued before the sync is done.
+ */
+static void
+swr_scratch_sync_cb(uint64_t userData, uint64_t userData2)
+{
+   struct swr_scratch_buffers *scratch = (struct swr_scratch_buffers *)userData;
+
+   scratch->sync_done = userData2;
+}
+
+void
+swr_scratch_hold(struct swr_context *ctx, struct pipe_resource *resource)
+{
+   struct swr_scratch_buffers *scratch = ctx->scratch;
+   struct swr_scratch_hold hold = {scratch->sync_submitted + 1, NULL};
+
+   pipe_resource_reference(&hold.resource, resource);
+   util_dynarray_append(&scratch->holds, struct swr_scratch_hold, hold);
+   scratch->sync_pending = true;
+}
+
+void
+swr_scratch_reap(struct swr_context *ctx)
+{
+   struct swr_scratch_buffers *scratch = ctx->scratch;
+
+   if (scratch->sync_pending) {
+      scratch->sync_submitted++;
+      scratch->sync_pending = false;
+      ctx->api.pfnSwrSync(
+         ctx->swrContext, swr_scratch_sync_cb, (uint64_t)scratch,
+         scratch->sync_submitted);
+   }
+
+   /* Drop the buffers the draws are done with */
+   struct swr_scratch_hold *holds =
+      (struct swr_scratch_hold *)scratch->holds.data;
+   unsigned count = scratch->holds.size / sizeof(*holds);
+   unsigned done = 0;
+   uint64_t sync_done = scratch->sync_done;
+
+   while (done < count && holds[done].sync <= sync_done)
+      pipe_resource_reference(&holds[done++].resource, NULL);
+
+   if (done) {
+      memmove(holds, holds + done, (count - done) * sizeof(*holds));
+      scratch->holds.size -= done * sizeof(*holds);
+   }
+}
+
+
+static void
+swr_scratch_space_destroy(struct swr_scratch_space *space)
+{
+   if (space->current)
+      swr_scratch_chunk_destroy(space->current);
+
+   while (space->retired) {
+      struct swr_scratch_chunk *chunk = space->retired;
+      space->retired = chunk->next;
+      swr_scratch_chunk_destroy(chunk);
+   }
+}
+
 void
 swr_init_scratch_buffers(struct swr_context *ctx)
 {
@@ -103,14 +239,21 @@ swr_destroy_scratch_buffers(struct swr_context *ctx)
    struct swr_scratch_buffers *scratch = ctx->scratch;
 
    if (scratch) {
-      if (scratch->vs_constants.base)
-         align_free(scratch->vs_constants.base);
-      if (scratch->fs_constants.base)
-         align_free(scratch->fs_constants.base);
-      if (scratch->vertex_buffer.base)
-         align_free(scratch->vertex_buffer.base);
-      if (scratch->index_buffer.base)
-         align_free(scratch->index_buffer.base);
+      swr_scratch_space_destroy(&scratch->vs_constants);
+      swr_scratch_space_destroy(&scratch->fs_constants);
+      swr_scratch_space_destroy(&scratch->vertex_buffer);
+      swr_scratch_space_destroy(&scratch->index_buffer);
+
+      struct swr_scratch_hold *holds =
+         (struct swr_scratch_hold *)scratch->holds.data;
+      for (unsigned i = 0; i < scratch->holds.size / sizeof(*holds); i++)
+         pipe_resource_reference(&holds[i].resource, NULL);
+      util_dynarray_fini(&scratch->holds);
+
+      if (scratch->bytes_streamed)
+         debug_printf("SWR scratch: %llu KB streamed, %llu stalls\n",
+                      (unsigned long long)(scratch->bytes_streamed >> 10),
+                      (unsigned long long)scratch->num_stalls);
       FREE(scratch);
    }
 }
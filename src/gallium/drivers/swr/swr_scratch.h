@@ -24,12 +24,34 @@
 #ifndef SWR_SCRATCH_H
 #define SWR_SCRATCH_H
 
+#include "util/u_dynarray.h"
+
+/*
+ * Scratch space streams client arrays and constants to the draws.  Copies
+ * are carved out of chunks of KNOB_SCRATCH_CHUNK_KB; a copy that doesn't fit
+ * in one gets a chunk of its own.  Full chunks are retired behind a sync and
+ * reused once the draws queued before it are done.  Up to
+ * KNOB_SCRATCH_MAX_CHUNKS per space are allocated before waiting on one.
+ */
+struct swr_scratch_chunk {
+   struct swr_scratch_chunk *next;
+   uint64_t sync; /* reusable once sync_done reaches this */
+   unsigned int size;
+   unsigned int used;
+   uint8_t *base;
+};
+
 struct swr_scratch_space {
-   void *head;
-   unsigned int current_size;
-   /* TODO XXX: Add a fence for wrap condition. */
+   struct swr_scratch_chunk *current;
+   struct swr_scratch_chunk *retired; /* oldest first */
+   struct swr_scratch_chunk *retired_tail;
+   unsigned int num_chunks;
+};
 
-   void *base;
+/* A buffer draws read in place, referenced until sync_done reaches sync */
+struct swr_scratch_hold {
+   uint64_t sync;
+   struct pipe_resource *resource;
 };
 
 struct swr_scratch_buffers {
@@ -37,12 +59,21 @@ struct swr_scratch_buffers {
    struct swr_scratch_space fs_constants;
    struct swr_scratch_space vertex_buffer;
    struct swr_scratch_space index_buffer;
+
+   bool sync_pending;
+   uint64_t sync_submitted;
+   volatile uint64_t sync_done; /* written by the backend */
+
+   struct util_dynarray holds; /* swr_scratch_hold, oldest first */
+
+   uint64_t bytes_streamed;
+   uint64_t num_stalls;
 };
 
 
 /*
  * swr_copy_to_scratch_space
- * Copies size bytes of user_buffer into the scratch ring buffer.
+ * Copies size bytes of user_buffer into scratch space.
  * Used to store temporary data such as client arrays and constants.
  *
  * Inputs:
@@ -57,6 +88,14 @@ void *swr_copy_to_scratch_space(struct swr_context *ctx,
                                 const void *user_buffer,
                                 unsigned int size);
 
+/* Keeps a reference to a buffer being unbound until the draws queued so far
+ * are done; draws read vertex and index buffers in place */
+void swr_scratch_hold(struct swr_context *ctx, struct pipe_resource *resource);
+
+/* Submits a sync for newly retired chunks and holds, drops finished holds;
+ * call before a draw's copies */
+void swr_scratch_reap(struct swr_context *ctx);
+
 void swr_init_scratch_buffers(struct swr_context *ctx);
 void swr_destroy_scratch_buffers(struct swr_context *ctx);
 
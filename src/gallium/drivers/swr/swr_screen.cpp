@@ -26,12 +26,15 @@
 #include "util/u_memory.h"
 #include "util/u_format.h"
 #include "util/u_inlines.h"
-#include "util/u_cpu_detect.h"
+#include "util/u_dl.h"
+#include "util/u_box.h"
+#include "util/u_math.h"
 
 #include "state_tracker/sw_winsys.h"
 
 extern "C" {
 #include "gallivm/lp_bld_limits.h"
+#include "gallivm/lp_bld_init.h"
 }
 
 #include "swr_public.h"
@@ -39,6 +42,7 @@ extern "C" {
 #include "swr_context.h"
 #include "swr_resource.h"
 #include "swr_fence.h"
+#include "swr_compile.h"
 #include "gen_knobs.h"
 
 #include "jit_api.h"
@@ -416,6 +420,90 @@ swr_displaytarget_layout(struct swr_screen *screen, struct swr_resource *res)
    return TRUE;
 }
 
+/*
+ * Render targets and depth buffers that are only ever touched through the
+ * hot tiles get Y-major tiling, so each hot tile load/store covers whole 4KB
+ * tiles instead of a cache line per row.  Anything the samplers read, that
+ * is shared outside the driver or that has mips/layers stays linear.
+ */
+static SWR_TILE_MODE
+swr_resource_tile_mode(const struct pipe_resource *templat,
+                       const struct swr_resource *res)
+{
+   if (!KNOB_TILED_RENDER_TARGETS)
+      return SWR_TILE_NONE;
+
+   if (!(templat->bind & (PIPE_BIND_RENDER_TARGET | PIPE_BIND_DEPTH_STENCIL)))
+      return SWR_TILE_NONE;
+
+   if (templat->bind & (PIPE_BIND_SAMPLER_VIEW | PIPE_BIND_SCANOUT
+                        | PIPE_BIND_SHARED | PIPE_BIND_LINEAR))
+      return SWR_TILE_NONE;
+
+   if ((templat->target != PIPE_TEXTURE_2D
+        && templat->target != PIPE_TEXTURE_RECT)
+       || templat->last_level || templat->array_size > 1
+       || templat->nr_samples > 1)
+      return SWR_TILE_NONE;
+
+   /* Separate stencil would need W-major tiling */
+   if (res->has_stencil && !res->has_depth)
+      return SWR_TILE_NONE;
+
+   if (res->swr.format == (SWR_FORMAT)-1)
+      return SWR_TILE_NONE;
+
+   /* Pixels must not straddle the 16 byte columns of a Y tile */
+   if (!util_is_power_of_two(GetFormatInfo(res->swr.format).Bpp))
+      return SWR_TILE_NONE;
+
+   return SWR_TILE_MODE_YMAJOR;
+}
+
+/* Byte offset of byte x in row y of a Y-major surface.  Y tiles are 128
+ * bytes by 32 rows, stored as 16 byte wide columns. */
+static inline unsigned
+swr_ymajor_offset(unsigned pitch, unsigned x, unsigned y)
+{
+   unsigned tile = (y >> 5) * (pitch >> 7) + (x >> 7);
+   return (tile << 12) | ((x << 5) & 0xe00) | ((y << 4) & 0x1f0) | (x & 0xf);
+}
+
+/*
+ * Copy a box of a tiled resource to or from a linear buffer.
+ */
+void
+swr_tiled_copy(const struct swr_resource *res,
+               const struct pipe_box *box,
+               void *linear,
+               unsigned linear_stride,
+               bool to_linear)
+{
+   assert(res->swr.tileMode == SWR_TILE_MODE_YMAJOR);
+
+   const unsigned Bpp = GetFormatInfo(res->swr.format).Bpp;
+   const unsigned pitch = res->swr.pitch;
+   BYTE *tiled = res->swr.pBaseAddress;
+   BYTE *dst_row = (BYTE *)linear;
+
+   for (int y = box->y; y < box->y + box->height; y++) {
+      unsigned x = box->x * Bpp;
+      unsigned x_end = (box->x + box->width) * Bpp;
+      BYTE *p = dst_row;
+      while (x < x_end) {
+         unsigned len = MIN2(16 - (x & 15), x_end - x);
+         BYTE *t = tiled + swr_ymajor_offset(pitch, x, y);
+         if (to_linear)
+            memcpy(p, t, len);
+         else
+            memcpy(t, p, len);
+         p += len;
+         x += len;
+      }
+      dst_row += linear_stride;
+   }
+}
+
 static struct pipe_resource *
 swr_resource_create(struct pipe_screen *_screen,
                     const struct pipe_resource *templat)
@@ -444,8 +532,8 @@ swr_resource_create(struct pipe_screen *_screen,
    res->swr.height = templat->height0;
    res->swr.depth = templat->depth0;
    res->swr.type = SURFACE_2D;
-   res->swr.tileMode = SWR_TILE_NONE;
    res->swr.format = mesa_to_swr_format(fmt);
+   res->swr.tileMode = swr_resource_tile_mode(templat, res);
    res->swr.numSamples = (1 << templat->nr_samples);
 
    SWR_FORMAT_INFO finfo = GetFormatInfo(res->swr.format);
@@ -500,7 +588,22 @@ swr_resource_create(struct pipe_screen *_screen,
    res->swr.halign = res->alignedWidth;
    res->swr.valign = res->alignedHeight;
    res->swr.pitch = res->row_stride[0];
-   res->swr.pBaseAddress = (BYTE *)_aligned_malloc(total_size, 64);
+
+   if (swr_resource_is_tiled(res)) {
+      /* Whole 4KB tiles; row_stride stays the linear stride of maps */
+      res->swr.pitch = align(res->row_stride[0], 128);
+      total_size = res->swr.pitch * align(res->alignedHeight, 32);
+      res->swr.pBaseAddress = (BYTE *)_aligned_malloc(total_size, 4096);
+   } else
+      res->swr.pBaseAddress = (BYTE *)_aligned_malloc(total_size, 64);
+
+   /* Render targets get a fence for the stores of their hot tiles */
+   if (templat->bind & (PIPE_BIND_DEPTH_STENCIL | PIPE_BIND_RENDER_TARGET
+                        | PIPE_BIND_DISPLAY_TARGET)) {
+      res->write_fence = swr_fence_create();
+      if (!res->write_fence)
+         goto fail;
+   }
 
    if (res->has_depth && res->has_stencil) {
       res->secondary.width = templat->width0;
@@ -529,6 +632,8 @@ swr_resource_create(struct pipe_screen *_screen,
    return &res->base;
 
 fail:
+   if (res->write_fence)
+      swr_fence_reference(_screen, &res->write_fence, NULL);
    FREE(res);
    return NULL;
 }
@@ -550,10 +655,16 @@ swr_resource_destroy(struct pipe_screen *p_screen, struct pipe_resource *pt)
    if (res->bound_to_context && !res->display_target) {
       struct swr_context *ctx =
          swr_context((pipe_context *)res->bound_to_context);
-      SwrWaitForIdle(
+      ctx->api.pfnSwrWaitForIdle(
          ctx->swrContext); // BMCDEBUG, don't SwrWaitForIdle!!! Use a fence.
    }
 
+   /* Stores of its hot tiles may still be queued */
+   if (res->write_fence) {
+      swr_fence_finish(p_screen, res->write_fence, 0);
+      swr_fence_reference(p_screen, &res->write_fence, NULL);
+   }
+
    if (res->display_target) {
       /* display target */
       struct sw_winsys *winsys = screen->winsys;
@@ -581,13 +692,19 @@ swr_flush_frontbuffer(struct pipe_screen *p_screen,
    struct sw_winsys *winsys = screen->winsys;
    struct swr_resource *res = swr_resource(resource);
 
-   /* Ensure fence set at flush is finished, before reading frame buffer */
-   swr_fence_finish(p_screen, screen->flush_fence, 0);
+   /* Wait for the stores of this surface (swr_flush) to finish, not for
+    * whatever else was flushed since */
+   swr_fence_finish(p_screen, res->write_fence, 0);
 
    void *map = winsys->displaytarget_map(
       winsys, res->display_target, PIPE_TRANSFER_WRITE);
-   memcpy(
-      map, colorBuffer.pBaseAddress, colorBuffer.pitch * colorBuffer.height);
+   if (swr_resource_is_tiled(res)) {
+      struct pipe_box box;
+      u_box_2d(0, 0, colorBuffer.width, colorBuffer.height, &box);
+      swr_tiled_copy(res, &box, map, res->row_stride[0], true);
+   } else
+      memcpy(
+         map, colorBuffer.pBaseAddress, colorBuffer.pitch * colorBuffer.height);
    winsys->displaytarget_unmap(winsys, res->display_target);
 
    assert(res->display_target);
@@ -608,8 +725,24 @@ swr_destroy_screen(struct pipe_screen *p_screen)
    swr_fence_finish(p_screen, screen->flush_fence, 0);
    swr_fence_reference(p_screen, &screen->flush_fence, NULL);
 
+   JIT_CACHE_STATS cacheStats;
+   JIT_CODE_STATS codeStats;
+   JitGetCacheStats(screen->hJitMgr, cacheStats);
+   JitGetCodeStats(screen->hJitMgr, codeStats);
+   swr_compile_queue_destroy(screen->compile_queue, cacheStats, codeStats);
+   if (cacheStats.numHits || cacheStats.numMisses)
+      debug_printf("SWR jit cache: %llu hits, %llu misses\n",
+                   (unsigned long long)cacheStats.numHits,
+                   (unsigned long long)cacheStats.numMisses);
+   debug_printf("SWR jit code: %llu functions freed, %llu left (%llu KB)\n",
+                (unsigned long long)codeStats.numFreed,
+                (unsigned long long)codeStats.numFunctions,
+                (unsigned long long)(codeStats.codeSize >> 10));
+
    JitDestroyContext(screen->hJitMgr);
 
+   util_dl_close(screen->core_library);
+
    if (winsys->destroy)
       winsys->destroy(winsys);
 
@@ -626,20 +759,14 @@ swr_create_screen(struct sw_winsys *winsys)
       return NULL;
 
    fprintf(stderr, "SWR create screen!\n");
-   util_cpu_detect();
-   if (util_cpu_caps.has_avx2)
-      fprintf(stderr, "This processor supports AVX2.\n");
-   else if (util_cpu_caps.has_avx)
-      fprintf(stderr, "This processor supports AVX.\n");
-   /* Exit gracefully if there is no AVX support */
-   else {
-      fprintf(stderr, " !!! This processor does not support AVX or AVX2.  "
-                      "OpenSWR requires AVX.\n");
-      exit(-1);
+   screen->core_library = swr_load_core(&screen->api);
+   if (!screen->core_library) {
+      FREE(screen);
+      return NULL;
    }
 
    if (!getenv("KNOB_MAX_PRIMS_PER_DRAW")) {
-      g_GlobalKnobs.MAX_PRIMS_PER_DRAW.Value(49152);
+      screen->api.pGlobalKnobs->MAX_PRIMS_PER_DRAW.Value(49152);
    }
 
    screen->winsys = winsys;
@@ -658,7 +785,17 @@ swr_create_screen(struct sw_winsys *winsys)
 
    screen->base.flush_frontbuffer = swr_flush_frontbuffer;
 
-   screen->hJitMgr = JitCreateContext(KNOB_SIMD_WIDTH, KNOB_ARCH_STR);
+   /* JIT for the same ISA as the core that was loaded */
+   screen->hJitMgr =
+      JitCreateContext(screen->api.simdWidth, screen->api.pArchStr);
+
+   /* gallivm's one-time setup isn't thread safe, so do it before the
+    * compile threads start */
+   lp_build_init();
+   screen->compile_queue =
+      swr_compile_queue_create(KNOB_ASYNC_COMPILE_THREADS,
+                               screen->api.simdWidth,
+                               screen->api.pArchStr);
 
    swr_fence_init(&screen->base);
 
@@ -29,6 +29,8 @@
 #include "api.h"
 
 struct sw_winsys;
+struct util_dl_library;
+struct swr_compile_queue;
 
 struct swr_screen {
    struct pipe_screen base;
@@ -38,6 +40,11 @@ struct swr_screen {
    struct sw_winsys *winsys;
 
    HANDLE hJitMgr;
+   struct swr_compile_queue *compile_queue; /* NULL if compiling on demand */
+
+   /* ISA specific build of the core, picked at screen creation */
+   struct util_dl_library *core_library;
+   SWR_INTERFACE api;
 };
 
 static INLINE struct swr_screen *
@@ -49,4 +56,7 @@ swr_screen(struct pipe_screen *pipe)
 SWR_FORMAT
 mesa_to_swr_format(enum pipe_format format);
 
+struct util_dl_library *
+swr_load_core(SWR_INTERFACE *api);
+
 #endif
@@ -30,6 +30,7 @@
 #include "llvm/Support/CBindingWrapping.h"
 
 #include "tgsi/tgsi_strings.h"
+#include "tgsi/tgsi_parse.h"
 #include "gallivm/lp_bld_init.h"
 #include "gallivm/lp_bld_flow.h"
 #include "gallivm/lp_bld_struct.h"
@@ -98,6 +99,9 @@ swr_generate_fs_key(struct swr_jit_key &key,
    memcpy(&key.alphaTest,
           &ctx->depth_stencil->alpha,
           sizeof(struct pipe_alpha_state));
+
+   key.sprite_coord_enable = ctx->rasterizer->sprite_coord_enable;
+   key.vs_num_outputs = ctx->vs->info.base.num_outputs;
 }
 
 struct BuilderSWR : public Builder {
@@ -108,28 +112,46 @@ struct BuilderSWR : public Builder {
    }
 
    PFN_VERTEX_FUNC
-   CompileVS(struct pipe_context *ctx, swr_vertex_shader *swr_vs);
-   PFN_PIXEL_KERNEL CompileFS(struct swr_context *ctx, swr_jit_key &key);
+   CompileVS(swr_vertex_shader *swr_vs, const std::string &funcName);
+   PFN_PIXEL_KERNEL CompileFS(swr_fragment_shader *swr_fs,
+                              const swr_jit_key &key,
+                              const std::string &funcName);
 };
 
-PFN_VERTEX_FUNC
-BuilderSWR::CompileVS(struct pipe_context *ctx, swr_vertex_shader *swr_vs)
+static void
+swr_free_gallivm(void *gallivm)
 {
-   swr_vs->linkageMask = 0;
+   gallivm_destroy((struct gallivm_state *)gallivm);
+}
 
-   for (unsigned i = 0; i < swr_vs->info.base.num_outputs; i++) {
-      switch (swr_vs->info.base.output_semantic_name[i]) {
-      case TGSI_SEMANTIC_POSITION:
-         break;
-      case TGSI_SEMANTIC_PSIZE:
-         swr_vs->pointSizeAttrib = i;
-         break;
-      default:
-         swr_vs->linkageMask |= (1 << i);
-         break;
-      }
-   }
+/*
+ * Shaders are compiled by gallivm's own engine.  Its object goes through
+ * the jit cache too, to be sized and, if enabled, written to disk; a later
+ * lookup loads it with a JitManager engine.
+ *
+ * The IR and engine are dropped right away, here on the thread owning the
+ * LLVM context.  gallivm keeps the code until the JitManager frees it.
+ */
+static void *
+swr_jit_shader(JitManager *pJitMgr, struct gallivm_state *gallivm,
+               Function *pFunction)
+{
+   unwrap(gallivm->engine)->setObjectCache(&pJitMgr->mCache);
+   pJitMgr->mCache.mLastObjectSize = 0;
 
+   void *func = (void *)gallivm_jit_function(gallivm, wrap(pFunction));
+
+   gallivm_free_ir(gallivm);
+   pJitMgr->mpCurrentModule = NULL; /* freed with gallivm's engine */
+
+   pJitMgr->AddFunction(func, NULL, pJitMgr->mCache.mLastObjectSize,
+                        swr_free_gallivm, gallivm);
+   return func;
+}
+
+PFN_VERTEX_FUNC
+BuilderSWR::CompileVS(swr_vertex_shader *swr_vs, const std::string &funcName)
+{
    //   tgsi_dump(swr_vs->pipe.tokens, 0);
 
    struct gallivm_state *gallivm =
@@ -154,7 +176,7 @@ BuilderSWR::CompileVS(struct pipe_context *ctx, swr_vertex_shader *swr_vs)
    // create new vertex shader function
    auto pFunction = Function::Create(vsFuncType,
                                      GlobalValue::ExternalLinkage,
-                                     "VS",
+                                     funcName.empty() ? "VS" : funcName,
                                      JM()->mpCurrentModule);
    pFunction->addAttributes(AttributeSet::FunctionIndex, attrSet);
 
@@ -227,7 +249,7 @@ BuilderSWR::CompileVS(struct pipe_context *ctx, swr_vertex_shader *swr_vs)
    //   lp_debug_dump_value(func);
 
    PFN_VERTEX_FUNC pFunc =
-      (PFN_VERTEX_FUNC)gallivm_jit_function(gallivm, wrap(pFunction));
+      (PFN_VERTEX_FUNC)swr_jit_shader(JM(), gallivm, pFunction);
 
    debug_printf("vert shader  %p\n", pFunc);
    assert(pFunc && "Error: VertShader = NULL");
@@ -239,28 +261,60 @@ BuilderSWR::CompileVS(struct pipe_context *ctx, swr_vertex_shader *swr_vs)
    return pFunc;
 }
 
+void
+swr_generate_vs_linkage(swr_vertex_shader *swr_vs)
+{
+   swr_vs->linkageMask = 0;
+
+   for (unsigned i = 0; i < swr_vs->info.base.num_outputs; i++) {
+      switch (swr_vs->info.base.output_semantic_name[i]) {
+      case TGSI_SEMANTIC_POSITION:
+         break;
+      case TGSI_SEMANTIC_PSIZE:
+         swr_vs->pointSizeAttrib = i;
+         break;
+      default:
+         swr_vs->linkageMask |= (1 << i);
+         break;
+      }
+   }
+}
+
 PFN_VERTEX_FUNC
-swr_compile_vs(struct pipe_context *ctx, swr_vertex_shader *swr_vs)
+swr_compile_vs(HANDLE hJitMgr, swr_vertex_shader *swr_vs)
 {
-   BuilderSWR builder(
-      reinterpret_cast<JitManager *>(swr_screen(ctx->screen)->hJitMgr));
-   return builder.CompileVS(ctx, swr_vs);
+   JitManager *pJitMgr = reinterpret_cast<JitManager *>(hJitMgr);
+
+   /* The generated code depends only on the tokens */
+   std::string funcName;
+   PFN_VERTEX_FUNC pFunc = (PFN_VERTEX_FUNC)pJitMgr->GetCachedFunction(
+      "VS",
+      swr_vs->pipe.tokens,
+      tgsi_num_tokens(swr_vs->pipe.tokens) * sizeof(struct tgsi_token),
+      funcName);
+   if (pFunc)
+      return pFunc;
+
+   BuilderSWR builder(pJitMgr);
+   return builder.CompileVS(swr_vs, funcName);
 }
 
 static unsigned
-locate_linkage(ubyte name, ubyte index, struct tgsi_shader_info *info)
+locate_linkage(ubyte name, ubyte index,
+               const ubyte *output_semantic_name,
+               const ubyte *output_semantic_index)
 {
    for (int i = 0; i < PIPE_MAX_SHADER_OUTPUTS; i++) {
-      if ((info->output_semantic_name[i] == name)
-          && (info->output_semantic_index[i] == index)) {
+      if ((output_semantic_name[i] == name)
+          && (output_semantic_index[i] == index)) {
          return i - 1; // position is not part of the linkage
       }
    }
 
    if (name == TGSI_SEMANTIC_COLOR) { // BCOLOR fallback
       for (int i = 0; i < PIPE_MAX_SHADER_OUTPUTS; i++) {
-         if ((info->output_semantic_name[i] == TGSI_SEMANTIC_BCOLOR)
-             && (info->output_semantic_index[i] == index)) {
+         if ((output_semantic_name[i] == TGSI_SEMANTIC_BCOLOR)
+             && (output_semantic_index[i] == index)) {
             return i - 1; // position is not part of the linkage
          }
       }
@@ -270,10 +324,9 @@ locate_linkage(ubyte name, ubyte index, struct tgsi_shader_info *info)
 }
 
 PFN_PIXEL_KERNEL
-BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_key &key)
+BuilderSWR::CompileFS(swr_fragment_shader *swr_fs, const swr_jit_key &key,
+                      const std::string &funcName)
 {
-   struct swr_fragment_shader *swr_fs = ctx->fs;
-
    //   tgsi_dump(swr_fs->pipe.tokens, 0);
 
    struct gallivm_state *gallivm =
@@ -300,7 +353,7 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_key &key)
 
    auto pFunction = Function::Create(funcType,
                                      GlobalValue::ExternalLinkage,
-                                     "FS",
+                                     funcName.empty() ? "FS" : funcName,
                                      JM()->mpCurrentModule);
    pFunction->addAttributes(AttributeSet::FunctionIndex, attrSet);
 
@@ -337,8 +390,6 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_key &key)
    Value *pPerspAttribs =
       LOAD(pPS, {0, SWR_PS_CONTEXT_pPerspAttribs}, "pPerspAttribs");
 
-   swr_fs->constantMask = 0;
-
    for (int attrib = 0; attrib < PIPE_MAX_SHADER_INPUTS; attrib++) {
       const unsigned mask = swr_fs->info.base.input_usage_mask[attrib];
       const unsigned interpMode = swr_fs->info.base.input_interpolate[attrib];
@@ -377,11 +428,13 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_key &key)
       }
 
       unsigned linkedAttrib =
-         locate_linkage(semantic_name, semantic_idx, &ctx->vs->info.base);
+         locate_linkage(semantic_name, semantic_idx,
+                        key.vs_output_semantic_name,
+                        key.vs_output_semantic_idx);
       if (linkedAttrib == 0xFFFFFFFF) {
          // not found - check for point sprite
-         if (ctx->rasterizer->sprite_coord_enable) {
-            linkedAttrib = ctx->vs->info.base.num_outputs - 1;
+         if (key.sprite_coord_enable) {
+            linkedAttrib = key.vs_num_outputs - 1;
          } else {
             fprintf(stderr,
                     "Missing %s[%d]\n",
@@ -391,10 +444,6 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_key &key)
          }
       }
 
-      if (interpMode == TGSI_INTERPOLATE_CONSTANT) {
-         swr_fs->constantMask |= 1 << linkedAttrib;
-      }
-
       for (int channel = 0; channel < TGSI_NUM_CHANNELS; channel++) {
          if (mask & (1 << channel)) {
             Value *indexA = C(linkedAttrib * 12 + channel);
@@ -402,9 +451,10 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_key &key)
             Value *indexC = C(linkedAttrib * 12 + channel + 8);
 
             if ((semantic_name == TGSI_SEMANTIC_COLOR)
-                && ctx->rasterizer->light_twoside) {
+                && key.light_twoside) {
                unsigned bcolorAttrib = locate_linkage(
-                  TGSI_SEMANTIC_BCOLOR, semantic_idx, &ctx->vs->info.base);
+                  TGSI_SEMANTIC_BCOLOR, semantic_idx,
+                  key.vs_output_semantic_name, key.vs_output_semantic_idx);
 
                unsigned diff = 12 * (bcolorAttrib - linkedAttrib);
 
@@ -417,10 +467,6 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_key &key)
                indexA = ADD(indexA, offset);
                indexB = ADD(indexB, offset);
                indexC = ADD(indexC, offset);
-
-               if (interpMode == TGSI_INTERPOLATE_CONSTANT) {
-                  swr_fs->constantMask |= 1 << bcolorAttrib;
-               }
             }
 
             Value *pAttribPtr = (interpMode == TGSI_INTERPOLATE_PERSPECTIVE)
@@ -536,7 +582,9 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_key &key)
 
    if (key.alphaTest.enabled) {
       unsigned linkage =
-         locate_linkage(TGSI_SEMANTIC_COLOR, 0, &ctx->fs->info.base) + 1;
+         locate_linkage(TGSI_SEMANTIC_COLOR, 0,
+                        swr_fs->info.base.output_semantic_name,
+                        swr_fs->info.base.output_semantic_index) + 1;
 
       Value *alpha = LOAD(
          pPS, {0, SWR_PS_CONTEXT_shaded, linkage, 3 /* alpha */}, "alpha");
@@ -588,7 +636,7 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_key &key)
    gallivm_compile_module(gallivm);
 
    PFN_PIXEL_KERNEL kernel =
-      (PFN_PIXEL_KERNEL)gallivm_jit_function(gallivm, wrap(pFunction));
+      (PFN_PIXEL_KERNEL)swr_jit_shader(JM(), gallivm, pFunction);
    debug_printf("frag shader  %p\n", kernel);
    assert(kernel && "Error: FragShader = NULL");
 
@@ -599,10 +647,71 @@ BuilderSWR::CompileFS(struct swr_context *ctx, swr_jit_key &key)
    return kernel;
 }
 
+/*
+ * Attributes the FS reads without interpolation.  Computed apart from the
+ * IR so a kernel loaded from the jit cache or built on a compile thread
+ * doesn't have to report it back.
+ */
+unsigned
+swr_fs_constant_mask(swr_fragment_shader *swr_fs, const swr_jit_key &key)
+{
+   unsigned constantMask = 0;
+
+   for (int attrib = 0; attrib < PIPE_MAX_SHADER_INPUTS; attrib++) {
+      if (!swr_fs->info.base.input_usage_mask[attrib])
+         continue;
+      if (swr_fs->info.base.input_interpolate[attrib]
+          != TGSI_INTERPOLATE_CONSTANT)
+         continue;
+
+      ubyte semantic_name = swr_fs->info.base.input_semantic_name[attrib];
+      ubyte semantic_idx = swr_fs->info.base.input_semantic_index[attrib];
+
+      if (semantic_name == TGSI_SEMANTIC_FACE
+          || semantic_name == TGSI_SEMANTIC_POSITION
+          || semantic_name == TGSI_SEMANTIC_PRIMID)
+         continue;
+
+      unsigned linkedAttrib =
+         locate_linkage(semantic_name, semantic_idx,
+                        key.vs_output_semantic_name,
+                        key.vs_output_semantic_idx);
+      if (linkedAttrib == 0xFFFFFFFF) {
+         if (!key.sprite_coord_enable)
+            continue;
+         linkedAttrib = key.vs_num_outputs - 1;
+      }
+      constantMask |= 1 << linkedAttrib;
+
+      if ((semantic_name == TGSI_SEMANTIC_COLOR) && key.light_twoside) {
+         unsigned bcolorAttrib = locate_linkage(
+            TGSI_SEMANTIC_BCOLOR, semantic_idx,
+            key.vs_output_semantic_name, key.vs_output_semantic_idx);
+         constantMask |= 1 << bcolorAttrib;
+      }
+   }
+
+   return constantMask;
+}
+
 PFN_PIXEL_KERNEL
-swr_compile_fs(struct swr_context *ctx, swr_jit_key &key)
+swr_compile_fs(HANDLE hJitMgr, swr_fragment_shader *swr_fs,
+               const swr_jit_key &key)
 {
-   BuilderSWR builder(
-      reinterpret_cast<JitManager *>(swr_screen(ctx->pipe.screen)->hJitMgr));
-   return builder.CompileFS(ctx, key);
+   JitManager *pJitMgr = reinterpret_cast<JitManager *>(hJitMgr);
+
+   /* The generated code depends on the tokens and the key */
+   std::string state((const char *)swr_fs->pipe.tokens,
+                     tgsi_num_tokens(swr_fs->pipe.tokens)
+                        * sizeof(struct tgsi_token));
+   state.append((const char *)&key, sizeof(key));
+
+   std::string funcName;
+   PFN_PIXEL_KERNEL kernel = (PFN_PIXEL_KERNEL)pJitMgr->GetCachedFunction(
+      "FS", state.data(), state.size(), funcName);
+   if (kernel)
+      return kernel;
+
+   BuilderSWR builder(pJitMgr);
+   return builder.CompileFS(swr_fs, key, funcName);
 }
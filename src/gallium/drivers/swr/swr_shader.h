@@ -27,11 +27,17 @@ class swr_vertex_shader;
 class swr_fragment_shader;
 class swr_jit_key;
 
+void swr_generate_vs_linkage(swr_vertex_shader *swr_vs);
+
 PFN_VERTEX_FUNC
-swr_compile_vs(struct pipe_context *ctx, swr_vertex_shader *swr_vs);
+swr_compile_vs(HANDLE hJitMgr, swr_vertex_shader *swr_vs);
 
 PFN_PIXEL_KERNEL
-swr_compile_fs(struct swr_context *ctx, swr_jit_key &key);
+swr_compile_fs(HANDLE hJitMgr, swr_fragment_shader *swr_fs,
+               const swr_jit_key &key);
+
+unsigned swr_fs_constant_mask(swr_fragment_shader *swr_fs,
+                              const swr_jit_key &key);
 
 void swr_generate_fs_key(struct swr_jit_key &key,
                          struct swr_context *ctx,
@@ -46,6 +52,8 @@ struct swr_jit_key {
    unsigned nr_sampler_views;
    struct swr_sampler_static_state sampler[PIPE_MAX_SHADER_SAMPLER_VIEWS];
    struct pipe_alpha_state alphaTest;
+   unsigned sprite_coord_enable;
+   unsigned vs_num_outputs;
 };
 
 namespace std
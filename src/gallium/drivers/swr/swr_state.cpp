@@ -39,9 +39,11 @@
 #include "swr_context_llvm.h"
 #include "swr_screen.h"
 #include "swr_resource.h"
+#include "swr_fence.h"
 #include "swr_tex_sample.h"
 #include "swr_scratch.h"
 #include "swr_shader.h"
+#include "gen_knobs.h"
 
 /* These should be pulled out into separate files as necessary
  * Just initializing everything here to get going. */
@@ -98,6 +100,32 @@ swr_create_blend_state(struct pipe_context *pipe,
          (rt_blend->colormask & PIPE_MASK_A) ? 0 : 1;
    }
 
+   /* Start on the blend functions for the bound render targets */
+   struct swr_context *ctx = swr_context(pipe);
+   struct swr_compile_queue *queue = swr_screen(pipe->screen)->compile_queue;
+   for (int target = 0;
+        queue && target < std::min(SWR_NUM_RENDERTARGETS,
+                                   PIPE_MAX_COLOR_BUFS);
+        target++) {
+      if (!ctx->framebuffer.cbufs[target])
+         continue;
+
+      BLEND_COMPILE_STATE compileState = state->compileState[target];
+      compileState.format =
+         swr_resource(ctx->framebuffer.cbufs[target]->texture)->swr.format;
+
+      if (ctx->blendJIT->count(compileState))
+         continue;
+
+      struct swr_variant *variant = swr_variant_create(ctx,
+         [ctx, compileState] { ctx->blendJIT->erase(compileState); });
+      variant->jit.job = swr_compile_submit(queue,
+         [compileState](HANDLE hJitMgr) {
+            return (void *)JitCompileBlend(hJitMgr, compileState);
+         });
+      (*ctx->blendJIT)[compileState] = variant;
+   }
+
    return state;
 }
 
@@ -306,8 +334,8 @@ static void *
 swr_create_vs_state(struct pipe_context *pipe,
                     const struct pipe_shader_state *vs)
 {
-   struct swr_vertex_shader *swr_vs =
-      (swr_vertex_shader *)CALLOC_STRUCT(swr_vertex_shader);
+   struct swr_screen *screen = swr_screen(pipe->screen);
+   struct swr_vertex_shader *swr_vs = new swr_vertex_shader();
    if (!swr_vs)
       return NULL;
 
@@ -316,7 +344,17 @@ swr_create_vs_state(struct pipe_context *pipe,
 
    lp_build_tgsi_info(vs->tokens, &swr_vs->info);
 
-   swr_vs->func = swr_compile_vs(pipe, swr_vs);
+   swr_generate_vs_linkage(swr_vs);
+
+   /* Compiled in the background; swr_update_derived waits for it */
+   swr_vs->func.job = swr_compile_submit(screen->compile_queue,
+      [swr_vs](HANDLE hJitMgr) {
+         return (void *)swr_compile_vs(hJitMgr, swr_vs);
+      });
+   if (!swr_vs->func.job) {
+      swr_vs->func.func = (void *)swr_compile_vs(screen->hJitMgr, swr_vs);
+      swr_vs->func.jit_mgr = screen->hJitMgr;
+   }
 
    swr_vs->soState = {0};
 
@@ -355,9 +393,20 @@ swr_bind_vs_state(struct pipe_context *pipe, void *vs)
 static void
 swr_delete_vs_state(struct pipe_context *pipe, void *vs)
 {
+   struct swr_context *ctx = swr_context(pipe);
    struct swr_vertex_shader *swr_vs = (swr_vertex_shader *)vs;
+
+   swr_jit_retire(ctx, swr_vs->func);
+   for (unsigned i = 0; i < PIPE_PRIM_MAX; i++) {
+      if (!swr_vs->soFunc[i])
+         continue;
+      swr_jit_func soFunc = {(void *)swr_vs->soFunc[i],
+                             swr_screen(pipe->screen)->hJitMgr};
+      swr_jit_retire(ctx, soFunc);
+   }
+
    FREE((void *)swr_vs->pipe.tokens);
-   FREE(vs);
+   delete swr_vs;
 }
 
 static void *
@@ -372,6 +421,26 @@ swr_create_fs_state(struct pipe_context *pipe,
 
    lp_build_tgsi_info(fs->tokens, &swr_fs->info);
 
+   /*
+    * Start on the variant for the state bound now, the likeliest one for
+    * the first draw.  Other variants are compiled when first drawn.
+    */
+   struct swr_context *ctx = swr_context(pipe);
+   struct swr_compile_queue *queue = swr_screen(pipe->screen)->compile_queue;
+   if (queue && ctx->vs && ctx->rasterizer && ctx->depth_stencil) {
+      swr_jit_key key;
+      memset(&key, 0, sizeof(key));
+      swr_generate_fs_key(key, ctx, swr_fs);
+
+      struct swr_variant *variant = swr_variant_create(ctx,
+         [swr_fs, key] { swr_fs->map.erase(key); });
+      variant->jit.job = swr_compile_submit(queue,
+         [swr_fs, key](HANDLE hJitMgr) {
+            return (void *)swr_compile_fs(hJitMgr, swr_fs, key);
+         });
+      swr_fs->map[key] = variant;
+   }
+
    return swr_fs;
 }
 
@@ -391,7 +460,12 @@ swr_bind_fs_state(struct pipe_context *pipe, void *fs)
 static void
 swr_delete_fs_state(struct pipe_context *pipe, void *fs)
 {
+   struct swr_context *ctx = swr_context(pipe);
    struct swr_fragment_shader *swr_fs = (swr_fragment_shader *)fs;
+
+   for (auto &variant : swr_fs->map)
+      swr_variant_remove(ctx, variant.second);
+
    FREE((void *)swr_fs->pipe.tokens);
    delete swr_fs;
 }
@@ -431,7 +505,7 @@ swr_create_vertex_elements_state(struct pipe_context *pipe,
 {
    struct swr_vertex_element_state *velems;
    assert(num_elements <= PIPE_MAX_ATTRIBS);
-   velems = CALLOC_STRUCT(swr_vertex_element_state);
+   velems = new swr_vertex_element_state();
    if (velems) {
       velems->fsState.numAttribs = num_elements;
       for (unsigned i = 0; i < num_elements; i++) {
@@ -472,6 +546,19 @@ swr_create_vertex_elements_state(struct pipe_context *pipe,
             mesa_to_swr_format(attribs[i].src_format));
          velems->stream_pitch[attribs[i].vertex_buffer_index] += swr_desc.Bpp;
       }
+
+      velems->precompileState = velems->fsState;
+      velems->precompileState.indexType = R32_UINT;
+      velems->precompileState.cutIndex = 0;
+      velems->precompileState.bEnableCutIndex = false;
+
+      FETCH_COMPILE_STATE state = velems->precompileState;
+      velems->precompiled.func = NULL;
+      velems->precompiled.job =
+         swr_compile_submit(swr_screen(pipe->screen)->compile_queue,
+            [state](HANDLE hJitMgr) {
+               return (void *)JitCompileFetch(hJitMgr, state);
+            });
    }
 
    return velems;
@@ -491,8 +578,14 @@ swr_bind_vertex_elements_state(struct pipe_context *pipe, void *velems)
 static void
 swr_delete_vertex_elements_state(struct pipe_context *pipe, void *velems)
 {
-   /* XXX Need to destroy fetch shader? */
-   FREE(velems);
+   struct swr_vertex_element_state *swr_velems =
+      (struct swr_vertex_element_state *)velems;
+
+   struct swr_context *ctx = swr_context(pipe);
+
+   swr_jit_retire(ctx, swr_velems->fetch);
+   swr_jit_retire(ctx, swr_velems->precompiled);
+   delete swr_velems;
 }
 
 
@@ -506,6 +599,13 @@ swr_set_vertex_buffers(struct pipe_context *pipe,
 
    assert(num_elements <= PIPE_MAX_ATTRIBS);
 
+   /* Draws read buffers in place; keep unbound ones until they're done */
+   for (unsigned i = 0; i < num_elements; i++) {
+      struct pipe_resource *old = ctx->vertex_buffer[start_slot + i].buffer;
+      if (old && !(buffers && buffers[i].buffer == old))
+         swr_scratch_hold(ctx, old);
+   }
+
    util_set_vertex_buffers_count(ctx->vertex_buffer,
                                  &ctx->num_vertex_buffers,
                                  buffers,
@@ -521,11 +621,21 @@ swr_set_index_buffer(struct pipe_context *pipe,
                      const struct pipe_index_buffer *ib)
 {
    struct swr_context *ctx = swr_context(pipe);
-
-   if (ib)
-      memcpy(&ctx->index_buffer, ib, sizeof(ctx->index_buffer));
-   else
+   struct pipe_resource *old = ctx->index_buffer.buffer;
+
+   /* Draws read buffers in place; keep an unbound one until they're done */
+   if (old && !(ib && ib->buffer == old))
+      swr_scratch_hold(ctx, old);
+
+   if (ib) {
+      pipe_resource_reference(&ctx->index_buffer.buffer, ib->buffer);
+      ctx->index_buffer.index_size = ib->index_size;
+      ctx->index_buffer.offset = ib->offset;
+      ctx->index_buffer.user_buffer = ib->user_buffer;
+   } else {
+      pipe_resource_reference(&ctx->index_buffer.buffer, NULL);
       memset(&ctx->index_buffer, 0, sizeof(ctx->index_buffer));
+   }
 
    ctx->dirty |= SWR_NEW_VERTEX;
 }
@@ -624,6 +734,14 @@ void
 swr_update_derived(struct swr_context *ctx,
                    const struct pipe_draw_info *p_draw_info)
 {
+   struct swr_screen *screen = swr_screen(ctx->pipe.screen);
+
+   /* Free the jitted code draws have stopped using */
+   swr_jit_reap(ctx);
+
+   /* Fence scratch chunks the previous draws filled up */
+   swr_scratch_reap(ctx);
+
    /* Any state that requires dirty flags to be re-triggered sets this mask */
    /* For example, user_buffer vertex and index buffers. */
    unsigned post_update_dirty_flags = 0;
@@ -632,6 +750,8 @@ swr_update_derived(struct swr_context *ctx,
    if (ctx->dirty & SWR_NEW_FRAMEBUFFER) {
       struct pipe_framebuffer_state *fb = &ctx->framebuffer;
       SWR_SURFACE_STATE *new_attachment[SWR_NUM_ATTACHMENTS] = {0};
+      struct swr_resource *new_res[SWR_NUM_ATTACHMENTS] = {0};
+      struct swr_resource *stored_res[SWR_NUM_ATTACHMENTS] = {0};
       boolean changed, need_idle;
       UINT i;
 
@@ -642,6 +762,7 @@ swr_update_derived(struct swr_context *ctx,
                struct swr_resource *colorBuffer =
                   swr_resource(fb->cbufs[i]->texture);
                new_attachment[SWR_ATTACHMENT_COLOR0 + i] = &colorBuffer->swr;
+               new_res[SWR_ATTACHMENT_COLOR0 + i] = colorBuffer;
             }
 
       /* depth/stencil target */
@@ -650,13 +771,18 @@ swr_update_derived(struct swr_context *ctx,
             swr_resource(fb->zsbuf->texture);
          if (depthStencilBuffer->has_depth) {
             new_attachment[SWR_ATTACHMENT_DEPTH] = &depthStencilBuffer->swr;
+            new_res[SWR_ATTACHMENT_DEPTH] = depthStencilBuffer;
 
-            if (depthStencilBuffer->has_stencil)
+            if (depthStencilBuffer->has_stencil) {
                new_attachment[SWR_ATTACHMENT_STENCIL] =
                   &depthStencilBuffer->secondary;
+               new_res[SWR_ATTACHMENT_STENCIL] = depthStencilBuffer;
+            }
 
-         } else if (depthStencilBuffer->has_stencil)
+         } else if (depthStencilBuffer->has_stencil) {
             new_attachment[SWR_ATTACHMENT_STENCIL] = &depthStencilBuffer->swr;
+            new_res[SWR_ATTACHMENT_STENCIL] = depthStencilBuffer;
+         }
       }
 
       /* For each attachment that has changed, store tile contents to render
@@ -671,24 +797,32 @@ swr_update_derived(struct swr_context *ctx,
                post_state =
                   (new_attachment[i] ? SWR_TILE_INVALID : SWR_TILE_RESOLVED);
                swr_store_render_target(ctx, i, post_state);
+               stored_res[i] = ctx->current.attachment_res[i];
                need_idle |= TRUE;
             }
             changed |= TRUE;
          }
       }
 
+      /* Fence the stores, so maps of these resources wait on just them */
+      for (i = 0; i < SWR_NUM_ATTACHMENTS; i++)
+         if (stored_res[i] && stored_res[i]->tiles_dirty) {
+            swr_fence_submit(ctx, stored_res[i]->write_fence);
+            stored_res[i]->tiles_dirty = false;
+         }
+
       /*
        * Attachments are live, don't update any until idle
        * (all StoreTiles, called by swr_store_render_targets, finish)
        */
       if (need_idle)
-         SwrWaitForIdle(ctx->swrContext);
+         ctx->api.pfnSwrWaitForIdle(ctx->swrContext);
 
       if (changed) {
          /* Update actual SWR core attachments, or clear those no longer
           * attached */
          swr_draw_context *pDC =
-            (swr_draw_context *)SwrGetPrivateContextState(ctx->swrContext);
+            (swr_draw_context *)ctx->api.pfnSwrGetPrivateContextState(ctx->swrContext);
          SWR_SURFACE_STATE *renderTargets = pDC->renderTargets;
          for (i = 0; i < SWR_NUM_ATTACHMENTS; i++) {
             if ((uintptr_t)ctx->current.attachment[i]
@@ -700,6 +834,7 @@ swr_update_derived(struct swr_context *ctx,
                   renderTargets[i] = {0};
                   ctx->current.attachment[i] = nullptr;
                }
+               ctx->current.attachment_res[i] = new_res[i];
             }
          }
 
@@ -711,7 +846,8 @@ swr_update_derived(struct swr_context *ctx,
    }
 
    /* Raster state */
-   if (ctx->dirty & (SWR_NEW_RASTERIZER | SWR_NEW_VS)) {
+   if (ctx->dirty & (SWR_NEW_RASTERIZER | SWR_NEW_VS | SWR_NEW_FRAMEBUFFER
+                     | SWR_NEW_BLEND)) {
       SWR_RASTSTATE *rastState = &ctx->current.rastState;
       rastState->cullMode = swr_convert_cull_mode(ctx->rasterizer->cull_face);
       rastState->frontWinding = ctx->rasterizer->front_ccw
@@ -762,16 +898,31 @@ swr_update_derived(struct swr_context *ctx,
       if (zb && swr_resource(zb->texture)->has_depth)
          rastState->depthFormat = swr_resource(zb->texture)->swr.format;
 
+      /* unorm8 targets keep their color hot tiles in the compact format,
+       * everything else is held as float. The core also falls back to float
+       * for blended targets; logic ops are not implemented by the core and
+       * keep the float hot tile too. */
+      for (unsigned i = 0; i < SWR_NUM_RENDERTARGETS; i++) {
+         struct pipe_surface *cb = i < ctx->framebuffer.nr_cbufs
+            ? ctx->framebuffer.cbufs[i] : nullptr;
+         SWR_FORMAT fmt =
+            cb && !ctx->blend->pipe.logicop_enable
+            ? swr_resource(cb->texture)->swr.format : R32G32B32A32_FLOAT;
+         rastState->colorHotTileFormat[i] =
+            (fmt == R8G8B8A8_UNORM || fmt == B8G8R8A8_UNORM)
+            ? R8G8B8A8_UNORM : R32G32B32A32_FLOAT;
+      }
+
       rastState->depthClipEnable = ctx->rasterizer->depth_clip;
 
-      SwrSetRastState(ctx->swrContext, rastState);
+      ctx->api.pfnSwrSetRastState(ctx->swrContext, rastState);
    }
 
    /* Scissor */
    if (ctx->dirty & SWR_NEW_SCISSOR) {
       BBOX bbox(ctx->scissor.miny, ctx->scissor.maxy,
                    ctx->scissor.minx, ctx->scissor.maxx);
-      SwrSetScissorRects(ctx->swrContext, 1, &bbox);
+      ctx->api.pfnSwrSetScissorRects(ctx->swrContext, 1, &bbox);
    }
 
    /* Viewport */
@@ -825,7 +976,7 @@ swr_update_derived(struct swr_context *ctx,
       vp->width = std::min(vp->width, (float)ctx->framebuffer.width);
       vp->height = std::min(vp->height, (float)ctx->framebuffer.height);
 
-      SwrSetViewports(ctx->swrContext, 1, vp, vpm);
+      ctx->api.pfnSwrSetViewports(ctx->swrContext, 1, vp, vpm);
    }
 
    /* Set vertex & index buffers */
@@ -872,13 +1023,18 @@ swr_update_derived(struct swr_context *ctx,
             max_vertex = info.max_index + 1;
             partial_inbounds = 0;
 
-            /* Copy only needed vertices to scratch space */
-            size = AlignUp(size, 4);
-            const void *ptr = (const uint8_t *) vb->user_buffer
-               + info.min_index * pitch;
-            ptr = swr_copy_to_scratch_space(
-               ctx, &ctx->scratch->vertex_buffer, ptr, size);
-            p_data = (const uint8_t *)ptr - info.min_index * pitch;
+            if (KNOB_USER_BUFFERS_IN_PLACE) {
+               /* The application keeps the array until the draws finish */
+               p_data = (const uint8_t *)vb->user_buffer;
+            } else {
+               /* Copy only needed vertices to scratch space */
+               size = AlignUp(size, 4);
+               const void *ptr = (const uint8_t *) vb->user_buffer
+                  + info.min_index * pitch;
+               ptr = swr_copy_to_scratch_space(
+                  ctx, &ctx->scratch->vertex_buffer, ptr, size);
+               p_data = (const uint8_t *)ptr - info.min_index * pitch;
+            }
          }
 
          swrVertexBuffers[i] = {0};
@@ -890,7 +1046,7 @@ swr_update_derived(struct swr_context *ctx,
          swrVertexBuffers[i].partialInboundsSize = partial_inbounds;
       }
 
-      SwrSetVertexBuffers(
+      ctx->api.pfnSwrSetVertexBuffers(
          ctx->swrContext, ctx->num_vertex_buffers, swrVertexBuffers);
 
       /* index buffer, if required (info passed in by swr_draw_vbo) */
@@ -914,14 +1070,23 @@ swr_update_derived(struct swr_context *ctx,
              * revalidate on each draw */
             post_update_dirty_flags |= SWR_NEW_VERTEX;
 
-            size = info.count * pitch;
-            size = AlignUp(size, 4);
+            /* The draw offsets pIndices by start, so size covers
+             * [0, start + count) from pIndices */
+            size = AlignUp((info.start + info.count) * pitch, 4);
 
-            /* Copy indices to scratch space */
-            const void *ptr = ib->user_buffer;
-            ptr = swr_copy_to_scratch_space(
-               ctx, &ctx->scratch->index_buffer, ptr, size);
-            p_data = (const uint8_t *)ptr;
+            if (KNOB_USER_BUFFERS_IN_PLACE) {
+               /* The application keeps the array until the draws finish */
+               p_data = (const uint8_t *)ib->user_buffer;
+            } else {
+               /* Copy only the indices the draw reads, [start, start + count),
+                * to scratch space */
+               const void *ptr = (const uint8_t *)ib->user_buffer
+                  + info.start * pitch;
+               ptr = swr_copy_to_scratch_space(
+                  ctx, &ctx->scratch->index_buffer, ptr,
+                  AlignUp(info.count * pitch, 4));
+               p_data = (const uint8_t *)ptr - info.start * pitch;
+            }
          }
 
          SWR_INDEX_BUFFER_STATE swrIndexBuffer;
@@ -929,7 +1094,7 @@ swr_update_derived(struct swr_context *ctx,
          swrIndexBuffer.pIndices = p_data;
          swrIndexBuffer.size = size;
 
-         SwrSetIndexBuffer(ctx->swrContext, &swrIndexBuffer);
+         ctx->api.pfnSwrSetIndexBuffer(ctx->swrContext, &swrIndexBuffer);
       }
 
       struct swr_vertex_element_state *velems = ctx->velems;
@@ -941,7 +1106,9 @@ swr_update_derived(struct swr_context *ctx,
 
    /* VertexShader */
    if (ctx->dirty & SWR_NEW_VS) {
-      SwrSetVertexFunc(ctx->swrContext, ctx->vs->func);
+      PFN_VERTEX_FUNC func = (PFN_VERTEX_FUNC)swr_jit_func_get(
+         screen->compile_queue, ctx->vs->func, screen->hJitMgr);
+      ctx->api.pfnSwrSetVertexFunc(ctx->swrContext, func);
    }
 
    swr_jit_key key;
@@ -950,14 +1117,23 @@ swr_update_derived(struct swr_context *ctx,
                      | SWR_NEW_FRAMEBUFFER)) {
       memset(&key, 0, sizeof(key));
       swr_generate_fs_key(key, ctx, ctx->fs);
+      struct swr_variant *variant;
       auto search = ctx->fs->map.find(key);
-      PFN_PIXEL_KERNEL func;
       if (search != ctx->fs->map.end()) {
-         func = search->second;
+         variant = search->second;
       } else {
-         func = swr_compile_fs(ctx, key);
-         ctx->fs->map.insert(std::make_pair(key, func));
+         struct swr_fragment_shader *swr_fs = ctx->fs;
+         variant = swr_variant_create(ctx,
+            [swr_fs, key] { swr_fs->map.erase(key); });
+         variant->jit.func =
+            (void *)swr_compile_fs(screen->hJitMgr, swr_fs, key);
+         variant->jit.jit_mgr = screen->hJitMgr;
+         swr_fs->map[key] = variant;
       }
+      PFN_PIXEL_KERNEL func =
+         (PFN_PIXEL_KERNEL)swr_variant_get(ctx, variant);
+      swr_variant_bind(&ctx->variants->bound_fs, variant);
+      ctx->fs->constantMask = swr_fs_constant_mask(ctx->fs, key);
       SWR_PS_STATE psState = {0};
       psState.pfnPixelShader = func;
       psState.killsPixel =
@@ -968,13 +1144,13 @@ swr_update_derived(struct swr_context *ctx,
          (ctx->framebuffer.nr_cbufs != 0) ?
          (ctx->framebuffer.nr_cbufs - 1) :
          0;
-      SwrSetPixelShaderState(ctx->swrContext, &psState);
+      ctx->api.pfnSwrSetPixelShaderState(ctx->swrContext, &psState);
    }
 
    /* JIT sampler state */
    if (ctx->dirty & SWR_NEW_SAMPLER) {
       swr_draw_context *pDC =
-         (swr_draw_context *)SwrGetPrivateContextState(ctx->swrContext);
+         (swr_draw_context *)ctx->api.pfnSwrGetPrivateContextState(ctx->swrContext);
 
       for (unsigned i = 0; i < key.nr_samplers; i++) {
          const struct pipe_sampler_state *sampler =
@@ -992,7 +1168,7 @@ swr_update_derived(struct swr_context *ctx,
    /* JIT sampler view state */
    if (ctx->dirty & SWR_NEW_SAMPLER_VIEW) {
       swr_draw_context *pDC =
-         (swr_draw_context *)SwrGetPrivateContextState(ctx->swrContext);
+         (swr_draw_context *)ctx->api.pfnSwrGetPrivateContextState(ctx->swrContext);
 
       for (unsigned i = 0; i < key.nr_sampler_views; i++) {
          struct pipe_sampler_view *view =
@@ -1024,7 +1200,7 @@ swr_update_derived(struct swr_context *ctx,
    /* VertexShader Constants */
    if (ctx->dirty & SWR_NEW_VSCONSTANTS) {
       swr_draw_context *pDC =
-         (swr_draw_context *)SwrGetPrivateContextState(ctx->swrContext);
+         (swr_draw_context *)ctx->api.pfnSwrGetPrivateContextState(ctx->swrContext);
 
       for (UINT i = 0; i < PIPE_MAX_CONSTANT_BUFFERS; i++) {
          const pipe_constant_buffer *cb =
@@ -1050,7 +1226,7 @@ swr_update_derived(struct swr_context *ctx,
    /* FragmentShader Constants */
    if (ctx->dirty & SWR_NEW_FSCONSTANTS) {
       swr_draw_context *pDC =
-         (swr_draw_context *)SwrGetPrivateContextState(ctx->swrContext);
+         (swr_draw_context *)ctx->api.pfnSwrGetPrivateContextState(ctx->swrContext);
 
       for (UINT i = 0; i < PIPE_MAX_CONSTANT_BUFFERS; i++) {
          const pipe_constant_buffer *cb =
@@ -1123,7 +1299,7 @@ swr_update_derived(struct swr_context *ctx,
       depthStencilState.depthTestEnable = depth->enabled;
       depthStencilState.depthTestFunc = swr_convert_depth_func(depth->func);
       depthStencilState.depthWriteEnable = depth->writemask;
-      SwrSetDepthStencilState(ctx->swrContext, &depthStencilState);
+      ctx->api.pfnSwrSetDepthStencilState(ctx->swrContext, &depthStencilState);
    }
 
    /* Blend State */
@@ -1146,14 +1322,18 @@ swr_update_derived(struct swr_context *ctx,
          blendState.renderTarget[0].writeDisableGreen = 1;
          blendState.renderTarget[0].writeDisableBlue = 1;
          blendState.renderTarget[0].writeDisableAlpha = 1;
+         for (int target = 0; target < PIPE_MAX_COLOR_BUFS; target++)
+            swr_variant_bind(&ctx->variants->bound_blend[target], NULL);
       }
       else
          for (int target = 0;
                target < std::min(SWR_NUM_RENDERTARGETS,
                                  PIPE_MAX_COLOR_BUFS);
                target++) {
-            if (!fb->cbufs[target])
+            if (!fb->cbufs[target]) {
+               swr_variant_bind(&ctx->variants->bound_blend[target], NULL);
                continue;
+            }
 
             BLEND_COMPILE_STATE *compileState =
                &ctx->blend->compileState[target];
@@ -1166,22 +1346,29 @@ swr_update_derived(struct swr_context *ctx,
                   &compileState->blendState,
                   sizeof(compileState->blendState));
 
-            PFN_BLEND_JIT_FUNC func = NULL;
+            struct swr_variant *variant;
             auto search = ctx->blendJIT->find(*compileState);
             if (search != ctx->blendJIT->end()) {
-               func = search->second;
+               variant = search->second;
             } else {
-               HANDLE hJitMgr = swr_screen(ctx->pipe.screen)->hJitMgr;
-               func = JitCompileBlend(hJitMgr, *compileState);
-               debug_printf("BLEND shader %p\n", func);
-               assert(func && "Error: BlendShader = NULL");
-
-               ctx->blendJIT->insert(std::make_pair(*compileState, func));
+               BLEND_COMPILE_STATE key = *compileState;
+               variant = swr_variant_create(ctx,
+                  [ctx, key] { ctx->blendJIT->erase(key); });
+               variant->jit.func =
+                  (void *)JitCompileBlend(screen->hJitMgr, key);
+               variant->jit.jit_mgr = screen->hJitMgr;
+               debug_printf("BLEND shader %p\n", variant->jit.func);
+               assert(variant->jit.func && "Error: BlendShader = NULL");
+
+               (*ctx->blendJIT)[key] = variant;
             }
-            SwrSetBlendFunc(ctx->swrContext, target, func);
+            PFN_BLEND_JIT_FUNC func =
+               (PFN_BLEND_JIT_FUNC)swr_variant_get(ctx, variant);
+            swr_variant_bind(&ctx->variants->bound_blend[target], variant);
+            ctx->api.pfnSwrSetBlendFunc(ctx->swrContext, target, func);
          }
 
-      SwrSetBlendState(ctx->swrContext, &blendState);
+      ctx->api.pfnSwrSetBlendState(ctx->swrContext, &blendState);
    }
 
    if (ctx->dirty & SWR_NEW_STIPPLE) {
@@ -1191,7 +1378,7 @@ swr_update_derived(struct swr_context *ctx,
    if (ctx->dirty & (SWR_NEW_VS | SWR_NEW_SO | SWR_NEW_RASTERIZER)) {
       ctx->vs->soState.rasterizerDisable =
          ctx->rasterizer->rasterizer_discard;
-      SwrSetSoState(ctx->swrContext, &ctx->vs->soState);
+      ctx->api.pfnSwrSetSoState(ctx->swrContext, &ctx->vs->soState);
 
       pipe_stream_output_info *stream_output = &ctx->vs->pipe.stream_output;
 
@@ -1206,7 +1393,7 @@ swr_update_derived(struct swr_context *ctx,
          buffer.pitch = stream_output->stride[i];
          buffer.streamOffset = ctx->so_targets[i]->buffer_offset >> 2;
 
-         SwrSetSoBuffers(ctx->swrContext, &buffer, i);
+         ctx->api.pfnSwrSetSoBuffers(ctx->swrContext, &buffer, i);
       }
    }
 
@@ -1214,18 +1401,21 @@ swr_update_derived(struct swr_context *ctx,
    if (ctx->rasterizer->sprite_coord_enable)
       linkage |= (1 << ctx->vs->info.base.num_outputs);
 
-   SwrSetLinkage(ctx->swrContext, linkage, NULL);
+   ctx->api.pfnSwrSetLinkage(ctx->swrContext, linkage, NULL);
 
    // set up frontend state
    SWR_FRONTEND_STATE feState = {0};
-   SwrSetFrontendState(ctx->swrContext, &feState);
+   ctx->api.pfnSwrSetFrontendState(ctx->swrContext, &feState);
 
    // set up backend state
    SWR_BACKEND_STATE backendState = {0};
    backendState.numAttributes = 1;
    backendState.numComponents[0] = 4;
    backendState.constantInterpolationMask = ctx->fs->constantMask;
-   SwrSetBackendState(ctx->swrContext, &backendState);
+   ctx->api.pfnSwrSetBackendState(ctx->swrContext, &backendState);
+
+   /* Only now that the variants drawn with are bound */
+   swr_variant_cache_trim(ctx);
 
    ctx->dirty = post_update_dirty_flags;
 }
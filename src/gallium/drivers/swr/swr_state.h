@@ -33,15 +33,18 @@
 #include "api.h"
 #include "swr_tex_sample.h"
 #include "swr_shader.h"
+#include "swr_compile.h"
 #include <unordered_map>
 
+struct swr_variant;
+
 /* skeleton */
 struct swr_vertex_shader {
    struct pipe_shader_state pipe;
    struct lp_tgsi_info info;
    unsigned linkageMask;
    unsigned pointSizeAttrib;
-   PFN_VERTEX_FUNC func;
+   swr_jit_func func;
    SWR_STREAMOUT_STATE soState;
    PFN_SO_FUNC soFunc[PIPE_PRIM_MAX];
 };
@@ -50,13 +53,18 @@ struct swr_fragment_shader {
    struct pipe_shader_state pipe;
    struct lp_tgsi_info info;
    unsigned constantMask;
-   std::unordered_map<swr_jit_key, PFN_PIXEL_KERNEL> map;
+   std::unordered_map<swr_jit_key, swr_variant *> map;
 };
 
 /* Vertex element state */
 struct swr_vertex_element_state {
    FETCH_COMPILE_STATE fsState;
    PFN_FETCH_FUNC fsFunc;
+   swr_jit_func fetch; /* fsFunc, unless it's the precompiled one */
+
+   /* Started at creation for the likeliest state: non-indexed, no restart */
+   FETCH_COMPILE_STATE precompileState;
+   swr_jit_func precompiled;
 #if 1 //BMCDEBUG
    uint32_t stream_pitch[PIPE_MAX_ATTRIBS];
 #endif
@@ -70,6 +78,7 @@ struct swr_blend_state {
 /* Shadows of SWR API DrawState */
 struct swr_shadow_state {
    SWR_SURFACE_STATE *attachment[SWR_NUM_ATTACHMENTS];
+   struct swr_resource *attachment_res[SWR_NUM_ATTACHMENTS];
    SWR_RASTSTATE rastState;
    SWR_VIEWPORT vp;
    SWR_VIEWPORT_MATRIX vpm;
@@ -0,0 +1,204 @@
+/****************************************************************************
+ * Copyright (C) 2015 Intel Corporation.   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ ***************************************************************************/
+
+
+#include "swr_context.h"
+#include "swr_screen.h"
+#include "swr_variant.h"
+#include "gen_knobs.h"
+
+void
+swr_variant_cache_init(struct swr_context *ctx)
+{
+   struct swr_variant_cache *cache = new swr_variant_cache();
+
+   make_empty_list(&cache->lru);
+   cache->sync_done = 0;
+
+   ctx->variants = cache;
+}
+
+void
+swr_variant_cache_destroy(struct swr_context *ctx)
+{
+   struct swr_variant_cache *cache = ctx->variants;
+   if (!cache)
+      return;
+
+   while (!is_empty_list(&cache->lru)) {
+      struct swr_variant *variant = last_elem(&cache->lru)->base;
+      variant->erase();
+      swr_variant_remove(ctx, variant);
+   }
+
+   for (const swr_retired_func &retired : cache->retired)
+      JitFreeFunction(retired.jit_mgr, retired.func);
+
+   if (cache->num_created)
+      debug_printf("SWR jit variants: %llu compiled, %llu evicted\n",
+                   (unsigned long long)cache->num_created,
+                   (unsigned long long)cache->num_evicted);
+
+   delete cache;
+   ctx->variants = NULL;
+}
+
+struct swr_variant *
+swr_variant_create(struct swr_context *ctx, std::function<void()> erase)
+{
+   struct swr_variant_cache *cache = ctx->variants;
+   struct swr_variant *variant = new swr_variant();
+
+   variant->erase = std::move(erase);
+   variant->list_item.base = variant;
+   insert_at_head(&cache->lru, &variant->list_item);
+   cache->num_variants++;
+   cache->num_created++;
+
+   return variant;
+}
+
+void *
+swr_variant_get(struct swr_context *ctx, struct swr_variant *variant)
+{
+   struct swr_variant_cache *cache = ctx->variants;
+   struct swr_screen *screen = swr_screen(ctx->pipe.screen);
+
+   move_to_head(&cache->lru, &variant->list_item);
+
+   void *func =
+      swr_jit_func_get(screen->compile_queue, variant->jit, screen->hJitMgr);
+   if (func && !variant->size) {
+      variant->size = JitGetFunctionSize(variant->jit.jit_mgr, func);
+      cache->size += variant->size;
+   }
+
+   return func;
+}
+
+void
+swr_variant_bind(struct swr_variant **slot, struct swr_variant *variant)
+{
+   if (*slot == variant)
+      return;
+
+   if (*slot)
+      (*slot)->bind_count--;
+   if (variant)
+      variant->bind_count++;
+   *slot = variant;
+}
+
+void
+swr_variant_remove(struct swr_context *ctx, struct swr_variant *variant)
+{
+   struct swr_variant_cache *cache = ctx->variants;
+
+   /* Still set in the core if bound; the next draw binds another */
+   if (cache->bound_fs == variant)
+      swr_variant_bind(&cache->bound_fs, NULL);
+   for (unsigned i = 0; i < PIPE_MAX_COLOR_BUFS; i++) {
+      if (cache->bound_blend[i] == variant)
+         swr_variant_bind(&cache->bound_blend[i], NULL);
+   }
+
+   remove_from_list(&variant->list_item);
+   cache->num_variants--;
+   cache->size -= variant->size;
+
+   swr_jit_retire(ctx, variant->jit);
+   delete variant;
+}
+
+void
+swr_variant_cache_trim(struct swr_context *ctx)
+{
+   struct swr_variant_cache *cache = ctx->variants;
+   size_t budget = (size_t)KNOB_JIT_VARIANT_BUDGET_MB << 20;
+
+   if (!budget || cache->size <= budget)
+      return;
+
+   /* Go down to 3/4 of the budget, so this isn't done on every draw */
+   struct swr_variant_list_item *item = last_elem(&cache->lru);
+   while (!at_end(&cache->lru, item) && cache->size > budget / 4 * 3) {
+      struct swr_variant *variant = item->base;
+      item = prev_elem(item);
+
+      if (variant->bind_count)
+         continue;
+
+      variant->erase();
+      swr_variant_remove(ctx, variant);
+      cache->num_evicted++;
+   }
+}
+
+void
+swr_jit_retire(struct swr_context *ctx, swr_jit_func &jit)
+{
+   struct swr_variant_cache *cache = ctx->variants;
+
+   swr_compile_cancel(swr_screen(ctx->pipe.screen)->compile_queue, jit.job);
+
+   if (jit.func) {
+      cache->retired.push_back(
+         swr_retired_func{cache->sync_submitted + 1, jit.jit_mgr, jit.func});
+      cache->sync_pending = true;
+   }
+
+   jit.func = NULL;
+   jit.jit_mgr = NULL;
+}
+
+/*
+ * Called by the backend once every draw queued before the sync is done.
+ */
+static void
+swr_jit_sync_cb(uint64_t userData, uint64_t userData2)
+{
+   struct swr_variant_cache *cache = (struct swr_variant_cache *)userData;
+
+   cache->sync_done = userData2;
+}
+
+void
+swr_jit_reap(struct swr_context *ctx)
+{
+   struct swr_variant_cache *cache = ctx->variants;
+
+   if (cache->sync_pending) {
+      cache->sync_submitted++;
+      cache->sync_pending = false;
+      ctx->api.pfnSwrSync(
+         ctx->swrContext, swr_jit_sync_cb, (uint64_t)cache,
+         cache->sync_submitted);
+   }
+
+   uint64_t sync_done = cache->sync_done;
+   while (!cache->retired.empty() && cache->retired.front().sync <= sync_done) {
+      const swr_retired_func &retired = cache->retired.front();
+      JitFreeFunction(retired.jit_mgr, retired.func);
+      cache->retired.pop_front();
+   }
+}
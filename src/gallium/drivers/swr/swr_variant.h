@@ -0,0 +1,109 @@
+/****************************************************************************
+ * Copyright (C) 2015 Intel Corporation.   All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ ***************************************************************************/
+
+
+#ifndef SWR_VARIANT_H
+#define SWR_VARIANT_H
+
+#include "pipe/p_state.h"
+#include "util/simple_list.h"
+#include "swr_compile.h"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+
+/*
+ * Lifetime of jitted code.  Fragment shader and blend variants live on an
+ * LRU list per context and are evicted once their code takes more than
+ * KNOB_JIT_VARIANT_BUDGET_MB.  Functions that stop being used are retired:
+ * their code is freed once the draws queued before then have finished.
+ */
+
+struct swr_context;
+struct swr_variant;
+
+struct swr_variant_list_item {
+   struct swr_variant *base;
+   struct swr_variant_list_item *next, *prev;
+};
+
+struct swr_variant {
+   swr_jit_func jit;
+   size_t size;         /* code bytes, counted once compiled */
+   unsigned bind_count; /* set as pixel shader or blend function */
+   std::function<void()> erase; /* erases it from the map holding it */
+   struct swr_variant_list_item list_item;
+};
+
+/* Freed once the sync submitted after retiring it has passed */
+struct swr_retired_func {
+   uint64_t sync;
+   HANDLE jit_mgr;
+   void *func;
+};
+
+struct swr_variant_cache {
+   struct swr_variant_list_item lru; /* most recently used first */
+   unsigned num_variants;
+   size_t size;
+   uint64_t num_created;
+   uint64_t num_evicted;
+
+   struct swr_variant *bound_fs;
+   struct swr_variant *bound_blend[PIPE_MAX_COLOR_BUFS];
+
+   std::deque<swr_retired_func> retired;
+   bool sync_pending;
+   uint64_t sync_submitted;
+   std::atomic<uint64_t> sync_done; /* written by the backend */
+};
+
+void swr_variant_cache_init(struct swr_context *ctx);
+
+/* Frees all the context's code; the core must be done with it */
+void swr_variant_cache_destroy(struct swr_context *ctx);
+
+/* Puts a new variant at the head of the LRU list */
+struct swr_variant *
+swr_variant_create(struct swr_context *ctx, std::function<void()> erase);
+
+/* Returns the variant's function, waiting for its compile if needed */
+void *swr_variant_get(struct swr_context *ctx, struct swr_variant *variant);
+
+/* Replaces the variant bound in slot; bound variants aren't evicted */
+void swr_variant_bind(struct swr_variant **slot, struct swr_variant *variant);
+
+/* Retires the variant's function and frees it; the caller erases it */
+void swr_variant_remove(struct swr_context *ctx, struct swr_variant *variant);
+
+/* Evicts least recently used variants while over budget */
+void swr_variant_cache_trim(struct swr_context *ctx);
+
+/* Cancels or retires a function; jit is left empty */
+void swr_jit_retire(struct swr_context *ctx, swr_jit_func &jit);
+
+/* Submits a sync for newly retired functions, frees the ones passed */
+void swr_jit_reap(struct swr_context *ctx);
+
+#endif